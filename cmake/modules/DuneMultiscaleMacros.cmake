@@ -13,6 +13,10 @@ find_package(UMFPack)
 find_package(SuiteSparse)
 include_directories( ${SUITESPARSE_INCLUDE_DIRS} )
 set(DUNE_UMFPACK_LIBRARIES ${UMFPACK_LIBRARY} ${CHOLMOD_LIBRARY} ${COLAMD_LIBRARY} ${AMD_LIBRARY} ${SUITESPARSE_CONFIG_LIBRARY} )
+set(HAVE_CHOLMOD 0)
+if(CHOLMOD_FOUND)
+  set(HAVE_CHOLMOD 1)
+endif(CHOLMOD_FOUND)
 
 find_package(FFTW)
 set(HAVE_RANDOM_PROBLEM ${HAVE_FFTW})
@@ -26,6 +26,7 @@
 #define DUNE_MULTISCALE_USE_ISTL @USE_ISTL_BACKEND@
 #define DUNE_MULTISCALE_WITH_DUNE_FEM @USE_FEM_BACKEND@
 #define HAVE_FFTW @HAVE_FFTW@
+#define HAVE_CHOLMOD @HAVE_CHOLMOD@
 
 #define DUNE_COMMON_FIELDVECTOR_SIZE_IS_METHOD 1
 
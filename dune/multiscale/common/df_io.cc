@@ -1,6 +1,178 @@
 #include <config.h>
 #include "df_io.hh"
 #include <dune/xt/common/string.hh>
+#include <dune/common/parallel/mpihelper.hh>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/format.hpp>
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+Dune::Multiscale::DiskBackend::DiskBackend(const Dune::XT::Common::Configuration& config, const std::string filename)
+  : path_(boost::filesystem::path(config.get("global.datadir", "data"))
+          / (boost::format("%s_rank%d.bin") % filename % MPIHelper::getCollectiveCommunication().rank()).str())
+  , fd_(-1)
+  , end_(0)
+{
+  Dune::XT::Common::test_create_directory(path_.string());
+  fd_ = ::open(path_.string().c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd_ < 0)
+    DUNE_THROW(IOError, "cannot create function store " << path_.string() << ": " << std::strerror(errno));
+}
+
+Dune::Multiscale::DiskBackend::~DiskBackend()
+{
+  if (fd_ >= 0)
+    ::close(fd_);
+  boost::system::error_code ignored;
+  boost::filesystem::remove(path_, ignored);
+}
+
+void Dune::Multiscale::DiskBackend::append(const std::size_t coarse_index,
+                                           const std::size_t number,
+                                           const Dune::Multiscale::DiskBackend::VectorType& vector)
+{
+  const std::size_t size = vector.size();
+  const HeaderType header{{coarse_index, number, size}};
+  std::vector<char> buffer(sizeof(HeaderType) + size * sizeof(double));
+  std::memcpy(buffer.data(), header.data(), sizeof(HeaderType));
+  auto values = reinterpret_cast<double*>(buffer.data() + sizeof(HeaderType));
+  for (auto i : Dune::XT::Common::value_range(size))
+    values[i] = vector.get_entry(i);
+
+  const auto key = std::make_pair(coarse_index, number);
+  std::uint64_t offset = 0;
+  std::uint64_t capacity = size;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto old = index_.find(key);
+    if (old != index_.end() && old->second.capacity >= size) {
+      // overwrite the previous record of the pair
+      offset = old->second.offset;
+      capacity = old->second.capacity;
+    } else {
+      if (old != index_.end()) {
+        free_.emplace(old->second.capacity, old->second.offset);
+        index_.erase(old);
+      }
+      // the smallest replaced record that fits, the end of the file otherwise
+      const auto slot = free_.lower_bound(size);
+      if (slot != free_.end()) {
+        capacity = slot->first;
+        offset = slot->second;
+        free_.erase(slot);
+      } else {
+        offset = end_;
+        end_ += buffer.size();
+      }
+    }
+  }
+  std::size_t written = 0;
+  while (written < buffer.size()) {
+    const auto ret = ::pwrite(fd_, buffer.data() + written, buffer.size() - written, offset + written);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      DUNE_THROW(IOError, "writing to function store " << path_.string() << " failed: " << std::strerror(errno));
+    written += ret;
+  }
+  // only publish the record once its data is complete
+  std::lock_guard<std::mutex> lock(mutex_);
+  index_[key] = Record{offset, size, capacity};
+}
+
+void Dune::Multiscale::DiskBackend::read(const std::size_t coarse_index,
+                                         const std::size_t number,
+                                         Dune::Multiscale::DiskBackend::VectorType& vector) const
+{
+  Record record;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = index_.find(std::make_pair(coarse_index, number));
+    if (it == index_.end())
+      DUNE_THROW(InvalidStateException, "no function " << number << " of coarse cell " << coarse_index << " on disk");
+    record = it->second;
+  }
+  if (vector.size() != record.size)
+    DUNE_THROW(InvalidStateException, "stored function has " << record.size << " dofs, target " << vector.size());
+
+  // mmap offsets need to be page aligned
+  static const std::uint64_t page_size = ::sysconf(_SC_PAGE_SIZE);
+  const auto aligned_offset = record.offset - record.offset % page_size;
+  const auto shift = record.offset - aligned_offset;
+  const auto length = shift + sizeof(HeaderType) + record.size * sizeof(double);
+  void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd_, aligned_offset);
+  if (mapping == MAP_FAILED)
+    DUNE_THROW(IOError, "mapping function store " << path_.string() << " failed: " << std::strerror(errno));
+
+  const auto data = static_cast<const char*>(mapping) + shift;
+  HeaderType header;
+  std::memcpy(header.data(), data, sizeof(HeaderType));
+  const bool header_ok = header[0] == coarse_index && header[1] == number && header[2] == record.size;
+  if (header_ok) {
+    // records are multiples of 8 bytes long, so the values are properly aligned
+    const auto values = reinterpret_cast<const double*>(data + sizeof(HeaderType));
+    for (auto i : Dune::XT::Common::value_range(std::size_t(record.size)))
+      vector.set_entry(i, values[i]);
+  }
+  ::munmap(mapping, length);
+  if (!header_ok)
+    DUNE_THROW(IOError, "corrupt record for function " << number << " of coarse cell " << coarse_index);
+}
+
+std::size_t Dune::Multiscale::DiskBackend::bytes() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return end_;
+}
+
+Dune::Multiscale::MemoryBackend::MemoryBackend(Dune::Multiscale::IOTraits::GridViewType& grid_view,
+                                               const std::size_t coarse_index)
+  : space_(MsFEMTraits::SpaceChooserType::make_space(grid_view))
+  , coarse_index_(coarse_index)
+{
+}
+
+void Dune::Multiscale::MemoryBackend::append(const Dune::Multiscale::IOTraits::DiscreteFunction_ptr& df)
+{
+  assert(df);
+  const auto bytes = df->vector().size() * sizeof(IOTraits::DiscreteFunctionType::RangeFieldType);
+  if (DiscreteFunctionIO::reserve(bytes)) {
+    functions_.push_back(df);
+  } else {
+    DiscreteFunctionIO::spill().append(coarse_index_, functions_.size(), df->vector());
+    functions_.push_back(nullptr);
+  }
+}
+
+void Dune::Multiscale::MemoryBackend::read(const unsigned long index,
+                                           Dune::Multiscale::IOTraits::DiscreteFunction_ptr& df)
+{
+  if (index >= functions_.size())
+    DUNE_THROW(InvalidStateException, "requesting function at oob index " << index);
+  if (functions_[index]) {
+    df = functions_[index];
+  } else {
+    df = make_df_ptr<IOTraits::DiscreteFunctionType>("Local problem Solution", space_);
+    DiscreteFunctionIO::spill().read(coarse_index_, index, df->vector());
+  }
+  assert(df != nullptr);
+}
+
+void Dune::Multiscale::MemoryBackend::clear()
+{
+  for (const auto& df : functions_)
+    if (df)
+      DiscreteFunctionIO::release(df->vector().size() * sizeof(IOTraits::DiscreteFunctionType::RangeFieldType));
+  functions_.clear();
+  diffusion_cache_.reset();
+  coarse_matrix_.reset();
+}
 
 Dune::Multiscale::DiskBackend& Dune::Multiscale::DiscreteFunctionIO::get_disk(const XT::Common::Configuration& config,
                                                                               std::string filename)
@@ -14,7 +186,7 @@ Dune::Multiscale::DiscreteFunctionIO::get_memory(std::string filename,
 {
   const auto tokens = Dune::XT::Common::tokenize(filename, "_");
   const size_t idx = Dune::XT::Common::from_string<size_t>(tokens.back());
-  return *get(memory_, idx, grid_view, filename);
+  return *get(memory_, idx, grid_view, idx);
 }
 
 Dune::Multiscale::MemoryBackend&
@@ -29,15 +201,52 @@ Dune::Multiscale::DiskBackend& Dune::Multiscale::DiscreteFunctionIO::disk(const
   return instance().get_disk(config, filename);
 }
 
+bool Dune::Multiscale::DiscreteFunctionIO::reserve(const std::size_t bytes)
+{
+  auto& th = instance();
+  if (th.budget_ == 0) {
+    th.memory_bytes_ += bytes;
+    return true;
+  }
+  auto current = th.memory_bytes_.load();
+  do {
+    if (current + bytes > th.budget_)
+      return false;
+  } while (!th.memory_bytes_.compare_exchange_weak(current, current + bytes));
+  return true;
+}
+
+std::size_t Dune::Multiscale::DiscreteFunctionIO::configured_budget()
+{
+  return DXTC_CONFIG_GET("msfem.corrector_memory_budget", 0.) * 1024 * 1024;
+}
+
+void Dune::Multiscale::DiscreteFunctionIO::release(const std::size_t bytes)
+{
+  instance().memory_bytes_ -= bytes;
+}
+
+Dune::Multiscale::DiskBackend& Dune::Multiscale::DiscreteFunctionIO::spill()
+{
+  return disk(DXTC_CONFIG, "local_problems/spilled_functions");
+}
+
 void Dune::Multiscale::DiscreteFunctionIO::clear()
 {
   auto& th = instance();
-  MS_LOG_DEBUG << (boost::format("cleared %d in-memory functions\ncleared %d "
-                                 "on-disk   functions\nfor %s\n")
+  std::size_t spilled_bytes = 0;
+  for (const auto& disk : th.disk_)
+    spilled_bytes += disk.second->bytes();
+  MS_LOG_DEBUG << (boost::format("cleared %d in-memory functions (%d bytes)\ncleared %d "
+                                 "on-disk   functions (%d bytes)\nfor %s\n")
                    % th.memory_.size()
+                   % th.memory_bytes_.load()
                    % th.disk_.size()
+                   % spilled_bytes
                    % Dune::XT::Common::get_typename(th))
                       .str();
   th.memory_.clear();
   th.disk_.clear();
+  th.memory_bytes_ = 0;
+  th.budget_ = configured_budget();
 }
@@ -10,7 +10,12 @@
 #ifndef DISCRETEFUNCTIONWRITER_HEADERGUARD
 #define DISCRETEFUNCTIONWRITER_HEADERGUARD
 
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <fstream>
+#include <map>
+#include <mutex>
 #include <vector>
 #include <cassert>
 #include <memory>
@@ -19,6 +24,7 @@
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 #include <dune/common/deprecated.hh>
+#include <dune/common/dynmatrix.hh>
 #include <dune/common/exceptions.hh>
 #include <dune/xt/common/configuration.hh>
 #include <dune/xt/common/filesystem.hh>
@@ -32,6 +38,8 @@
 namespace Dune {
 namespace Multiscale {
 
+class LocalDiffusionCache;
+
 struct IOTraits
 {
   typedef MsFEMTraits::LocalGridDiscreteFunctionType DiscreteFunctionType;
@@ -39,89 +47,101 @@ struct IOTraits
   typedef typename DiscreteFunctionType::SpaceType DiscreteFunctionSpaceType;
   typedef std::vector<DiscreteFunction_ptr> Vector;
   typedef typename DiscreteFunctionSpaceType::GridViewType GridViewType;
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> CoarseElementMatrixType;
 };
 
+/**
+ * \brief per-rank binary store for local problem solutions
+ *
+ * All functions of one rank go into a single scratch file below global.datadir. A record is a header
+ * (coarse cell index, function number, number of dofs) followed by the raw dof values. Records are found
+ * through an in-memory index by coarse cell index and function number and are read back through a
+ * read-only memory mapping of the record's pages. The file is removed when the backend is destroyed.
+ */
 class DiskBackend : public boost::noncopyable
 {
-
-  void load_disk_functions()
-  {
-    Dune::XT::Common::test_create_directory(dir_.string());
-    // if functions present, load em
-  }
-
 public:
+  typedef IOTraits::DiscreteFunctionType::VectorType VectorType;
+
   /**
-   * \brief DiscreteFunctionWriter
-   * \param filename will open fstream at config["global.datadir"]/filename
+   * \param filename the store is created at config["global.datadir"]/filename_rank<rank>.bin
    *  filename may include additional path components
-   * \throws Dune::IOError if config["global.datadir"]/filename cannot be opened
+   * \throws Dune::IOError if the file cannot be created
    */
-  DiskBackend(const Dune::XT::Common::Configuration& config, const std::string filename = "nonsense_default_for_map")
-    : dir_(boost::filesystem::path(config.get("global.datadir", "data")) / filename)
-    , index_(0)
-  {
-  }
+  DiskBackend(const Dune::XT::Common::Configuration& config, const std::string filename = "nonsense_default_for_map");
+  ~DiskBackend();
 
-  void append(const IOTraits::DiscreteFunction_ptr& /*df*/)
-  {
-    const std::string fn = (dir_ / Dune::XT::Common::to_string(index_++)).string();
-    Dune::XT::Common::test_create_directory(fn);
-    DUNE_THROW(NotImplemented, "");
-  }
+  /** thread safe. Writing a (coarse_index, number) pair again replaces it: in place if the new vector fits into the
+   * old record, else the old record's space is kept for later records that fit. Must not run concurrently with a
+   * read of the same pair.
+   */
+  void append(const std::size_t coarse_index, const std::size_t number, const VectorType& vector);
+  //! thread safe
+  void read(const std::size_t coarse_index, const std::size_t number, VectorType& vector) const;
 
-  void read(const unsigned long index, IOTraits::DiscreteFunction_ptr& /*df*/)
-  {
-    const std::string fn = (dir_ / Dune::XT::Common::to_string(index)).string();
-    DUNE_THROW(NotImplemented, "");
-  }
+  //! size of the store on disk
+  std::size_t bytes() const;
 
 private:
-  const boost::filesystem::path dir_;
-  unsigned int index_;
+  typedef std::array<std::uint64_t, 3> HeaderType;
+  struct Record
+  {
+    std::uint64_t offset;
+    std::uint64_t size;
+    //! number of values that fit into the record's space, at least size
+    std::uint64_t capacity;
+  };
+
+  const boost::filesystem::path path_;
+  int fd_;
+  std::uint64_t end_;
+  std::map<std::pair<std::size_t, std::size_t>, Record> index_;
+  //! offsets of replaced records, by capacity
+  std::multimap<std::uint64_t, std::uint64_t> free_;
+  mutable std::mutex mutex_;
 };
 
 /**
- * \brief simple discrete function to disk writer
- * this class isn't type safe in the sense that different appends may append
- * non-convertible discrete function implementations
+ * \brief in-memory storage of all local problem solutions of one coarse cell
+ * Functions that do not fit into DiscreteFunctionIO's memory budget are transparently spilled to
+ * the rank's DiskBackend and re-created on read.
  */
 class MemoryBackend : public boost::noncopyable
 {
 public:
-  /**
-   * \brief DiscreteFunctionWriter
-   * \param filename will open fstream at config["global.datadir"]/filename
-   *  filename may include additional path components
-   * \throws Dune::IOError if config["global.datadir"]/filename cannot be opened
-   */
-  MemoryBackend(IOTraits::GridViewType& grid_view, const std::string /*filename*/ = "nonsense_default_for_map")
-    : space_(MsFEMTraits::SpaceChooserType::make_space(grid_view))
-  {
-  }
+  MemoryBackend(IOTraits::GridViewType& grid_view, const std::size_t coarse_index);
+
+  void append(const IOTraits::DiscreteFunction_ptr& df);
 
-  void append(const IOTraits::DiscreteFunction_ptr& df)
+  void read(const unsigned long index, IOTraits::DiscreteFunction_ptr& df);
+
+  //! drops all functions, the coefficient cache and the coarse element matrix, eg. before saving new solutions
+  void clear();
+
+  IOTraits::DiscreteFunctionSpaceType& space()
   {
-    functions_.push_back(df);
+    return space_;
   }
 
-  void read(const unsigned long index, IOTraits::DiscreteFunction_ptr& df)
+  //! coefficients cached while solving the local problems, kept as long as the solutions
+  std::shared_ptr<LocalDiffusionCache>& diffusion_cache()
   {
-    if (index < functions_.size()) {
-      df = functions_.at(index);
-    } else
-      DUNE_THROW(InvalidStateException, "requesting function at oob index " << index);
-    assert(df != nullptr);
+    return diffusion_cache_;
   }
 
-  IOTraits::DiscreteFunctionSpaceType& space()
+  //! coarse element matrix computed while solving the local problems (msfem.coarse_assembly = algebraic)
+  std::shared_ptr<const IOTraits::CoarseElementMatrixType>& coarse_matrix()
   {
-    return space_;
+    return coarse_matrix_;
   }
 
 private:
   IOTraits::DiscreteFunctionSpaceType space_;
+  const std::size_t coarse_index_;
+  //! nullptr marks functions that were spilled to disk
   IOTraits::Vector functions_;
+  std::shared_ptr<LocalDiffusionCache> diffusion_cache_;
+  std::shared_ptr<const IOTraits::CoarseElementMatrixType> coarse_matrix_;
 };
 
 class DiscreteFunctionIO : public boost::noncopyable
@@ -129,7 +149,14 @@ class DiscreteFunctionIO : public boost::noncopyable
 
   typedef DiscreteFunctionIO ThisType;
 
-  DiscreteFunctionIO() = default;
+  DiscreteFunctionIO()
+    : budget_(configured_budget())
+    , memory_bytes_(0)
+  {
+  }
+
+  //! msfem.corrector_memory_budget in bytes, read again on each clear so every run uses its own setting
+  static std::size_t configured_budget();
 
 private:
   static ThisType& instance()
@@ -149,10 +176,10 @@ private:
   template <class IOMapType, class... Args>
   typename IOMapType::mapped_type& get(IOMapType& map, typename IOMapType::key_type key, Args&&... ctor_args)
   {
+    std::lock_guard<std::mutex> lock(mutex_);
     auto it = map.find(key);
     if (it != map.end())
       return it->second;
-    std::lock_guard<std::mutex> lock(mutex_);
     auto ptr = std::make_shared<typename IOMapType::mapped_type::element_type>(ctor_args...);
     auto ret = Dune::XT::Common::map_emplace(map, key, std::move(ptr));
     assert(ret.second);
@@ -169,6 +196,15 @@ public:
   static MemoryBackend& memory(std::string filename, IOTraits::GridViewType& grid_view);
   static DiskBackend& disk(const XT::Common::Configuration& config, std::string filename);
 
+  /** \brief account for bytes of function data about to be kept in memory
+   * \return false, and accounts nothing, if that would exceed msfem.corrector_memory_budget (in MiB, 0 = unlimited)
+   */
+  static bool reserve(const std::size_t bytes);
+  //! returns bytes accounted by reserve to the budget
+  static void release(const std::size_t bytes);
+  //! the rank's store for functions that exceed the memory budget
+  static DiskBackend& spill();
+
   static ClearGuard clear_guard()
   {
     return ClearGuard();
@@ -178,6 +214,8 @@ private:
   std::unordered_map<size_t, std::shared_ptr<MemoryBackend>> memory_;
   std::unordered_map<std::string, std::shared_ptr<DiskBackend>> disk_;
   std::mutex mutex_;
+  std::size_t budget_;
+  std::atomic<std::size_t> memory_bytes_;
 
 }; // class DiscreteFunctionIO
 
@@ -10,6 +10,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <dune/gdt/assembler/system.hh>
 #include <dune/gdt/discretefunction/default.hh>
@@ -344,8 +345,6 @@ double surface_flow_gdt(const Dune::Multiscale::CommonTraits::GridType& grid,
   // Constants and types
   constexpr auto dim = CommonTraits::world_dim;
   typedef double REAL; // TODO read from input
-  typedef typename Dune::FieldVector<REAL, dim> FV; // point on cell
-  typedef typename Dune::FieldMatrix<REAL, dim, dim> FM; // point on cell
   typedef typename Dune::FieldMatrix<REAL, 1, dim> Grad; // point on cell
   typedef typename Dune::QuadratureRule<REAL, dim - 1> QR;
   typedef typename Dune::QuadratureRules<REAL, dim - 1> QRS;
@@ -367,14 +366,17 @@ double surface_flow_gdt(const Dune::Multiscale::CommonTraits::GridType& grid,
     for (iFace = gv.ibegin(*iCell); iFace != gv.iend(*iCell); ++iFace) {
       if (iFace->boundary() && iFace->geometry().center()[0] == 0) {
         double area = iFace->geometry().volume();
+        std::vector<CommonTraits::DomainType> positions;
+        for (auto iGauss = rule.begin(); iGauss != rule.end(); ++iGauss)
+          positions.push_back(iFace->geometry().global(iGauss->position()));
+        std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType> diffs;
+        diffusion.evaluate_batch(positions, diffs);
         // Loop over gauss points
-        for (auto iGauss = rule.begin(); iGauss != rule.end(); ++iGauss) {
-          FV pos = iFace->geometry().global(iGauss->position());
+        std::size_t gauss = 0;
+        for (auto iGauss = rule.begin(); iGauss != rule.end(); ++iGauss, ++gauss) {
           Grad grad;
-          FM diff;
-          diffusion.evaluate(pos, diff);
-          local_solution->jacobian(pos, grad);
-          localFlux -= iGauss->weight() * area * diff[0][0] * grad[0][0];
+          local_solution->jacobian(positions[gauss], grad);
+          localFlux -= iGauss->weight() * area * diffs[gauss][0][0] * grad[0][0];
         }
       }
     }
@@ -11,9 +11,49 @@
 #include <dune/xt/common/float_cmp.hh>
 #include <dune/xt/common/ranges.hh>
 
+#include <map>
+#include <mutex>
+
 using namespace Dune::Multiscale;
 using namespace std;
 
+namespace {
+
+struct GridIds
+{
+  std::mutex mutex;
+  std::map<const CommonTraits::GridType*, std::size_t> ids;
+  std::size_t next = 1;
+};
+
+//! never destroyed, grids may be released during static destruction
+GridIds& grid_ids()
+{
+  static auto ids = new GridIds;
+  return *ids;
+}
+
+//! shares ownership of grid, which has a grid_id until it is destroyed
+std::shared_ptr<CommonTraits::GridType> registered(std::shared_ptr<CommonTraits::GridType> grid)
+{
+  auto& registry = grid_ids();
+  {
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.ids[grid.get()] = registry.next++;
+  }
+  const auto raw = grid.get();
+  return std::shared_ptr<CommonTraits::GridType>(raw, [grid](CommonTraits::GridType* ptr) mutable {
+    {
+      auto& registry = grid_ids();
+      std::lock_guard<std::mutex> lock(registry.mutex);
+      registry.ids.erase(ptr);
+    }
+    grid.reset();
+  });
+}
+
+} // namespace {
+
 typedef tuple<CommonTraits::DomainType,
               CommonTraits::DomainType,
               array<unsigned int, CommonTraits::world_dim>,
@@ -63,7 +103,7 @@ Dune::Multiscale::make_coarse_grid(const DMP::ProblemContainer& problem, Dune::M
   //    DUNE_THROW(InvalidStateException, "Wonky grid distribution");
   if ((coarse_gridptr->comm().size() > 1) && (actual_elements == int(expected_elements)))
     DUNE_THROW(InvalidStateException, "Rank 0 fail");
-  return coarse_gridptr;
+  return registered(coarse_gridptr);
 }
 
 pair<shared_ptr<CommonTraits::GridType>, shared_ptr<CommonTraits::GridType>> Dune::Multiscale::make_grids(
@@ -115,5 +155,13 @@ Dune::Multiscale::make_fine_grid(const DMP::ProblemContainer& problem,
     //<< " | " << coarse_view.size(0) << '\n');
     //}
   }
-  return fine_gridptr;
+  return registered(fine_gridptr);
+}
+
+std::size_t Dune::Multiscale::grid_id(const CommonTraits::GridType& grid)
+{
+  auto& registry = grid_ids();
+  std::lock_guard<std::mutex> lock(registry.mutex);
+  const auto found = registry.ids.find(&grid);
+  return found == registry.ids.end() ? 0 : found->second;
 }
@@ -3,6 +3,8 @@
 
 #include <dune/multiscale/common/traits.hh>
 
+#include <cstddef>
+
 namespace Dune {
 namespace Multiscale {
 
@@ -26,6 +28,13 @@ std::shared_ptr<CommonTraits::GridType>
 make_coarse_grid(const DMP::ProblemContainer& problem,
                  Dune::MPIHelper::MPICommunicator communicator = Dune::MPIHelper::getCommunicator());
 
+/** \brief process-wide unique number of a grid created by the functions above
+ * Unlike the grid's address it is not reused for another grid after this one is destroyed, so it can key caches of
+ * data derived from the grid.
+ * \return 0 for grids created otherwise
+ */
+std::size_t grid_id(const CommonTraits::GridType& grid);
+
 } // namespace Multiscale {
 } // namespace Dune {
 
@@ -1,11 +1,21 @@
 #include <config.h>
 #include "heterogenous.hh"
 
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
 #include <dune/multiscale/msfem/localproblems/localgridsearch.hh>
 #include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
 #include <dune/multiscale/msfem/localsolution_proxy.hh>
 #include <dune/xt/common/parallel/partitioner.hh>
+#include <dune/xt/common/parallel/threadstorage.hh>
 #include <dune/grid/utility/partitioning/seedlist.hh>
+#include <dune/xt/common/float_cmp.hh>
+#include <dune/xt/common/timings.hh>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <utility>
+#include <vector>
 
 void Dune::Multiscale::MsFEMProjection::project(Dune::Multiscale::LocalsolutionProxy& source,
                                                 Dune::Multiscale::CommonTraits::DiscreteFunctionType& target)
@@ -13,23 +23,37 @@ void Dune::Multiscale::MsFEMProjection::project(Dune::Multiscale::LocalsolutionP
   constexpr size_t target_dimRange = CommonTraits::dimRange;
   static_assert(target_dimRange == 1, "");
 
-  const auto& space = target.space();
+  if (project_nested(source, target))
+    return;
+  project_generic(source, target);
+}
 
+void Dune::Multiscale::MsFEMProjection::project_generic(Dune::Multiscale::LocalsolutionProxy& source,
+                                                        Dune::Multiscale::CommonTraits::DiscreteFunctionType& target)
+{
+  constexpr size_t target_dimRange = CommonTraits::dimRange;
+  const auto& space = target.space();
   preprocess(target);
-  const auto interior = space.grid_view().grid().template leafGridView<Interior_Partition>();
-  typedef std::remove_const<decltype(interior)>::type InteriorType;
-  GDT::SystemAssembler<CommonTraits::SpaceType, InteriorType> walker(space, interior);
-  Dune::XT::Common::IndexSetPartitioner<InteriorType> ip(interior.indexSet());
-  SeedListPartitioning<typename InteriorType::Grid, 0> partitioning(interior, ip);
 
+  const auto interior = space.grid_view().grid().template leafGridView<CommonTraits::InteriorBorderPartition>();
+  GDT::SystemAssembler<CommonTraits::SpaceType, CommonTraits::InteriorGridViewType> walker(space, interior);
+  Dune::XT::Common::IndexSetPartitioner<CommonTraits::InteriorGridViewType> ip(interior.indexSet());
+  SeedListPartitioning<typename CommonTraits::InteriorGridViewType::Grid, 0> partitioning(interior, ip);
+
+  // dofs are shared between elements of different threads, each thread sums into its own buffer
+  typedef typename CommonTraits::DiscreteFunctionType::RangeFieldType RangeFieldType;
+  Dune::XT::Common::PerThreadValue<std::vector<RangeFieldType>> sums;
   const std::function<void(const CommonTraits::EntityType&)> func = [&](const CommonTraits::EntityType& target_entity) {
-    auto target_local_function = target.local_discrete_function(target_entity);
     const auto global_quads = global_evaluation_points(space, target_entity);
     auto& search = source.search();
     const auto evaluation_entity_ptrs = search(global_quads);
     assert(evaluation_entity_ptrs.size() >= global_quads.size());
 
-    size_t k = 0;
+    auto& sum = *sums;
+    if (sum.empty())
+      sum.assign(target.vector().size(), 0.);
+    const auto dofs = space.mapper().globalIndices(target_entity);
+    assert(dofs.size() == global_quads.size() * target_dimRange);
     typename CommonTraits::DiscreteFunctionType::RangeType source_value;
     for (size_t qP = 0; qP < global_quads.size(); ++qP) {
       const auto& source_entity_unique_ptr = evaluation_entity_ptrs[qP];
@@ -40,9 +64,9 @@ void Dune::Multiscale::MsFEMProjection::project(Dune::Multiscale::LocalsolutionP
         const auto& source_local_point = source_geometry.local(global_point);
         const auto& source_local_function = source.local_function(source_entity);
         source_value = source_local_function->evaluate(source_local_point);
-        for (size_t i = 0; i < target_dimRange; ++i, ++k) {
-          target_local_function->vector().set(k, source_value[i]);
-        }
+        // every incident element adds its value, postprocess turns the sum into the average
+        for (size_t i = 0; i < target_dimRange; ++i)
+          sum[dofs[qP * target_dimRange + i]] += source_value[i];
       } else {
         DUNE_THROW(InvalidStateException, "Did not find the local lagrange point in the source mesh!");
       }
@@ -52,9 +76,115 @@ void Dune::Multiscale::MsFEMProjection::project(Dune::Multiscale::LocalsolutionP
   walker.add(func);
   walker.assemble(partitioning);
 
+  auto& target_vector = target.vector();
+  for (const auto& sum : sums)
+    for (const auto i : Dune::XT::Common::value_range(sum.size()))
+      target_vector.add_to_entry(i, sum[i]);
   postprocess(target);
 }
 
+bool Dune::Multiscale::MsFEMProjection::project_nested(const Dune::Multiscale::LocalsolutionProxy& source,
+                                                       Dune::Multiscale::CommonTraits::DiscreteFunctionType& target)
+{
+  Dune::XT::Common::ScopedTiming st("msfem.projection.nested");
+  const auto& fine_grid = target.space().grid_view().grid();
+  auto& localgrid_list = source.localgrid_list();
+  auto map = localgrid_list.nested_projection(fine_grid);
+  if (!map) {
+    map = nested_map(source, target.space());
+    if (!map)
+      return false;
+    localgrid_list.set_nested_projection(fine_grid, map);
+  }
+  if (!map->nested)
+    return false;
+  const auto& corrections = source.corrections();
+  for (const auto& cell : map->transfers)
+    if (corrections.find(cell.first) == corrections.end())
+      return false;
+
+  preprocess(target);
+  auto& target_vector = target.vector();
+  for (const auto& cell : map->transfers) {
+    const auto& local_vector = corrections.find(cell.first)->second->vector();
+    for (const auto& transfer : cell.second)
+      target_vector.add_to_entry(transfer.fine_dof, transfer.weight * local_vector.get_entry(transfer.local_dof));
+  }
+  return true;
+}
+
+//! \return nullptr if source has no correction for some coarse cell
+std::shared_ptr<const Dune::Multiscale::NestedProjectionMap>
+Dune::Multiscale::MsFEMProjection::nested_map(const Dune::Multiscale::LocalsolutionProxy& source,
+                                              const Dune::Multiscale::CommonTraits::SpaceType& space)
+{
+  auto map = std::make_shared<NestedProjectionMap>();
+  const auto& fine_grid = space.grid_view().grid();
+  // the fine elements of the generic projection and of postprocess's averaging
+  const StructuredCellIndex<CommonTraits::InteriorGridViewType> fine_cells(
+      fine_grid.leafGridView<CommonTraits::InteriorBorderPartition>());
+  if (!fine_cells.valid())
+    return map;
+
+  // (local dof, fine dof) -> number of local elements in which they coincide, per coarse cell
+  typedef std::map<std::pair<std::size_t, std::size_t>, std::size_t> MultiplicityMapType;
+  std::map<std::size_t, MultiplicityMapType> multiplicities;
+  // number of fine elements sharing a fine dof
+  std::vector<std::size_t> incidences(space.mapper().size(), 0);
+
+  const auto& corrections = source.corrections();
+  const auto coarse_interior = source.coarse_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>();
+  const auto& coarse_index_set = coarse_interior.grid().leafIndexSet();
+  CommonTraits::EntityType::EntitySeed fine_seed;
+  for (const auto& coarse_entity : Dune::elements(coarse_interior)) {
+    const std::size_t coarse_index = coarse_index_set.index(coarse_entity);
+    const auto found = corrections.find(coarse_index);
+    // not a property of the grids, nothing to cache
+    if (found == corrections.end())
+      return nullptr;
+    // the local dof numbering only depends on the local grid
+    const auto& local_space = found->second->space();
+    auto& cell_multiplicities = multiplicities[coarse_index];
+
+    for (const auto& local_entity : Dune::elements(local_space.grid_view())) {
+      // oversampling
+      if (!LocalGridList::covers_strict(coarse_entity, local_entity))
+        return map;
+      if (!fine_cells.find(local_entity.geometry().center(), fine_seed))
+        return map;
+      const auto fine_entity = fine_grid.entity(fine_seed);
+      const auto local_points = global_evaluation_points(local_space, local_entity);
+      const auto fine_points = global_evaluation_points(space, fine_entity);
+      if (local_points.size() != fine_points.size())
+        return map;
+      const auto local_dofs = local_space.mapper().globalIndices(local_entity);
+      const auto fine_dofs = space.mapper().globalIndices(fine_entity);
+      for (auto i : Dune::XT::Common::value_range(local_points.size())) {
+        const auto match = std::find_if(fine_points.begin(), fine_points.end(), [&](const CommonTraits::DomainType& p) {
+          return Dune::XT::Common::FloatCmp::eq(p, local_points[i]);
+        });
+        if (match == fine_points.end())
+          return map;
+        const auto fine_dof = fine_dofs[std::distance(fine_points.begin(), match)];
+        ++cell_multiplicities[std::make_pair(std::size_t(local_dofs[i]), std::size_t(fine_dof))];
+        ++incidences[fine_dof];
+      }
+    }
+  }
+
+  for (const auto& cell : multiplicities) {
+    auto& transfers = map->transfers[cell.first];
+    transfers.reserve(cell.second.size());
+    for (const auto& multiplicity : cell.second) {
+      const auto fine_dof = multiplicity.first.second;
+      transfers.push_back(NestedProjectionMap::Transfer{
+          multiplicity.first.first, fine_dof, double(multiplicity.second) / double(incidences[fine_dof])});
+    }
+  }
+  map->nested = true;
+  return map;
+}
+
 void Dune::Multiscale::MsFEMProjection::preprocess(Dune::Multiscale::CommonTraits::DiscreteFunctionType& func)
 {
   // set all DoFs to zero
@@ -63,26 +193,28 @@ void Dune::Multiscale::MsFEMProjection::preprocess(Dune::Multiscale::CommonTrait
 
 void Dune::Multiscale::MsFEMProjection::postprocess(Dune::Multiscale::CommonTraits::DiscreteFunctionType& func)
 {
-  // compute node to entity relations
-  std::vector<int> nodeToEntity(func.space().grid_view().grid().size(CommonTraits::world_dim), 0);
-  identifySharedNodes(func.space().grid_view(), nodeToEntity);
+  // compute node to entity relations, over the elements project_generic and nested_map sum over
+  const auto& grid = func.space().grid_view().grid();
+  std::vector<int> nodeToEntity(grid.size(CommonTraits::world_dim), 0);
+  identifySharedNodes(grid.leafGridView<CommonTraits::InteriorBorderPartition>(), nodeToEntity);
 
   auto factorsIt = nodeToEntity.begin();
   for (auto& dit : func.vector()) {
     assert(factorsIt != nodeToEntity.end());
-    assert(*factorsIt > 0);
-    dit /= *factorsIt;
+    // nodes of overlap elements only are not projected
+    if (*factorsIt > 0)
+      dit /= *factorsIt;
     ++factorsIt;
   }
   return;
 }
 
 void Dune::Multiscale::MsFEMProjection::identifySharedNodes(
-    const Dune::Multiscale::CommonTraits::GridViewType& gridPart, std::vector<int>& map)
+    const Dune::Multiscale::CommonTraits::InteriorGridViewType& gridPart, std::vector<int>& map)
 {
   const auto& indexSet = gridPart.indexSet();
 
-  for (const auto& entity : Dune::elements(gridPart.grid().leafGridView())) {
+  for (const auto& entity : Dune::elements(gridPart)) {
     const auto number_of_nodes_in_entity = entity.template count<CommonTraits::world_dim>();
     for (auto i : Dune::XT::Common::value_range(number_of_nodes_in_entity)) {
       const auto node = entity.template subEntity<CommonTraits::world_dim>(i);
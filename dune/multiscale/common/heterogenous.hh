@@ -16,6 +16,11 @@
 #include <dune/gdt/spaces/cg/interface.hh>
 #include <dune/multiscale/common/traits.hh>
 
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <vector>
+
 namespace Dune {
 namespace Multiscale {
 
@@ -37,6 +42,27 @@ std::vector<typename GDT::Spaces::CGInterface<ImpTraits, domainDim, rangeDim, 1>
   return points;
 }
 
+/** \brief how the local correction dofs of each coarse cell map onto the dofs of a fine grid
+ *
+ * Only depends on the grids, MsFEMProjection computes it once per local grid list and fine grid and caches it in the
+ * LocalGridList.
+ */
+struct NestedProjectionMap
+{
+  struct Transfer
+  {
+    std::size_t local_dof;
+    std::size_t fine_dof;
+    //! share of the fine dof's incident fine elements that lie in the coarse cell and contain the local dof
+    double weight;
+  };
+
+  //! false if the local grids are not nested in the fine grid, the generic projection is needed then
+  bool nested = false;
+  //! by coarse cell index
+  std::map<std::size_t, std::vector<Transfer>> transfers;
+};
+
 class MsFEMProjection
 {
 public:
@@ -44,9 +70,20 @@ public:
   static void project(LocalsolutionProxy& source, CommonTraits::DiscreteFunctionType& target);
 
 protected:
+  /** \brief copy local correction dofs directly into target's dofs
+   * Only possible if each local grid is exactly the part of target's grid inside its coarse cell, i.e. without
+   * oversampling and with matching micro and fine grids. The result equals project_generic's: a dof shared by
+   * several fine elements gets the average of the values of the corrections of their coarse cells.
+   * \return false, with target unchanged, if the grids are not nested like that
+   */
+  static bool project_nested(const LocalsolutionProxy& source, CommonTraits::DiscreteFunctionType& target);
+  //! evaluates source at target's Lagrange points, searching the local grids, for any grids
+  static void project_generic(LocalsolutionProxy& source, CommonTraits::DiscreteFunctionType& target);
+  static std::shared_ptr<const NestedProjectionMap> nested_map(const LocalsolutionProxy& source,
+                                                               const CommonTraits::SpaceType& space);
   static void preprocess(CommonTraits::DiscreteFunctionType& func);
   static void postprocess(CommonTraits::DiscreteFunctionType& func);
-  static void identifySharedNodes(const CommonTraits::GridViewType& gridPart, std::vector<int>& map);
+  static void identifySharedNodes(const CommonTraits::InteriorGridViewType& gridPart, std::vector<int>& map);
 };
 
 } // namespace Multiscale
@@ -15,6 +15,10 @@
 #include <dune/multiscale/tools/misc.hh>
 #include <dune/multiscale/msfem/localproblems/localgridlist.hh>
 #include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/coarse_scatter.hh>
+#include <dune/xt/common/memory.hh>
+#include <dune/geometry/quadraturerules.hh>
 
 namespace Dune {
 namespace Multiscale {
@@ -24,7 +28,13 @@ size_t RhsCodim0Integral::numTmpObjectsRequired() const
   return numTmpObjectsRequired_;
 }
 
-void RhsCodim0Integral::apply(MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
+size_t RhsCodim0Integral::integrand_order(const DMP::DiffusionBase& diffusion,
+                                          const TestLocalfunctionSetInterfaceType& testBase) const
+{
+  return diffusion.order() + testBase.order() + over_integrate_;
+}
+
+void RhsCodim0Integral::apply(const MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
                               LocalproblemSolutionManager& localSolutionManager,
                               const MsFEMTraits::LocalEntityType& localGridEntity,
                               const RhsCodim0Integral::TestLocalfunctionSetInterfaceType& testBase,
@@ -32,15 +42,15 @@ void RhsCodim0Integral::apply(MsFEMTraits::LocalGridDiscreteFunctionType& dirich
                               std::vector<Dune::DynamicVector<CommonTraits::RangeFieldType>>& /*tmpLocalVectors*/) const
 {
   const auto& f = problem_.getSource();
-  const auto& diffusion = problem_.getDiffusion();
+  // the tensors cached while solving this cell's local problems, if enabled
+  const auto& diffusion = localSolutionManager.diffusion(problem_.getDiffusion());
 
   // quadrature
   typedef Dune::QuadratureRules<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureRules;
   typedef Dune::QuadratureRule<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureType;
-  const size_t integrand_order = diffusion.order() + testBase.order() + over_integrate_;
-  assert(integrand_order < std::numeric_limits<int>::max());
-  const VolumeQuadratureType& volumeQuadrature =
-      VolumeQuadratureRules::rule(localGridEntity.type(), int(integrand_order));
+  const size_t order = integrand_order(diffusion, testBase);
+  assert(order < std::numeric_limits<int>::max());
+  const VolumeQuadratureType& volumeQuadrature = VolumeQuadratureRules::rule(localGridEntity.type(), int(order));
   // check matrix and tmp storage
   const size_t numLocalBaseFunctions = testBase.size();
 
@@ -66,6 +76,30 @@ void RhsCodim0Integral::apply(MsFEMTraits::LocalGridDiscreteFunctionType& dirich
 
   RangeType f_x;
   const auto dirichletExtensionLF = dirichletExtension.local_function(localGridEntity);
+  // the boundary condition fluxes of all quadrature points, with one diffusion evaluation
+  std::vector<DMP::DomainType> global_points;
+  std::vector<JacobianRangeType> directions;
+  global_points.reserve(numQuadraturePoints);
+  directions.reserve(numQuadraturePoints);
+  std::size_t quadraturePoint = 0;
+  for (const auto& quadPoint : volumeQuadrature) {
+    const auto x = quadPoint.position();
+    global_points.push_back(localGridEntity.geometry().global(x));
+    JacobianRangeType directionOfFlux(0.0);
+    //! @attention At this point we assume, that the quadrature points on the subgrid and hostgrid
+    //! are the same (dirichletExtensionLF is a localfunction on the hostgrid, quadPoint stems from
+    //! a quadrature on the subgrid)!!
+    dirichletExtensionLF->jacobian(x, directionOfFlux);
+    // add dirichlet-corrector
+    directionOfFlux += allLocalSolutionJacobians[numLocalBaseFunctions + 1][quadraturePoint];
+    // subtract neumann-corrector
+    directionOfFlux -= allLocalSolutionJacobians[numLocalBaseFunctions][quadraturePoint];
+    directions.push_back(directionOfFlux);
+    ++quadraturePoint;
+  }
+  std::vector<JacobianRangeType> diffusive_fluxes;
+  diffusion.diffusiveFlux_batch(global_points, directions, diffusive_fluxes);
+
   // loop over all quadrature points
   const auto quadPointEndIt = volumeQuadrature.end();
   std::size_t localQuadraturePoint = 0;
@@ -77,35 +111,22 @@ void RhsCodim0Integral::apply(MsFEMTraits::LocalGridDiscreteFunctionType& dirich
     // integration factors
     const double integrationFactor = localGridEntity.geometry().integrationElement(x);
     const double quadratureWeight = quadPointIt->weight();
-    const auto quadPointGlobal = localGridEntity.geometry().global(x);
+    const auto& quadPointGlobal = global_points[localQuadraturePoint];
+
+    assert(localSolutions.size() == numLocalBaseFunctions + localSolutionManager.numBoundaryCorrectors());
+    // element part of boundary conditions, the same for all coarse base functions
+    const auto& diffusive_flux = diffusive_fluxes[localQuadraturePoint];
+    f.evaluate(quadPointGlobal, f_x);
 
     // compute integral
     for (size_t ii = 0; ii < numLocalBaseFunctions; ++ii) {
       auto& retRow = ret[ii];
-      JacobianRangeType diffusive_flux(0.0);
-
       JacobianRangeType reconstructionGradPhi(coarseBaseJacs[ii]);
       RangeType reconstructionPhi(coarseBaseEvals[ii]);
-
-      assert(localSolutions.size() == numLocalBaseFunctions + localSolutionManager.numBoundaryCorrectors());
       // local corrector for coarse base func
       reconstructionPhi += allLocalSolutionEvaluations[ii][localQuadraturePoint];
-      // element part of boundary conditions
-      JacobianRangeType directionOfFlux(0.0);
-      //! @attention At this point we assume, that the quadrature points on the subgrid and hostgrid
-      //! are the same (dirichletExtensionLF is a localfunction on the hostgrid, quadPoint stems from
-      //! a quadrature on the subgrid)!!
-      dirichletExtensionLF->jacobian(x, directionOfFlux);
-      // add dirichlet-corrector
-      directionOfFlux += allLocalSolutionJacobians[numLocalBaseFunctions + 1][localQuadraturePoint];
-      // subtract neumann-corrector
-      directionOfFlux -= allLocalSolutionJacobians[numLocalBaseFunctions][localQuadraturePoint];
-
-      diffusion.diffusiveFlux(quadPointGlobal, directionOfFlux, diffusive_flux);
       reconstructionGradPhi += allLocalSolutionJacobians[ii][localQuadraturePoint];
 
-      f.evaluate(quadPointGlobal, f_x);
-
       retRow += integrationFactor * quadratureWeight * (f_x * reconstructionPhi);
       retRow -= integrationFactor * quadratureWeight * (diffusive_flux[0] * reconstructionGradPhi[0]);
     } // compute integral
@@ -129,14 +150,26 @@ void RhsCodim0Vector::assembleLocal(
   assert(tmpLocalVectorContainer[0].size() >= numTmpObjectsRequired_);
   assert(tmpLocalVectorContainer[1].size() >= localFunctional_.numTmpObjectsRequired());
 
-  Multiscale::LocalproblemSolutionManager localSolutionManager(testSpace, coarse_grid_entity, localGridList_);
-  localSolutionManager.load();
+  std::unique_ptr<LocalproblemSolutionManager> stored(nullptr);
+  if (!stream_) {
+    stored = Dune::XT::Common::make_unique<LocalproblemSolutionManager>(testSpace, coarse_grid_entity, localGridList_);
+    stored->load();
+  }
+  auto& localSolutionManager = stream_ ? stream_->get(testSpace, coarse_grid_entity) : *stored;
   const auto& localSolutions = localSolutionManager.getLocalSolutions();
   assert(localSolutions.size() > 0);
 
   MsFEMTraits::LocalGridDiscreteFunctionType dirichletExtension(localSolutionManager.space(), "Dirichlet Extension");
   //! \todo fill with actual values
 
+  const size_t size = testSpace.mapper().numDofs(coarse_grid_entity);
+  assert(tmpIndices.size() >= size);
+  testSpace.mapper().globalIndices(coarse_grid_entity, tmpIndices);
+  const auto testBase = testSpace.base_function_set(coarse_grid_entity);
+  // the whole coarse element vector is accumulated before it is added to the global system once
+  auto& elementVector = tmpLocalVectorContainer[0][1];
+  elementVector *= 0.0;
+
   for (const auto& localGridEntity : Dune::elements(localSolutionManager.space().grid_view())) {
     // ignore overlay elements
     if (!localGridList_.covers(coarse_grid_entity, localGridEntity))
@@ -147,31 +180,72 @@ void RhsCodim0Vector::assembleLocal(
     localVector *= 0.0;
     auto& tmpFunctionalVectors = tmpLocalVectorContainer[1];
     // apply local functional (result is in localVector)
-    localFunctional_.apply(dirichletExtension,
-                           localSolutionManager,
-                           localGridEntity,
-                           testSpace.base_function_set(coarse_grid_entity),
-                           localVector,
-                           tmpFunctionalVectors);
-    // write local vector to global
-    const size_t size = testSpace.mapper().numDofs(coarse_grid_entity);
-    assert(tmpIndices.size() >= size);
-    testSpace.mapper().globalIndices(coarse_grid_entity, tmpIndices);
-    for (size_t ii = 0; ii < size; ++ii) {
-      systemVector.add_to_entry(tmpIndices[ii], localVector[ii]);
-    } // write local matrix to global
+    localFunctional_.apply(
+        dirichletExtension, localSolutionManager, localGridEntity, testBase, localVector, tmpFunctionalVectors);
+    for (size_t ii = 0; ii < size; ++ii)
+      elementVector[ii] += localVector[ii];
   }
+  const auto coarse_index = testSpace.grid_view().indexSet().index(coarse_grid_entity);
+  scatter_.add(coarse_index, tmpIndices, size, elementVector, systemVector);
+}
+
+NeumannFaceVector::NeumannFaceVector(const Problem::NeumannDataBase& neumann,
+                                     const CommonTraits::SpaceType& space,
+                                     CommonTraits::GdtVectorType& vector,
+                                     CoarseElementScatter& scatter)
+  : neumann_(neumann)
+  , space_(space)
+  , vector_(vector)
+  , scatter_(scatter)
+{
+}
+
+Dune::DynamicVector<CommonTraits::RangeFieldType>
+NeumannFaceVector::face_vector(const IntersectionType& intersection, const EntityType& inside_entity) const
+{
+  typedef Dune::QuadratureRules<CommonTraits::DomainFieldType, CommonTraits::dimDomain - 1> FaceQuadratureRules;
+  const auto testBase = space_.base_function_set(inside_entity);
+  const auto& faceQuadrature =
+      FaceQuadratureRules::rule(intersection.type(), int(neumann_.order() + testBase.order()));
+  const auto& faceGeometry = intersection.geometry();
+  const auto& geometryInInside = intersection.geometryInInside();
+  Dune::DynamicVector<CommonTraits::RangeFieldType> ret(testBase.size(), 0.);
+  Problem::NeumannDataBase::RangeType g_x;
+  for (const auto& quadPoint : faceQuadrature) {
+    const auto x = quadPoint.position();
+    const double factor = faceGeometry.integrationElement(x) * quadPoint.weight();
+    neumann_.evaluate(faceGeometry.global(x), g_x);
+    const auto baseEvals = testBase.evaluate(geometryInInside.global(x));
+    for (size_t ii = 0; ii < testBase.size(); ++ii)
+      ret[ii] += factor * (g_x * baseEvals[ii]);
+  }
+  return ret;
+}
+
+void NeumannFaceVector::apply_local(const IntersectionType& intersection,
+                                    const EntityType& inside_entity,
+                                    const EntityType& /*outside_entity*/)
+{
+  const auto faceVector = face_vector(intersection, inside_entity);
+  const auto size = faceVector.size();
+  Dune::DynamicVector<size_t> indices(size, 0);
+  space_.mapper().globalIndices(inside_entity, indices);
+  const auto coarse_index = space_.grid_view().indexSet().index(inside_entity);
+  scatter_.add(coarse_index, indices, size, faceVector, vector_, true);
 }
 
 CoarseRhsFunctional::CoarseRhsFunctional(const DMP::ProblemContainer& problem,
                                          CoarseRhsFunctional::VectorType& vec,
                                          const CoarseRhsFunctional::SpaceType& spc,
                                          LocalGridList& localGridList,
-                                         const CommonTraits::InteriorGridViewType& interior)
+                                         const CommonTraits::InteriorGridViewType& interior,
+                                         CoarseElementScatter& scatter,
+                                         LocalSolutionStream* stream)
   : FunctionalBaseType(vec, spc, interior)
   , AssemblerBaseType(spc, interior)
   , local_functional_(problem)
-  , local_assembler_(local_functional_, localGridList)
+  , scatter_(scatter)
+  , local_assembler_(local_functional_, localGridList, scatter, stream)
 {
   this->add_codim0_assembler(local_assembler_, this->vector());
 }
@@ -179,6 +253,7 @@ CoarseRhsFunctional::CoarseRhsFunctional(const DMP::ProblemContainer& problem,
 void CoarseRhsFunctional::assemble()
 {
   AssemblerBaseType::assemble();
+  scatter_.flush();
 }
 
 } // namespace Multiscale {
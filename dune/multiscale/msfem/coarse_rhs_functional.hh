@@ -14,12 +14,15 @@
 #include <dune/gdt/localfunctional/codim1.hh>
 #include <dune/gdt/localevaluation/product.hh>
 #include <dune/gdt/assembler/system.hh>
+#include <dune/stuff/grid/walker.hh>
 
 namespace Dune {
 namespace Multiscale {
 
 class LocalGridList;
 class LocalproblemSolutionManager;
+class LocalSolutionStream;
+class CoarseElementScatter;
 class RhsCodim0Integral;
 class CoarseRhsFunctional;
 class RhsCodim0Vector;
@@ -61,7 +64,15 @@ public:
 
   size_t numTmpObjectsRequired() const;
 
-  void apply(MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
+  const DMP::ProblemContainer& problem() const
+  {
+    return problem_;
+  }
+
+  //! quadrature order of apply, also used for the load vector of the fused MsFEMCodim0Integral::apply
+  size_t integrand_order(const DMP::DiffusionBase& diffusion, const TestLocalfunctionSetInterfaceType& testBase) const;
+
+  void apply(const MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
              Multiscale::LocalproblemSolutionManager& localSolutionManager,
              const MsFEMTraits::LocalEntityType& localGridEntity,
              const TestLocalfunctionSetInterfaceType& testBase,
@@ -78,9 +89,17 @@ class RhsCodim0Vector // LocalAssemblerType
 public:
   typedef RhsCodim0VectorTraits Traits;
 
-  RhsCodim0Vector(const RhsCodim0Integral& func, LocalGridList& localGridList)
+  /** \param scatter receives the coarse element vector once per coarse cell
+   *  \param stream if given, local solutions are taken from it instead of being loaded from DiscreteFunctionIO
+   */
+  RhsCodim0Vector(const RhsCodim0Integral& func,
+                  LocalGridList& localGridList,
+                  CoarseElementScatter& scatter,
+                  LocalSolutionStream* stream = nullptr)
     : localFunctional_(func)
     , localGridList_(localGridList)
+    , scatter_(scatter)
+    , stream_(stream)
   {
   }
 
@@ -90,7 +109,8 @@ public:
   }
 
 private:
-  static constexpr size_t numTmpObjectsRequired_ = 1;
+  //! one for each micro element, one to accumulate the coarse element vector
+  static constexpr size_t numTmpObjectsRequired_ = 2;
 
 public:
   std::vector<size_t> numTmpObjectsRequired() const;
@@ -105,8 +125,43 @@ public:
 private:
   const RhsCodim0Integral& localFunctional_;
   LocalGridList& localGridList_;
+  CoarseElementScatter& scatter_;
+  LocalSolutionStream* stream_;
 }; // class RhsCodim0Vector
 
+/** \brief Neumann part \int_{\Gamma_N} g \phi_i of the coarse right hand side, with the quadrature order of
+ *  GDT::Functionals::L2Face. Unlike that functional, the face vectors go through the scatter, with the index of the
+ *  inside coarse cell and never retracted.
+ */
+class NeumannFaceVector : public Stuff::Grid::Functor::Codim1<CommonTraits::InteriorGridViewType>
+{
+  typedef Stuff::Grid::Functor::Codim1<CommonTraits::InteriorGridViewType> BaseType;
+
+public:
+  using typename BaseType::EntityType;
+  using typename BaseType::IntersectionType;
+
+  NeumannFaceVector(const Problem::NeumannDataBase& neumann,
+                    const CommonTraits::SpaceType& space,
+                    CommonTraits::GdtVectorType& vector,
+                    CoarseElementScatter& scatter);
+
+  //! face vector of intersection, returned for testing. Thread safe.
+  Dune::DynamicVector<CommonTraits::RangeFieldType> face_vector(const IntersectionType& intersection,
+                                                               const EntityType& inside_entity) const;
+
+  //! adds the face vector of intersection to the scatter. Thread safe.
+  virtual void apply_local(const IntersectionType& intersection,
+                           const EntityType& inside_entity,
+                           const EntityType& outside_entity) override final;
+
+private:
+  const Problem::NeumannDataBase& neumann_;
+  const CommonTraits::SpaceType& space_;
+  CommonTraits::GdtVectorType& vector_;
+  CoarseElementScatter& scatter_;
+}; // class NeumannFaceVector
+
 class CoarseRhsFunctionalTraits
 {
   typedef CommonTraits::GdtVectorType VectorImp;
@@ -149,11 +204,15 @@ public:
   typedef typename Traits::SpaceType SpaceType;
   typedef typename Traits::GridViewType GridViewType;
 
+  /** \param scatter element vectors go through it, flush it after assembly (assemble() does that for standalone use)
+   */
   CoarseRhsFunctional(const Problem::ProblemContainer& problem,
                       VectorType& vec,
                       const SpaceType& spc,
                       LocalGridList& localGridList,
-                      const CommonTraits::InteriorGridViewType& interior);
+                      const CommonTraits::InteriorGridViewType& interior,
+                      CoarseElementScatter& scatter,
+                      LocalSolutionStream* stream = nullptr);
 
   virtual ~CoarseRhsFunctional()
   {
@@ -163,6 +222,7 @@ public:
 
 private:
   const LocalFunctionalType local_functional_;
+  CoarseElementScatter& scatter_;
   const LocalAssemblerType local_assembler_;
 }; // class CoarseRhsFunctional
 
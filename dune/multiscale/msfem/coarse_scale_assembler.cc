@@ -4,6 +4,7 @@
 
 #include <dune/xt/common/configuration.hh>
 #include <dune/xt/common/timings.hh>
+#include <dune/xt/common/memory.hh>
 #include <dune/gdt/operators/projections.hh>
 #include <dune/gdt/operators/prolongations.hh>
 #include <dune/gdt/spaces/constraints.hh>
@@ -12,6 +13,8 @@
 #include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
 #include <dune/multiscale/msfem/localproblems/localgridlist.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/msfem/coarse_rhs_functional.hh>
+#include <dune/multiscale/msfem/coarse_scatter.hh>
 #include <dune/multiscale/problems/base.hh>
 #include <dune/multiscale/problems/selector.hh>
 #include <dune/multiscale/common/df_io.hh>
@@ -21,9 +24,84 @@
 namespace Dune {
 namespace Multiscale {
 
-MsFEMCodim0Integral::MsFEMCodim0Integral(const Problem::DiffusionBase& diffusion, const size_t over_integrate)
+namespace {
+
+typedef CommonTraits::SpaceType::BaseFunctionSetType::RangeType RangeType;
+typedef CommonTraits::SpaceType::BaseFunctionSetType::JacobianRangeType JacobianRangeType;
+typedef Dune::QuadratureRules<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureRules;
+typedef Dune::QuadratureRule<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureType;
+
+//! global positions of a quadrature's points and the local solutions' jacobians (and values) in them
+struct QuadratureEvaluations
+{
+  std::vector<DMP::DomainType> global_points;
+  //! indexed [local solution][quadrature point]
+  std::vector<std::vector<JacobianRangeType>> jacobians;
+  std::vector<std::vector<RangeType>> values;
+
+  //! jacobians of the first numJacobians local solutions, values of the first numValues
+  void evaluate(const VolumeQuadratureType& quadrature,
+                const MsFEMTraits::LocalEntityType& localGridEntity,
+                const MsFEMTraits::LocalSolutionVectorType& localSolutions,
+                const size_t numJacobians,
+                const size_t numValues)
+  {
+    assert(numValues <= numJacobians);
+    const auto numQuadraturePoints = quadrature.size();
+    global_points.clear();
+    global_points.reserve(numQuadraturePoints);
+    for (const auto& quadPoint : quadrature)
+      global_points.push_back(localGridEntity.geometry().global(quadPoint.position()));
+    jacobians.assign(numJacobians, std::vector<JacobianRangeType>(numQuadraturePoints, JacobianRangeType(0.0)));
+    values.assign(numValues, std::vector<RangeType>(numQuadraturePoints, RangeType(0.0)));
+    for (auto lsNum : Dune::XT::Common::value_range(numJacobians)) {
+      const auto localFunction = localSolutions[lsNum]->local_function(localGridEntity);
+      localFunction->jacobian(quadrature, jacobians[lsNum]);
+      if (lsNum < numValues)
+        localFunction->evaluate(quadrature, values[lsNum]);
+    }
+  }
+};
+
+//! true if evaluations in the points of one quadrature can be used for the other
+bool same_points(const VolumeQuadratureType& first, const VolumeQuadratureType& second)
+{
+  if (&first == &second)
+    return true;
+  if (first.size() != second.size())
+    return false;
+  for (auto i : Dune::XT::Common::value_range(first.size()))
+    if (first[i].position() != second[i].position())
+      return false;
+  return true;
+}
+
+/** fluxes[qp * rows + ii] = tensors[qp] * gradients[qp * rows + ii]. Each tensor is reduced once to the entries its
+ * structure allows to be non-zero and then applied to the rows gradients of its quadrature point.
+ */
+template <DMP::TensorStructure structure>
+void apply_tensors(const std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType>& tensors,
+                   const std::size_t rows,
+                   const std::vector<JacobianRangeType>& gradients,
+                   std::vector<JacobianRangeType>& fluxes)
+{
+  assert(gradients.size() == tensors.size() * rows);
+  fluxes.resize(gradients.size());
+  for (std::size_t qp = 0; qp < tensors.size(); ++qp) {
+    const DMP::CompactTensor<structure, CommonTraits::world_dim> tensor(tensors[qp]);
+    for (std::size_t ii = 0; ii < rows; ++ii)
+      tensor.mv(gradients[qp * rows + ii][0], fluxes[qp * rows + ii][0]);
+  }
+}
+
+} // namespace {
+
+MsFEMCodim0Integral::MsFEMCodim0Integral(const Problem::DiffusionBase& diffusion,
+                                         const bool linear,
+                                         const size_t over_integrate)
   : over_integrate_(over_integrate)
   , diffusion_(diffusion)
+  , linear_(linear)
 {
 }
 
@@ -40,11 +118,36 @@ void MsFEMCodim0Integral::apply(
     Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
     std::vector<Dune::DynamicMatrix<CommonTraits::RangeFieldType>>& /*tmpLocalMatrices*/) const
 {
-  const auto& diffusion_operator = diffusion_;
+  integrate(nullptr, nullptr, localSolutionManager, localGridEntity, testBase, ansatzBase, ret, nullptr);
+}
+
+void MsFEMCodim0Integral::apply(const RhsCodim0Integral& rhsIntegral,
+                                const MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
+                                LocalproblemSolutionManager& localSolutionManager,
+                                const MsFEMTraits::LocalEntityType& localGridEntity,
+                                const MsFEMCodim0Integral::TestLocalfunctionSetInterfaceType& testBase,
+                                const MsFEMCodim0Integral::AnsatzLocalfunctionSetInterfaceType& ansatzBase,
+                                Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
+                                Dune::DynamicVector<CommonTraits::RangeFieldType>& rhs) const
+{
+  integrate(&rhsIntegral, &dirichletExtension, localSolutionManager, localGridEntity, testBase, ansatzBase, ret, &rhs);
+}
+
+void MsFEMCodim0Integral::integrate(const RhsCodim0Integral* rhsIntegral,
+                                    const MsFEMTraits::LocalGridDiscreteFunctionType* dirichletExtension,
+                                    LocalproblemSolutionManager& localSolutionManager,
+                                    const MsFEMTraits::LocalEntityType& localGridEntity,
+                                    const MsFEMCodim0Integral::TestLocalfunctionSetInterfaceType& testBase,
+                                    const MsFEMCodim0Integral::AnsatzLocalfunctionSetInterfaceType& ansatzBase,
+                                    Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
+                                    Dune::DynamicVector<CommonTraits::RangeFieldType>* rhs) const
+{
+  const bool with_rhs = rhs != nullptr;
+  assert(!with_rhs || (rhsIntegral && dirichletExtension));
+  // the tensors cached while solving this cell's local problems, if enabled
+  const auto& diffusion_operator = localSolutionManager.diffusion(diffusion_);
 
   // quadrature
-  typedef Dune::QuadratureRules<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureRules;
-  typedef Dune::QuadratureRule<CommonTraits::DomainFieldType, CommonTraits::dimDomain> VolumeQuadratureType;
   const size_t integrand_order = diffusion_operator.order() + ansatzBase.order() + testBase.order() + over_integrate_;
   assert(integrand_order < std::numeric_limits<int>::max());
   const VolumeQuadratureType& volumeQuadrature =
@@ -55,63 +158,144 @@ void MsFEMCodim0Integral::apply(
   ret *= 0.0;
   assert(ret.rows() >= rows);
   assert(ret.cols() >= cols);
+  if (with_rhs) {
+    assert(rhs->size() >= rows);
+    *rhs *= 0.0;
+  }
 
   const auto numQuadraturePoints = volumeQuadrature.size();
   const auto& localSolutions = localSolutionManager.getLocalSolutions();
   // number of local solutions without the boundary correctors. Those are only needed for the right hand side
   const auto numLocalSolutions = localSolutions.size() - localSolutionManager.numBoundaryCorrectors();
-  typedef CommonTraits::SpaceType::BaseFunctionSetType::RangeType RangeType;
-  typedef CommonTraits::SpaceType::BaseFunctionSetType::JacobianRangeType JacobianRangeType;
-  // evaluate the jacobians of all local solutions in all quadrature points
-  std::vector<std::vector<JacobianRangeType>> allLocalSolutionEvaluations(
-      numLocalSolutions, std::vector<JacobianRangeType>(numQuadraturePoints, RangeType(0.0)));
-  for (auto lsNum : Dune::XT::Common::value_range(numLocalSolutions)) {
-    const auto localFunction = localSolutions[lsNum]->local_function(localGridEntity);
-    //      assert(localSolutionManager.space().indexSet().contains(localGridEntity));
-    localFunction->jacobian(volumeQuadrature, allLocalSolutionEvaluations[lsNum]);
+  assert(numLocalSolutions == rows /*numMacroBaseFunctions*/);
+  // the load vector is integrated exactly like RhsCodim0Integral::apply does it
+  const VolumeQuadratureType& rhsQuadrature =
+      with_rhs ? VolumeQuadratureRules::rule(localGridEntity.type(),
+                                             int(rhsIntegral->integrand_order(diffusion_operator, testBase)))
+               : volumeQuadrature;
+  const bool shared_points = with_rhs && same_points(volumeQuadrature, rhsQuadrature);
+  QuadratureEvaluations evaluations;
+  evaluations.evaluate(volumeQuadrature,
+                       localGridEntity,
+                       localSolutions,
+                       shared_points ? localSolutions.size() : numLocalSolutions,
+                       shared_points ? numLocalSolutions : 0);
+
+  // gradients of the reconstructed base functions (coarse base function plus corrector) in all quadrature points
+  std::vector<JacobianRangeType> reconstructionGradPhi;
+  reconstructionGradPhi.reserve(numQuadraturePoints * rows);
+  std::size_t localQuadraturePoint = 0;
+  for (const auto& quadPoint : volumeQuadrature) {
+    const auto coarseBaseJacs = testBase.jacobian(quadPoint.position());
+    for (size_t ii = 0; ii < rows; ++ii) {
+      reconstructionGradPhi.push_back(coarseBaseJacs[ii]);
+      reconstructionGradPhi.back() += evaluations.jacobians[ii][localQuadraturePoint];
+    }
+    ++localQuadraturePoint;
+  }
+  // and their fluxes. A linear diffusion is evaluated once per quadrature point and applied with the loop for its
+  // structure, a nonlinear flux depends on the gradient and needs each point once per base function
+  std::vector<JacobianRangeType> diffusive_fluxes;
+  if (linear_) {
+    std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType> tensors;
+    diffusion_operator.evaluate_batch(evaluations.global_points, tensors);
+    switch (diffusion_operator.structure()) {
+      case DMP::TensorStructure::isotropic:
+        apply_tensors<DMP::TensorStructure::isotropic>(tensors, rows, reconstructionGradPhi, diffusive_fluxes);
+        break;
+      case DMP::TensorStructure::diagonal:
+        apply_tensors<DMP::TensorStructure::diagonal>(tensors, rows, reconstructionGradPhi, diffusive_fluxes);
+        break;
+      case DMP::TensorStructure::full:
+        apply_tensors<DMP::TensorStructure::full>(tensors, rows, reconstructionGradPhi, diffusive_fluxes);
+        break;
+    }
+  } else {
+    std::vector<DMP::DomainType> flux_points;
+    flux_points.reserve(numQuadraturePoints * rows);
+    for (const auto& global_point : evaluations.global_points)
+      flux_points.insert(flux_points.end(), rows, global_point);
+    diffusion_operator.diffusiveFlux_batch(flux_points, reconstructionGradPhi, diffusive_fluxes);
   }
 
   // loop over all quadrature points
-  const auto quadPointEndIt = volumeQuadrature.end();
-  std::size_t localQuadraturePoint = 0;
-  for (auto quadPointIt = volumeQuadrature.begin(); quadPointIt != quadPointEndIt;
-       ++quadPointIt, ++localQuadraturePoint) {
-    const auto x = quadPointIt->position();
-    const auto coarseBaseJacs = testBase.jacobian(x);
+  localQuadraturePoint = 0;
+  for (const auto& quadPoint : volumeQuadrature) {
+    const auto x = quadPoint.position();
     // integration factors
     const double integrationFactor = localGridEntity.geometry().integrationElement(x);
-    const double quadratureWeight = quadPointIt->weight();
-    const auto global_point_in_U_T = localGridEntity.geometry().global(x);
-    CommonTraits::DiffusionFunctionBaseType::RangeType diffusion_eval;
-    diffusion_operator.evaluate(global_point_in_U_T, diffusion_eval);
+    const double quadratureWeight = quadPoint.weight();
+    const auto offset = localQuadraturePoint * rows;
     // compute integral
     for (size_t ii = 0; ii < rows; ++ii) {
       for (size_t jj = 0; jj < cols; ++jj) {
-        // Compute the gradients of the i'th and j'th local problem solutions
-        assert(allLocalSolutionEvaluations.size() == rows /*numMacroBaseFunctions*/);
-        const auto& gradLocProbSoli = allLocalSolutionEvaluations[ii][localQuadraturePoint];
-        const auto& gradLocProbSolj = allLocalSolutionEvaluations[jj][localQuadraturePoint];
-
-        auto reconstructionGradPhii = coarseBaseJacs[ii];
-        reconstructionGradPhii += gradLocProbSoli;
-        auto reconstructionGradPhij = coarseBaseJacs[jj];
-        reconstructionGradPhij += gradLocProbSolj;
-
-        const auto& arg = reconstructionGradPhii[0];
-        CommonTraits::DiffusionFunctionBaseType::RangeType::row_type diffusive_flux;
-        diffusion_eval.mv(arg, diffusive_flux);
-        const RangeType local_integral = diffusive_flux * reconstructionGradPhij[0];
+        const RangeType local_integral = diffusive_fluxes[offset + ii][0] * reconstructionGradPhi[offset + jj][0];
         //! TODO check indexing. Correct wrt pre-gdt, but still
         ret[jj][ii] += local_integral * integrationFactor * quadratureWeight;
       }
     } // compute integral
+    ++localQuadraturePoint;
+  } // loop over all quadrature points
+
+  if (!with_rhs)
+    return;
+  if (!shared_points)
+    evaluations.evaluate(rhsQuadrature, localGridEntity, localSolutions, localSolutions.size(), numLocalSolutions);
+  const auto dirichletExtensionLF = dirichletExtension->local_function(localGridEntity);
+  // element part of boundary conditions in all quadrature points, see RhsCodim0Integral::apply
+  std::vector<JacobianRangeType> directions;
+  directions.reserve(rhsQuadrature.size());
+  localQuadraturePoint = 0;
+  for (const auto& quadPoint : rhsQuadrature) {
+    JacobianRangeType directionOfFlux(0.0);
+    dirichletExtensionLF->jacobian(quadPoint.position(), directionOfFlux);
+    // add dirichlet-corrector
+    directionOfFlux += evaluations.jacobians[numLocalSolutions + 1][localQuadraturePoint];
+    // subtract neumann-corrector
+    directionOfFlux -= evaluations.jacobians[numLocalSolutions][localQuadraturePoint];
+    directions.push_back(directionOfFlux);
+    ++localQuadraturePoint;
+  }
+  std::vector<JacobianRangeType> boundary_fluxes;
+  diffusion_operator.diffusiveFlux_batch(evaluations.global_points, directions, boundary_fluxes);
+
+  const auto& f = rhsIntegral->problem().getSource();
+  RangeType f_x;
+  localQuadraturePoint = 0;
+  for (const auto& quadPoint : rhsQuadrature) {
+    const auto x = quadPoint.position();
+    const auto coarseBaseJacs = testBase.jacobian(x);
+    const auto coarseBaseEvals = testBase.evaluate(x);
+    const double integrationFactor = localGridEntity.geometry().integrationElement(x);
+    const double quadratureWeight = quadPoint.weight();
+    const auto& boundary_flux = boundary_fluxes[localQuadraturePoint];
+    f.evaluate(evaluations.global_points[localQuadraturePoint], f_x);
+    for (size_t ii = 0; ii < rows; ++ii) {
+      JacobianRangeType gradient(coarseBaseJacs[ii]);
+      gradient += evaluations.jacobians[ii][localQuadraturePoint];
+      RangeType reconstructionPhi(coarseBaseEvals[ii]);
+      reconstructionPhi += evaluations.values[ii][localQuadraturePoint];
+      (*rhs)[ii] += integrationFactor * quadratureWeight * (f_x * reconstructionPhi);
+      (*rhs)[ii] -= integrationFactor * quadratureWeight * (boundary_flux[0] * gradient[0]);
+    }
+    ++localQuadraturePoint;
   } // loop over all quadrature points
 }
 
-MsFemCodim0Matrix::MsFemCodim0Matrix(const MsFemCodim0Matrix::LocalOperatorType& op, LocalGridList& localGridList)
+MsFemCodim0Matrix::MsFemCodim0Matrix(const MsFemCodim0Matrix::LocalOperatorType& op,
+                                     LocalGridList& localGridList,
+                                     CoarseElementScatter& scatter,
+                                     LocalSolutionStream* stream,
+                                     const RhsCodim0Integral* rhsFunctional,
+                                     CommonTraits::GdtVectorType* rhsVector)
   : localOperator_(op)
   , localGridList_(localGridList)
+  , scatter_(scatter)
+  , stream_(stream)
+  , rhsFunctional_(rhsFunctional)
+  , rhsVector_(rhsVector)
 {
+  assert(!rhsVector_ == !rhsFunctional_);
 }
 
 const MsFemCodim0Matrix::LocalOperatorType& MsFemCodim0Matrix::localOperator() const
@@ -137,13 +321,51 @@ void MsFemCodim0Matrix::assembleLocal(
   assert(tmpLocalMatricesContainer[0].size() >= numTmpObjectsRequired_);
   assert(tmpLocalMatricesContainer[1].size() >= localOperator_.numTmpObjectsRequired());
   assert(tmpIndicesContainer.size() >= 2);
-  // get and clear matrix
+  const bool with_rhs = rhsVector_ != nullptr;
+  const auto coarse_index = testSpace.grid_view().indexSet().index(coarse_grid_entity);
+
+  std::unique_ptr<LocalproblemSolutionManager> stored(nullptr);
+  if (!stream_) {
+    stored = Dune::XT::Common::make_unique<LocalproblemSolutionManager>(testSpace, coarse_grid_entity, localGridList_);
+    // the correctors are not needed if the element matrix was already computed with the local problems
+    if (!stored->coarse_matrix() || with_rhs)
+      stored->load();
+  }
+  auto& localSolutionManager = stream_ ? stream_->get(testSpace, coarse_grid_entity) : *stored;
+
+  auto& globalRows = tmpIndicesContainer[0];
+  auto& globalCols = tmpIndicesContainer[1];
+  const size_t rows = testSpace.mapper().numDofs(coarse_grid_entity);
+  const size_t cols = ansatzSpace.mapper().numDofs(coarse_grid_entity);
+  assert(globalRows.size() >= rows);
+  assert(globalCols.size() >= cols);
+  testSpace.mapper().globalIndices(coarse_grid_entity, globalRows);
+  ansatzSpace.mapper().globalIndices(coarse_grid_entity, globalCols);
+  const auto coarse_matrix = localSolutionManager.coarse_matrix();
+  if (coarse_matrix) {
+    assert(coarse_matrix->rows() == rows && coarse_matrix->cols() == cols);
+    scatter_.add(coarse_index, globalRows, globalCols, rows, cols, *coarse_matrix, systemMatrix);
+    if (!with_rhs)
+      return;
+  }
 
-  Multiscale::LocalproblemSolutionManager localSolutionManager(testSpace, coarse_grid_entity, localGridList_);
-  localSolutionManager.load();
   const auto& localSolutions = localSolutionManager.getLocalSolutions();
   assert(localSolutions.size() > 0);
 
+  const auto testBase = testSpace.base_function_set(coarse_grid_entity);
+  const auto ansatzBase = ansatzSpace.base_function_set(coarse_grid_entity);
+  std::unique_ptr<MsFEMTraits::LocalGridDiscreteFunctionType> dirichletExtension(nullptr);
+  Dune::DynamicVector<CommonTraits::RangeFieldType> localVector(with_rhs ? rows : 0);
+  // the whole coarse element matrix/vector is accumulated before it is added to the global system once
+  auto& elementMatrix = tmpLocalMatricesContainer[0][1];
+  elementMatrix *= 0.0;
+  Dune::DynamicVector<CommonTraits::RangeFieldType> elementVector(with_rhs ? rows : 0, 0.0);
+  std::vector<Dune::DynamicVector<CommonTraits::RangeFieldType>> tmpFunctionalVectors;
+  if (with_rhs)
+    // zero, like the one of RhsCodim0Vector::assembleLocal, so both paths assemble the same load vector
+    dirichletExtension = Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(
+        localSolutionManager.space(), "Dirichlet Extension");
+
   for (const auto& localGridEntity : Dune::elements(localSolutionManager.space().grid_view())) {
     // ignore overlay elements
     if (!localGridList_.covers(coarse_grid_entity, localGridEntity))
@@ -152,34 +374,36 @@ void MsFemCodim0Matrix::assembleLocal(
     auto& localMatrix = tmpLocalMatricesContainer[0][0];
     localMatrix *= 0.0;
     auto& tmpOperatorMatrices = tmpLocalMatricesContainer[1];
-    // apply local operator (result is in localMatrix)
-    localOperator_.apply(localSolutionManager,
-                         localGridEntity,
-                         testSpace.base_function_set(coarse_grid_entity),
-                         ansatzSpace.base_function_set(coarse_grid_entity),
-                         localMatrix,
-                         tmpOperatorMatrices);
-    // write local matrix to global
-    auto& globalRows = tmpIndicesContainer[0];
-    auto& globalCols = tmpIndicesContainer[1];
-    const size_t rows = testSpace.mapper().numDofs(coarse_grid_entity);
-    const size_t cols = ansatzSpace.mapper().numDofs(coarse_grid_entity);
-    assert(globalRows.size() >= rows);
-    assert(globalCols.size() >= cols);
-    testSpace.mapper().globalIndices(coarse_grid_entity, globalRows);
-    ansatzSpace.mapper().globalIndices(coarse_grid_entity, globalCols);
-    for (size_t ii = 0; ii < rows; ++ii) {
-      const auto& localRow = localMatrix[ii];
-      const size_t globalII = globalRows[ii];
-      for (size_t jj = 0; jj < cols; ++jj) {
-        const size_t globalJJ = globalCols[jj];
-        systemMatrix.add_to_entry(globalII, globalJJ, localRow[jj]);
-      }
-    } // write local matrix to global
+    // apply local operator (result is in localMatrix and, if fused, localVector)
+    if (coarse_matrix)
+      rhsFunctional_->apply(
+          *dirichletExtension, localSolutionManager, localGridEntity, testBase, localVector, tmpFunctionalVectors);
+    else if (with_rhs)
+      localOperator_.apply(*rhsFunctional_,
+                           *dirichletExtension,
+                           localSolutionManager,
+                           localGridEntity,
+                           testBase,
+                           ansatzBase,
+                           localMatrix,
+                           localVector);
+    else
+      localOperator_.apply(
+          localSolutionManager, localGridEntity, testBase, ansatzBase, localMatrix, tmpOperatorMatrices);
+
+    if (!coarse_matrix)
+      for (size_t ii = 0; ii < rows; ++ii)
+        for (size_t jj = 0; jj < cols; ++jj)
+          elementMatrix[ii][jj] += localMatrix[ii][jj];
+    if (with_rhs)
+      elementVector += localVector;
   }
-}
 
-// constructor
+  if (!coarse_matrix)
+    scatter_.add(coarse_index, globalRows, globalCols, rows, cols, elementMatrix, systemMatrix);
+  if (with_rhs)
+    scatter_.add(coarse_index, globalRows, rows, elementVector, *rhsVector_);
+}
 
 } // namespace Multiscale {
 } // namespace Dune {
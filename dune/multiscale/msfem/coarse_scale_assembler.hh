@@ -10,6 +10,7 @@
 #include <dune/xt/common/logging.hh>
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/problems/base.hh>
 
 namespace Dune {
 namespace Multiscale {
@@ -18,6 +19,9 @@ class MsFEMCodim0Integral;
 class MsFemCodim0Matrix;
 class LocalproblemSolutionManager;
 class LocalGridList;
+class LocalSolutionStream;
+class RhsCodim0Integral;
+class CoarseElementScatter;
 
 class MsFEMCodim0IntegralTraits
 {
@@ -50,7 +54,8 @@ private:
   typedef AnsatzLocalfunctionSetInterfaceType TestLocalfunctionSetInterfaceType;
 
 public:
-  explicit MsFEMCodim0Integral(const DMP::DiffusionBase& diffusion, const size_t over_integrate = 0);
+  //! \param linear the flux is A(x) * gradient, eg. the problem's getModelData().linear()
+  MsFEMCodim0Integral(const DMP::DiffusionBase& diffusion, const bool linear, const size_t over_integrate = 0);
 
   size_t numTmpObjectsRequired() const;
 
@@ -61,9 +66,33 @@ public:
              Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
              std::vector<Dune::DynamicMatrix<CommonTraits::RangeFieldType>>& tmpLocalMatrices) const;
 
+  /** Element matrix as above plus the element load vector of rhsIntegral, in one walk over the local solutions.
+   * The load vector keeps the quadrature order of RhsCodim0Integral::apply, the corrector evaluations are shared
+   * with the matrix if both quadratures have the same points.
+   */
+  void apply(const RhsCodim0Integral& rhsIntegral,
+             const MsFEMTraits::LocalGridDiscreteFunctionType& dirichletExtension,
+             Multiscale::LocalproblemSolutionManager& localSolutionManager,
+             const MsFEMTraits::LocalEntityType& localGridEntity,
+             const TestLocalfunctionSetInterfaceType& testBase,
+             const AnsatzLocalfunctionSetInterfaceType& ansatzBase,
+             Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
+             Dune::DynamicVector<CommonTraits::RangeFieldType>& rhs) const;
+
 private:
+  //! the load vector is skipped if rhs is nullptr
+  void integrate(const RhsCodim0Integral* rhsIntegral,
+                 const MsFEMTraits::LocalGridDiscreteFunctionType* dirichletExtension,
+                 Multiscale::LocalproblemSolutionManager& localSolutionManager,
+                 const MsFEMTraits::LocalEntityType& localGridEntity,
+                 const TestLocalfunctionSetInterfaceType& testBase,
+                 const AnsatzLocalfunctionSetInterfaceType& ansatzBase,
+                 Dune::DynamicMatrix<CommonTraits::RangeFieldType>& ret,
+                 Dune::DynamicVector<CommonTraits::RangeFieldType>* rhs) const;
+
   const size_t over_integrate_;
   const DMP::DiffusionBase& diffusion_;
+  const bool linear_;
 };
 
 class MsFemCodim0Matrix
@@ -72,12 +101,23 @@ public:
   typedef MsFemCodim0MatrixTraits Traits;
   typedef typename Traits::LocalOperatorType LocalOperatorType;
 
-  MsFemCodim0Matrix(const LocalOperatorType& op, LocalGridList& localGridList);
+  /** \param scatter receives the coarse element matrix (and vector) once per coarse cell
+   *  \param stream if given, local solutions are taken from it instead of being loaded from DiscreteFunctionIO
+   *  \param rhsFunctional, rhsVector if given, the element load vectors of rhsFunctional are computed in the same walk
+   *  over each local grid as the element matrices and added to rhsVector (msfem.fused_coarse_assembly)
+   */
+  MsFemCodim0Matrix(const LocalOperatorType& op,
+                    LocalGridList& localGridList,
+                    CoarseElementScatter& scatter,
+                    LocalSolutionStream* stream = nullptr,
+                    const RhsCodim0Integral* rhsFunctional = nullptr,
+                    CommonTraits::GdtVectorType* rhsVector = nullptr);
 
   const LocalOperatorType& localOperator() const;
 
 private:
-  static constexpr size_t numTmpObjectsRequired_ = 1;
+  //! one for each micro element, one to accumulate the coarse element matrix
+  static constexpr size_t numTmpObjectsRequired_ = 2;
 
 public:
   std::vector<size_t> numTmpObjectsRequired() const;
@@ -93,6 +133,10 @@ public:
 private:
   const LocalOperatorType& localOperator_;
   LocalGridList& localGridList_;
+  CoarseElementScatter& scatter_;
+  LocalSolutionStream* stream_;
+  const RhsCodim0Integral* rhsFunctional_;
+  CommonTraits::GdtVectorType* rhsVector_;
 }; // class LocalAssemblerCodim0Matrix
 
 } // namespace Multiscale {
@@ -2,6 +2,7 @@
 
 #include "coarse_scale_operator.hh"
 
+#include <dune/common/timer.hh>
 #include <dune/xt/common/exceptions.hh>
 #include <dune/xt/common/configuration.hh>
 #include <dune/xt/common/timings.hh>
@@ -19,8 +20,17 @@
 #include <dune/multiscale/common/df_io.hh>
 #include <dune/multiscale/tools/misc.hh>
 #include <dune/multiscale/msfem/coarse_rhs_functional.hh>
+#include <dune/multiscale/msfem/offline_archive.hh>
 #include <dune/xt/common/parallel/partitioner.hh>
+#include <dune/xt/common/ranges.hh>
 #include <dune/grid/utility/partitioning/seedlist.hh>
+#include <dune/istl/operators.hh>
+#include <dune/istl/preconditioners.hh>
+#include <dune/istl/solvers.hh>
+#include <dune/istl/paamg/amg.hh>
+#if HAVE_UMFPACK
+#include <dune/istl/umfpack.hh>
+#endif
 #include <sstream>
 
 namespace Dune {
@@ -35,15 +45,28 @@ Stuff::LA::SparsityPatternDefault CoarseScaleOperator::pattern(const CoarseScale
 
 CoarseScaleOperator::CoarseScaleOperator(const DMP::ProblemContainer& problem,
                                          const CoarseScaleOperator::SourceSpaceType& source_space_in,
-                                         LocalGridList& localGridList)
+                                         LocalGridList& localGridList,
+                                         LocalSolutionStream* stream,
+                                         OfflineArchive* archive,
+                                         const bool incremental)
   : OperatorBaseType(global_matrix_, source_space_in)
   , AssemblerBaseType(source_space_in,
                       source_space_in.grid_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>())
   , global_matrix_(
         coarse_space().mapper().size(), coarse_space().mapper().size(), EllipticOperatorType::pattern(coarse_space()))
-  , local_operator_(problem.getDiffusion())
-  , local_assembler_(local_operator_, localGridList)
+  , local_operator_(problem.getDiffusion(), problem.getModelData().linear())
+  , rhs_integral_(problem)
   , msfem_rhs_(coarse_space(), "MsFEM right hand side")
+  , fused_assembly_(problem.config().get("msfem.fused_coarse_assembly", false) && !(archive && archive->online()))
+  , scatter_(problem.config().get("msfem.deterministic_assembly", false), incremental)
+  , incremental_(incremental)
+  , local_grid_list_(localGridList)
+  , local_assembler_(local_operator_,
+                     localGridList,
+                     scatter_,
+                     stream,
+                     fused_assembly_ ? &rhs_integral_ : nullptr,
+                     fused_assembly_ ? &msfem_rhs_.vector() : nullptr)
   , dirichlet_projection_(coarse_space())
   , problem_(problem)
 {
@@ -55,7 +78,8 @@ CoarseScaleOperator::CoarseScaleOperator(const DMP::ProblemContainer& problem,
   typedef std::remove_const<decltype(interior)>::type InteriorType;
   Dune::XT::Common::IndexSetPartitioner<InteriorType> ip(interior.indexSet());
   SeedListPartitioning<typename InteriorType::Grid, 0> partitioning(interior, ip);
-  CoarseRhsFunctional force_functional(problem_, msfem_rhs_.vector(), coarse_space(), localGridList, interior);
+  CoarseRhsFunctional force_functional(
+      problem_, msfem_rhs_.vector(), coarse_space(), localGridList, interior, scatter_, stream);
 
   const auto& dirichlet = problem_.getDirichletData();
   const auto& boundary_info = problem_.getModelData().boundaryInfo();
@@ -66,16 +90,24 @@ CoarseScaleOperator::CoarseScaleOperator(const DMP::ProblemContainer& problem,
                                                  Problem::DirichletDataBase,
                                                  CommonTraits::DiscreteFunctionType>
       dirichlet_projection_operator(interior, boundary_info, dirichlet, dirichlet_projection_);
-  GDT::Functionals::L2Face<Problem::NeumannDataBase, CommonTraits::GdtVectorType, CommonTraits::SpaceType, InteriorView>
-      neumann_functional(neumann, msfem_rhs_.vector(), coarse_space(), interior);
+  NeumannFaceVector neumann_faces(neumann, coarse_space(), msfem_rhs_.vector(), scatter_);
 
-  this->add_codim0_assembler(local_assembler_, this->matrix());
-  this->add(force_functional);
+  // an online archive already has the matrix, only the right hand side is assembled
+  const bool assemble_matrix = !(archive && archive->online());
+  if (assemble_matrix)
+    this->add_codim0_assembler(local_assembler_, this->matrix());
+  // the fused local assembler already adds the element load vectors to msfem_rhs_
+  if (!fused_assembly_)
+    this->add(force_functional);
 
-  this->add(neumann_functional,
-            new DSG::ApplyOn::NeumannIntersections<CommonTraits::InteriorGridViewType>(boundary_info));
+  this->add(neumann_faces, new DSG::ApplyOn::NeumannIntersections<CommonTraits::InteriorGridViewType>(boundary_info));
   this->add(dirichlet_projection_operator, new DSG::ApplyOn::BoundaryEntities<CommonTraits::InteriorGridViewType>());
   AssemblerBaseType::assemble(partitioning);
+  scatter_.flush();
+  if (archive && archive->online())
+    archive->read_matrix(global_matrix_);
+  else if (archive)
+    archive->write_matrix(global_matrix_);
   // substract the operators action on the dirichlet values, since we assemble in H^1 but solve in H^1_0
   CommonTraits::GdtVectorType tmp(coarse_space().mapper().size());
   global_matrix_.mv(dirichlet_projection_.vector(), tmp);
@@ -89,6 +121,87 @@ CoarseScaleOperator::CoarseScaleOperator(const DMP::ProblemContainer& problem,
   else
     AssemblerBaseType::assemble(false);
   dirichlet_constraints.apply(global_matrix_, force_functional.vector());
+  dirichlet_dofs_ = dirichlet_constraints.dirichlet_DoFs();
+  // the constraints only clear rows. The constrained columns multiply zero DoFs, so they are cleared as well to keep
+  // the matrix symmetric for CG
+  if (problem_.getModelData().symmetricDiffusion()) {
+    const auto& constrained = dirichlet_dofs_;
+    auto& backend = global_matrix_.backend();
+    for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it) {
+      if (constrained.count(row_it.index()))
+        continue;
+      for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it)
+        if (constrained.count(col_it.index()))
+          *col_it = 0;
+    }
+  }
+}
+
+void CoarseScaleOperator::update(const std::set<std::size_t>& coarse_cells)
+{
+  if (!incremental_)
+    DUNE_THROW(InvalidStateException, "the coarse operator was not set up for incremental updates");
+  Dune::XT::Common::ScopedTiming st("msfem.coarse.update");
+  const auto size = coarse_space().mapper().size();
+  MatrixType delta_matrix(size, size, EllipticOperatorType::pattern(coarse_space()));
+  CommonTraits::GdtVectorType delta_rhs(size, 0.);
+  std::vector<CommonTraits::EntityType> cells;
+  const auto interior = coarse_space().grid_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>();
+  for (const auto& coarse_entity : Dune::elements(interior))
+    if (coarse_cells.count(interior.indexSet().index(coarse_entity)))
+      cells.push_back(coarse_entity);
+
+  // delta = new - old contributions of the cells
+  for (const auto& cell : cells)
+    scatter_.retract(interior.indexSet().index(cell), delta_matrix, delta_rhs);
+  // the problem's diffusion may have been exchanged since local_operator_ was built
+  const LocalOperatorType local_operator(problem_.getDiffusion(), problem_.getModelData().linear());
+  const LocalAssemblerType matrix_assembler(local_operator,
+                                            local_grid_list_,
+                                            scatter_,
+                                            nullptr,
+                                            fused_assembly_ ? &rhs_integral_ : nullptr,
+                                            fused_assembly_ ? &delta_rhs : nullptr);
+  const RhsCodim0Vector rhs_assembler(rhs_integral_, local_grid_list_, scatter_);
+  const auto max_dofs = coarse_space().mapper().maxNumDofs();
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> ElementMatrixType;
+  typedef Dune::DynamicVector<CommonTraits::RangeFieldType> ElementVectorType;
+  std::vector<std::vector<ElementMatrixType>> tmp_matrices;
+  for (const auto num : matrix_assembler.numTmpObjectsRequired())
+    tmp_matrices.emplace_back(num, ElementMatrixType(max_dofs, max_dofs, 0.));
+  std::vector<std::vector<ElementVectorType>> tmp_vectors;
+  for (const auto num : rhs_assembler.numTmpObjectsRequired())
+    tmp_vectors.emplace_back(num, ElementVectorType(max_dofs, 0.));
+  std::vector<Dune::DynamicVector<std::size_t>> tmp_indices(2, Dune::DynamicVector<std::size_t>(max_dofs, 0));
+  for (const auto& cell : cells) {
+    matrix_assembler.assembleLocal(coarse_space(), coarse_space(), cell, delta_matrix, tmp_matrices, tmp_indices);
+    if (!fused_assembly_)
+      rhs_assembler.assembleLocal(coarse_space(), cell, delta_rhs, tmp_vectors, tmp_indices[0]);
+  }
+  scatter_.flush();
+
+  // same treatment as in assembly: Dirichlet rows are kept, the action on the Dirichlet values moves to the right
+  // hand side and, for symmetric problems, Dirichlet columns stay cleared
+  const bool symmetric = problem_.getModelData().symmetricDiffusion();
+  const auto& dirichlet_values = dirichlet_projection_.vector();
+  auto& rhs = msfem_rhs_.vector();
+  const auto& delta = delta_matrix.backend();
+  for (auto row_it = delta.begin(); row_it != delta.end(); ++row_it) {
+    const auto row = row_it.index();
+    if (dirichlet_dofs_.count(row))
+      continue;
+    auto rhs_delta = delta_rhs.get_entry(row);
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it) {
+      const auto value = (*col_it)[0][0];
+      if (value == 0.)
+        continue;
+      rhs_delta -= value * dirichlet_values.get_entry(col_it.index());
+      if (!(symmetric && dirichlet_dofs_.count(col_it.index())))
+        global_matrix_.add_to_entry(row, col_it.index(), value);
+    }
+    rhs.add_to_entry(row, rhs_delta);
+  }
+  MS_LOG_INFO << "Updated the coarse system for " << cells.size() << " coarse cells" << std::endl;
 }
 
 void CoarseScaleOperator::assemble()
@@ -106,10 +219,104 @@ void CoarseScaleOperator::apply_inverse(CoarseScaleOperator::CoarseDiscreteFunct
 
   BOOST_ASSERT_MSG(msfem_rhs_.dofs_valid(), "Coarse scale RHS DOFs need to be valid!");
   DXTC_TIMINGS.start("msfem.coarse.linearSolver");
+
+  const auto type = solver_type();
+  if (type == "cg.amg.ssor") {
+    std::vector<CommonTraits::GdtVectorType> solutions(1, solution.vector());
+    apply_cg_amg({msfem_rhs_.vector()}, solutions);
+    solution.vector() = solutions[0];
+  } else {
+    solve(msfem_rhs_.vector(), solution.vector(), type);
+  }
+
+  if (!solution.dofs_valid())
+    DUNE_THROW(InvalidStateException, "Degrees of freedom of coarse solution are not valid!");
+
+  solution.vector() += dirichlet_projection_.vector();
+
+  DXTC_TIMINGS.stop("msfem.coarse.linearSolver");
+  MS_LOG_INFO << "Time to solve coarse MsFEM problem: " << DXTC_TIMINGS.walltime("msfem.coarse.linearSolver") << "ms."
+              << std::endl;
+}
+
+void CoarseScaleOperator::apply_inverse(const std::vector<CommonTraits::GdtVectorType>& rhs,
+                                        std::vector<CommonTraits::GdtVectorType>& solutions)
+{
+  Dune::XT::Common::ScopedTiming st("msfem.coarse.solve_batch");
+  Dune::Timer timer;
+  // the constraints are applied to the right hand sides the same way as to the assembled one
+  std::vector<CommonTraits::GdtVectorType> constrained_rhs(rhs);
+  for (auto& vector : constrained_rhs) {
+    if (vector.size() != coarse_space().mapper().size())
+      DUNE_THROW(InvalidStateException, "right hand side has " << vector.size() << " entries instead of "
+                                                              << coarse_space().mapper().size());
+    for (const auto dof : dirichlet_dofs_)
+      vector.set_entry(dof, 0.);
+  }
+  solutions.assign(rhs.size(), CommonTraits::GdtVectorType(coarse_space().mapper().size(), 0.));
+
+  const auto type = solver_type();
+  if (type == "cg.amg.ssor") {
+    apply_cg_amg(constrained_rhs, solutions);
+  } else
+#if HAVE_UMFPACK
+  if (MPIHelper::getCollectiveCommunication().size() == 1) {
+    typedef CommonTraits::GdtVectorType::BackendType IstlVectorType;
+    UMFPack<MatrixType::BackendType> factorization(global_matrix_.backend(),
+                                                   problem_.config().get("msfem.coarse_solver.verbose", 0));
+    for (const auto i : Dune::XT::Common::value_range(rhs.size())) {
+      // apply overwrites the right hand side
+      IstlVectorType b(constrained_rhs[i].backend());
+      InverseOperatorResult result;
+      factorization.apply(solutions[i].backend(), b, result);
+    }
+  } else
+#endif
+  {
+    for (const auto i : Dune::XT::Common::value_range(rhs.size()))
+      solve(constrained_rhs[i], solutions[i], type);
+  }
+
+  for (const auto i : Dune::XT::Common::value_range(solutions.size()))
+    if (!solutions[i].valid())
+      DUNE_THROW(InvalidStateException, "Degrees of freedom of coarse solution " << i << " are not valid!");
+  MS_LOG_INFO << "Solved " << rhs.size() << " coarse load cases in " << timer.elapsed() << "s" << std::endl;
+}
+
+const CommonTraits::GdtVectorType& CoarseScaleOperator::rhs() const
+{
+  return msfem_rhs_.vector();
+}
+
+const CommonTraits::GdtVectorType& CoarseScaleOperator::dirichlet_projection() const
+{
+  return dirichlet_projection_.vector();
+}
+
+const CoarseScaleOperator::SourceSpaceType& CoarseScaleOperator::coarse_space() const
+{
+  return test_space();
+}
+
+std::string CoarseScaleOperator::solver_type() const
+{
+  const bool symmetric = problem_.getModelData().symmetricDiffusion();
+  auto type = problem_.config().get("msfem.coarse_solver", std::string(symmetric ? "cg.amg.ssor" : "bicgstab.ilut"));
+  if (type == "cg.amg.ssor" && !symmetric)
+    DUNE_THROW(InvalidStateException, "msfem.coarse_solver = cg.amg.ssor needs a problem with symmetric diffusion");
+  if (type == "cg.amg.ssor" && MPIHelper::getCollectiveCommunication().size() > 1) {
+    MS_LOG_DEBUG_0 << "cg.amg.ssor is not available in parallel, using bicgstab.amg.ilu0" << std::endl;
+    type = "bicgstab.amg.ilu0";
+  }
+  return type;
+}
+
+void CoarseScaleOperator::solve(const CommonTraits::GdtVectorType& rhs,
+                                CommonTraits::GdtVectorType& solution,
+                                const std::string& type) const
+{
   typedef typename BackendChooser<CoarseDiscreteFunctionSpace>::InverseOperatorType Inverse;
   const Inverse inverse(global_matrix_, msfem_rhs_.space().communicator());
-
-  const auto type = problem_.config().get("msfem.coarse_solver", "bicgstab.ilut");
   auto options = Inverse::options(type);
   constexpr bool overwrite = true;
   options.set("preconditioner.anisotropy_dim", CommonTraits::world_dim, overwrite);
@@ -120,26 +327,51 @@ void CoarseScaleOperator::apply_inverse(CoarseScaleOperator::CoarseDiscreteFunct
   options.set("smoother.verbose", "2", overwrite);
   options.set("post_check_solves_system", problem_.config().get("msfem.coarse_solver.check", false), overwrite);
   try {
-    inverse.apply(msfem_rhs_.vector(), solution.vector(), options);
+    inverse.apply(rhs, solution, options);
   } catch (Dune::Stuff::Exceptions::linear_solver_failed& f) {
     // prevents all ranks from outputting the same detailed error message
     MS_LOG_ERROR_0 << f.what();
     DUNE_THROW(InvalidStateException, "Coarse solve failed.");
   }
-
-  if (!solution.dofs_valid())
-    DUNE_THROW(InvalidStateException, "Degrees of freedom of coarse solution are not valid!");
-
-  solution.vector() += dirichlet_projection_.vector();
-
-  DXTC_TIMINGS.stop("msfem.coarse.linearSolver");
-  MS_LOG_INFO << "Time to solve coarse MsFEM problem: " << DXTC_TIMINGS.walltime("msfem.coarse.linearSolver") << "ms."
-              << std::endl;
 }
 
-const CoarseScaleOperator::SourceSpaceType& CoarseScaleOperator::coarse_space() const
+void CoarseScaleOperator::apply_cg_amg(const std::vector<CommonTraits::GdtVectorType>& rhs,
+                                       std::vector<CommonTraits::GdtVectorType>& solutions) const
 {
-  return test_space();
+  typedef MatrixType::BackendType IstlMatrixType;
+  typedef CommonTraits::GdtVectorType::BackendType IstlVectorType;
+  typedef MatrixAdapter<IstlMatrixType, IstlVectorType, IstlVectorType> IstlOperatorType;
+  typedef SeqSSOR<IstlMatrixType, IstlVectorType, IstlVectorType> SmootherType;
+  typedef Amg::AMG<IstlOperatorType, IstlVectorType, SmootherType> PreconditionerType;
+  typedef Amg::CoarsenCriterion<Amg::SymmetricCriterion<IstlMatrixType, Amg::FirstDiagonal>> CriterionType;
+
+  assert(rhs.size() == solutions.size());
+  const auto verbose = problem_.config().get("msfem.coarse_solver.verbose", 2);
+  IstlOperatorType op(global_matrix_.backend());
+  CriterionType criterion(15, problem_.config().get("msfem.coarse_solver.coarse_target", 2000));
+  criterion.setDefaultValuesIsotropic(CommonTraits::world_dim);
+  criterion.setDebugLevel(verbose);
+  Amg::SmootherTraits<SmootherType>::Arguments smoother_args;
+  smoother_args.iterations = 1;
+  smoother_args.relaxationFactor = 1.;
+  PreconditionerType amg(op, criterion, smoother_args);
+
+  CGSolver<IstlVectorType> cg(op,
+                              amg,
+                              problem_.config().get("msfem.coarse_solver.precision", 1e-10),
+                              problem_.config().get("msfem.coarse_solver.max_iter", 300),
+                              verbose);
+  for (const auto i : Dune::XT::Common::value_range(rhs.size())) {
+    // apply overwrites the right hand side with the residual
+    auto b = rhs[i].backend();
+    InverseOperatorResult result;
+    cg.apply(solutions[i].backend(), b, result);
+    if (!result.converged) {
+      MS_LOG_ERROR_0 << "CG did not converge, reduction " << result.reduction << " after " << result.iterations
+                     << " iterations" << std::endl;
+      DUNE_THROW(InvalidStateException, "Coarse solve failed.");
+    }
+  }
 }
 
 } // namespace Multiscale {
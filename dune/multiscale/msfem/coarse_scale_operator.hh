@@ -6,7 +6,10 @@
 #define DUNE_MULTISCALE_MSFEM_COARSESCALE_OPERATOR_HH
 
 #include <ostream>
+#include <set>
+#include <string>
 #include <type_traits>
+#include <vector>
 #include <assert.h>
 #include <boost/noncopyable.hpp>
 
@@ -16,6 +19,8 @@
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 #include <dune/multiscale/msfem/coarse_scale_assembler.hh>
+#include <dune/multiscale/msfem/coarse_rhs_functional.hh>
+#include <dune/multiscale/msfem/coarse_scatter.hh>
 
 namespace Dune {
 namespace Multiscale {
@@ -24,6 +29,8 @@ class MsFEMCodim0Integral;
 class MsFemCodim0Matrix;
 class LocalproblemSolutionManager;
 class LocalGridList;
+class LocalSolutionStream;
+class OfflineArchive;
 class CoarseScaleOperator;
 
 namespace Problem {
@@ -70,9 +77,18 @@ public:
   static Stuff::LA::SparsityPatternDefault
   pattern(const RangeSpaceType& range_space, const SourceSpaceType& source_space, const GridViewType& grid_view);
 
+  /** \param stream if given, local problems are solved cell by cell during assembly (msfem.streaming)
+   *  instead of being loaded from DiscreteFunctionIO
+   *  \param archive if given, an offline archive receives the coarse matrix, an online one provides it instead of
+   *  assembling it (msfem.archive)
+   *  \param incremental keep all coarse element contributions, which update needs
+   */
   CoarseScaleOperator(const DMP::ProblemContainer& problem,
                       const SourceSpaceType& source_space_in,
-                      LocalGridList& localGridList);
+                      LocalGridList& localGridList,
+                      LocalSolutionStream* stream = nullptr,
+                      OfflineArchive* archive = nullptr,
+                      const bool incremental = false);
 
   virtual ~CoarseScaleOperator()
   {
@@ -80,17 +96,65 @@ public:
 
   virtual void assemble() override final;
 
+  /** msfem.coarse_solver defaults to cg.amg.ssor for problems with symmetric diffusion, bicgstab.ilut otherwise.
+   *  cg.amg.ssor is only available sequentially, in parallel bicgstab.amg.ilu0 is used instead.
+   */
   void apply_inverse(CoarseScaleOperator::CoarseDiscreteFunction& solution);
 
+  /** Solves for several load cases with one solver setup.
+   *
+   *  With cg.amg.ssor the AMG hierarchy is built once and shared by all CG solves. Sequential runs with other solver
+   *  types factorize the coarse matrix once with UMFPack (if available), each right hand side then only costs a
+   *  back-substitution. Otherwise every right hand side gets its own solve as in apply_inverse.
+   *
+   *  \param rhs coarse load vectors for zero Dirichlet values, eg. copies of rhs(). Dirichlet rows are ignored.
+   *  \param[out] solutions one per right hand side, without dirichlet_projection() added
+   */
+  void apply_inverse(const std::vector<CommonTraits::GdtVectorType>& rhs,
+                     std::vector<CommonTraits::GdtVectorType>& solutions);
+
+  /** Replaces the coarse element matrices and load vectors of coarse_cells (leaf indices) with ones computed from
+   *  their current local solutions and diffusion, in matrix and right hand side. Dirichlet rows stay untouched, the
+   *  changed action on the Dirichlet values is accounted for. Needs incremental, does not support streaming.
+   */
+  void update(const std::set<std::size_t>& coarse_cells);
+
+  //! the constrained right hand side of the problem's source, Neumann and Dirichlet data
+  const CommonTraits::GdtVectorType& rhs() const;
+  //! projection of the problem's Dirichlet data, the single right hand side apply_inverse adds it to the solution
+  const CommonTraits::GdtVectorType& dirichlet_projection() const;
+
 private:
   //! used as an alias to test_space()
   const SourceSpaceType& coarse_space() const;
 
+  //! msfem.coarse_solver, see apply_inverse
+  std::string solver_type() const;
+
+  //! one solve with the dune-stuff solver of the given type
+  void solve(const CommonTraits::GdtVectorType& rhs,
+             CommonTraits::GdtVectorType& solution,
+             const std::string& type) const;
+
+  //! conjugate gradients, preconditioned with one AMG V-cycle (SSOR smoothing), needs a symmetric global_matrix_.
+  //! The hierarchy is set up once for all right hand sides.
+  void apply_cg_amg(const std::vector<CommonTraits::GdtVectorType>& rhs,
+                    std::vector<CommonTraits::GdtVectorType>& solutions) const;
+
   MatrixType global_matrix_;
+  //! with the diffusion at construction, update builds its own from the current one
   const LocalOperatorType local_operator_;
-  const LocalAssemblerType local_assembler_;
+  const RhsCodim0Integral rhs_integral_;
   CommonTraits::DiscreteFunctionType msfem_rhs_;
+  //! msfem.fused_coarse_assembly: element matrices and load vectors are computed in one pass by local_assembler_
+  const bool fused_assembly_;
+  //! all coarse element matrices and vectors are added through it, msfem.deterministic_assembly fixes their order
+  CoarseElementScatter scatter_;
+  const bool incremental_;
+  LocalGridList& local_grid_list_;
+  const LocalAssemblerType local_assembler_;
   CommonTraits::DiscreteFunctionType dirichlet_projection_;
+  std::set<std::size_t> dirichlet_dofs_;
   const DMP::ProblemContainer& problem_;
 }; // class CoarseScaleOperator
 
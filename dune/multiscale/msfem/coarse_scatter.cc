@@ -0,0 +1,114 @@
+#include <config.h>
+
+#include "coarse_scatter.hh"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+
+namespace Dune {
+namespace Multiscale {
+
+CoarseElementScatter::CoarseElementScatter(const bool deterministic, const bool keep)
+  : deterministic_(deterministic)
+  , keep_(keep)
+{
+}
+
+void CoarseElementScatter::add(const std::size_t coarse_index,
+                               const IndicesType& rows,
+                               const IndicesType& cols,
+                               const std::size_t num_rows,
+                               const std::size_t num_cols,
+                               const ElementMatrixType& matrix,
+                               CommonTraits::LinearOperatorType& target)
+{
+  assert(rows.size() >= num_rows && cols.size() >= num_cols);
+  assert(matrix.rows() >= num_rows && matrix.cols() >= num_cols);
+  Contribution contribution{coarse_index,
+                            std::vector<std::size_t>(rows.begin(), rows.begin() + num_rows),
+                            std::vector<std::size_t>(cols.begin(), cols.begin() + num_cols),
+                            std::vector<CommonTraits::RangeFieldType>(),
+                            &target,
+                            nullptr,
+                            false};
+  contribution.values.reserve(num_rows * num_cols);
+  for (std::size_t ii = 0; ii < num_rows; ++ii)
+    for (std::size_t jj = 0; jj < num_cols; ++jj)
+      contribution.values.push_back(matrix[ii][jj]);
+  buffers_->push_back(std::move(contribution));
+}
+
+void CoarseElementScatter::add(const std::size_t coarse_index,
+                               const IndicesType& rows,
+                               const std::size_t num_rows,
+                               const ElementVectorType& vector,
+                               CommonTraits::GdtVectorType& target,
+                               const bool fixed)
+{
+  assert(rows.size() >= num_rows && vector.size() >= num_rows);
+  Contribution contribution{coarse_index,
+                            std::vector<std::size_t>(rows.begin(), rows.begin() + num_rows),
+                            std::vector<std::size_t>(),
+                            std::vector<CommonTraits::RangeFieldType>(vector.begin(), vector.begin() + num_rows),
+                            nullptr,
+                            &target,
+                            fixed};
+  buffers_->push_back(std::move(contribution));
+}
+
+void CoarseElementScatter::flush()
+{
+  std::vector<Contribution> contributions;
+  for (auto& buffer : buffers_) {
+    std::move(buffer.begin(), buffer.end(), std::back_inserter(contributions));
+    buffer.clear();
+  }
+  // all contributions of a cell are in one buffer, stable sorting keeps their relative order
+  if (deterministic_)
+    std::stable_sort(contributions.begin(), contributions.end(), [](const Contribution& a, const Contribution& b) {
+      return a.coarse_index < b.coarse_index;
+    });
+  for (auto& contribution : contributions) {
+    scatter(contribution);
+    if (keep_ && !contribution.fixed)
+      kept_[contribution.coarse_index].push_back(std::move(contribution));
+  }
+}
+
+void CoarseElementScatter::retract(const std::size_t coarse_index,
+                                   CommonTraits::LinearOperatorType& matrix,
+                                   CommonTraits::GdtVectorType& vector)
+{
+  assert(keep_);
+  const auto it = kept_.find(coarse_index);
+  if (it == kept_.end())
+    return;
+  for (auto& contribution : it->second) {
+    if (contribution.matrix)
+      contribution.matrix = &matrix;
+    else
+      contribution.vector = &vector;
+    scatter(contribution, -1.);
+  }
+  kept_.erase(it);
+}
+
+void CoarseElementScatter::scatter(const Contribution& contribution, const double sign)
+{
+  const auto num_rows = contribution.rows.size();
+  if (contribution.vector) {
+    for (std::size_t ii = 0; ii < num_rows; ++ii)
+      contribution.vector->add_to_entry(contribution.rows[ii], sign * contribution.values[ii]);
+    return;
+  }
+  const auto num_cols = contribution.cols.size();
+  for (std::size_t ii = 0; ii < num_rows; ++ii)
+    for (std::size_t jj = 0; jj < num_cols; ++jj)
+      contribution.matrix->add_to_entry(
+          contribution.rows[ii], contribution.cols[jj], sign * contribution.values[ii * num_cols + jj]);
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
@@ -0,0 +1,102 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_COARSE_SCATTER_HH
+#define DUNE_MULTISCALE_MSFEM_COARSE_SCATTER_HH
+
+#include <dune/common/dynmatrix.hh>
+#include <dune/common/dynvector.hh>
+#include <dune/xt/common/parallel/threadstorage.hh>
+#include <dune/multiscale/common/traits.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+
+/**
+ * \brief Adds coarse element matrices and vectors from concurrent assemblers to the global coarse system
+ *
+ * The coarse assemblers accumulate the contributions of all micro elements of a coarse cell in their (per thread)
+ * temporary storage and hand the finished element matrix/vector over once per coarse cell. add only appends them to
+ * a buffer of the calling thread, flush adds all buffered contributions to the shared global containers, so threads
+ * neither block each other nor add to the same entry concurrently.
+ *
+ * In deterministic mode (msfem.deterministic_assembly) flush adds them in order of their coarse cell index. All
+ * contributions of a cell come from the thread that walks it, in the walker's order, so the floating point summation
+ * order no longer depends on the number of threads or the scheduling. Since every accumulated part of the coarse
+ * system goes through here (element matrices, element load vectors and Neumann face vectors; the Dirichlet data is
+ * projected, not summed), the assembled system is bitwise reproducible.
+ *
+ * With keep, a copy of every contribution that depends on the local problems is kept per coarse cell, so that an
+ * incremental update can retract the contributions of cells whose local problems changed.
+ */
+class CoarseElementScatter : public boost::noncopyable
+{
+public:
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> ElementMatrixType;
+  typedef Dune::DynamicVector<CommonTraits::RangeFieldType> ElementVectorType;
+  typedef Dune::DynamicVector<std::size_t> IndicesType;
+
+  explicit CoarseElementScatter(const bool deterministic, const bool keep = false);
+
+  //! adds the leading num_rows x num_cols block of matrix to target(rows, cols) on flush. Thread safe.
+  void add(const std::size_t coarse_index,
+           const IndicesType& rows,
+           const IndicesType& cols,
+           const std::size_t num_rows,
+           const std::size_t num_cols,
+           const ElementMatrixType& matrix,
+           CommonTraits::LinearOperatorType& target);
+  /** adds the leading num_rows entries of vector to target(rows) on flush. Thread safe.
+   *  \param fixed the contribution does not depend on the local problems and is never retracted
+   */
+  void add(const std::size_t coarse_index,
+           const IndicesType& rows,
+           const std::size_t num_rows,
+           const ElementVectorType& vector,
+           CommonTraits::GdtVectorType& target,
+           const bool fixed = false);
+
+  //! adds all buffered contributions, in deterministic mode ordered by coarse cell index. Not concurrently to add.
+  void flush();
+
+  /** subtracts the kept contributions of coarse_index from matrix and vector, instead of the targets they were added
+   * to, and forgets them. Needs keep, must not be called concurrently to add.
+   */
+  void retract(const std::size_t coarse_index,
+               CommonTraits::LinearOperatorType& matrix,
+               CommonTraits::GdtVectorType& vector);
+
+private:
+  struct Contribution
+  {
+    std::size_t coarse_index;
+    std::vector<std::size_t> rows;
+    std::vector<std::size_t> cols;
+    //! row major, rows.size() x cols.size() for matrices, rows.size() for vectors
+    std::vector<CommonTraits::RangeFieldType> values;
+    CommonTraits::LinearOperatorType* matrix;
+    CommonTraits::GdtVectorType* vector;
+    bool fixed;
+  };
+
+  //! adds sign * contribution to its targets
+  static void scatter(const Contribution& contribution, const double sign = 1.);
+
+  const bool deterministic_;
+  const bool keep_;
+  //! contributions added since the last flush, per thread in the order they were added
+  Dune::XT::Common::PerThreadValue<std::vector<Contribution>> buffers_;
+  std::map<std::size_t, std::vector<Contribution>> kept_;
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_COARSE_SCATTER_HH
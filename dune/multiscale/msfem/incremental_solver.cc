@@ -0,0 +1,175 @@
+#include <config.h>
+
+#include "incremental_solver.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/multiscale/msfem/coarse_scale_operator.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/msfem/localsolution_proxy.hh>
+#include <dune/multiscale/msfem/msfem_solver.hh>
+#include <dune/multiscale/msfem/offline_archive.hh>
+#include <dune/multiscale/problems/selector.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/logging.hh>
+#include <dune/xt/common/memory.hh>
+#include <dune/xt/common/parallel/threadstorage.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/xt/common/timings.hh>
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+#include <limits>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+
+template <class GeometryType>
+static std::pair<CommonTraits::DomainType, CommonTraits::DomainType> corner_box(const GeometryType& geometry)
+{
+  auto box = std::make_pair(CommonTraits::DomainType(std::numeric_limits<double>::max()),
+                            CommonTraits::DomainType(std::numeric_limits<double>::lowest()));
+  for (const auto c : Dune::XT::Common::value_range(geometry.corners())) {
+    const auto corner = geometry.corner(c);
+    for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+      box.first[i] = std::min(box.first[i], corner[i]);
+      box.second[i] = std::max(box.second[i], corner[i]);
+    }
+  }
+  return box;
+}
+
+//! true if the boxes overlap with positive volume, relative to the extent of a
+static bool overlap(const std::pair<CommonTraits::DomainType, CommonTraits::DomainType>& a,
+                    const std::pair<CommonTraits::DomainType, CommonTraits::DomainType>& b)
+{
+  for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+    const auto tolerance = 1e-10 * (a.second[i] - a.first[i]);
+    if (a.second[i] <= b.first[i] + tolerance || b.second[i] <= a.first[i] + tolerance)
+      return false;
+  }
+  return true;
+}
+
+IncrementalMsFemSolver::IncrementalMsFemSolver(const DMP::ProblemContainer& problem,
+                                               const CommonTraits::SpaceType& coarse_space,
+                                               LocalGridList& localgrid_list)
+  : clear_guard_(DiscreteFunctionIO::clear_guard())
+  , problem_(problem)
+  , coarse_space_(coarse_space)
+  , localgrid_list_(localgrid_list)
+  , coarse_solution_(coarse_space, "Coarse Part MsFEM Solution")
+{
+  if (problem.config().get("msfem.streaming", false))
+    DUNE_THROW(InvalidStateException, "incremental MsFEM updates need all correctors to be kept");
+  if (OfflineArchive::mode(problem) != OfflineArchive::Mode::none)
+    DUNE_THROW(InvalidStateException, "incremental MsFEM updates do not support msfem.archive");
+  coarse_solution_.vector() *= 0;
+
+  const auto& grid = coarse_space.grid_view().grid();
+  const auto& index_set = grid.leafIndexSet();
+  for (const auto& coarse_entity : Dune::elements(grid.leafGridView<InteriorBorder_Partition>())) {
+    const auto index = index_set.index(coarse_entity);
+    cell_boxes_[index] = corner_box(coarse_entity.geometry());
+    auto& local_box = local_grid_boxes_[index];
+    local_box = cell_boxes_[index];
+    for (const auto& local_entity : Dune::elements(localgrid_list.getSubGrid(coarse_entity).leafGridView())) {
+      const auto box = corner_box(local_entity.geometry());
+      for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+        local_box.first[i] = std::min(local_box.first[i], box.first[i]);
+        local_box.second[i] = std::max(local_box.second[i], box.second[i]);
+      }
+    }
+  }
+}
+
+IncrementalMsFemSolver::~IncrementalMsFemSolver()
+{
+}
+
+void IncrementalMsFemSolver::apply(std::unique_ptr<LocalsolutionProxy>& solution)
+{
+  Dune::XT::Common::ScopedTiming st("msfem.incremental.apply");
+  local_solver_ = Dune::XT::Common::make_unique<LocalProblemSolver>(problem_, coarse_space_, localgrid_list_);
+  local_solver_->solve_for_all_cells();
+  coarse_operator_ = Dune::XT::Common::make_unique<CoarseScaleOperator>(
+      problem_, coarse_space_, localgrid_list_, nullptr, nullptr, true);
+  coarse_solution_.vector() *= 0;
+  solve_coarse(solution);
+}
+
+std::size_t IncrementalMsFemSolver::update(const std::set<std::size_t>& changed_cells,
+                                           std::unique_ptr<LocalsolutionProxy>& solution)
+{
+  if (!coarse_operator_)
+    DUNE_THROW(InvalidStateException, "apply has to be called before update");
+  Dune::XT::Common::ScopedTiming st("msfem.incremental.update");
+  const auto affected = affected_cells(changed_cells);
+  MS_LOG_INFO << changed_cells.size() << " changed coarse cells affect the local problems of " << affected.size()
+              << " coarse cells" << std::endl;
+
+  const auto& grid = coarse_space_.grid_view().grid();
+  const auto& index_set = grid.leafIndexSet();
+  std::vector<CommonTraits::EntityType::EntitySeed> seeds;
+  for (const auto& coarse_entity : Dune::elements(grid.leafGridView<InteriorBorder_Partition>()))
+    if (affected.count(index_set.index(coarse_entity)))
+      seeds.push_back(coarse_entity.seed());
+
+  // coarse spaces are not thread safe
+  const Dune::XT::Common::PerThreadValue<CommonTraits::SpaceType> thread_coarse_space(coarse_space_);
+  typedef tbb::blocked_range<std::size_t> CellRangeType;
+  tbb::parallel_for(CellRangeType(0, seeds.size()), [&](const CellRangeType& range) {
+    for (auto cell = range.begin(); cell != range.end(); ++cell) {
+      const auto coarse_entity = grid.entity(seeds[cell]);
+      LocalproblemSolutionManager localSolutionManager(*thread_coarse_space, coarse_entity, localgrid_list_);
+      local_solver_->solve_for_cell(coarse_entity, localSolutionManager);
+      // replaces the previous solutions of the cell
+      localSolutionManager.save();
+    }
+  });
+
+  coarse_operator_->update(affected);
+  // the previous solution, without the Dirichlet values, is the initial guess
+  coarse_solution_.vector() -= coarse_operator_->dirichlet_projection();
+  solve_coarse(solution);
+  return affected.size();
+}
+
+std::set<std::size_t> IncrementalMsFemSolver::cells_in(const CommonTraits::DomainType& lower,
+                                                       const CommonTraits::DomainType& upper) const
+{
+  const BoxType region(lower, upper);
+  std::set<std::size_t> cells;
+  for (const auto& cell : cell_boxes_)
+    if (overlap(cell.second, region))
+      cells.insert(cell.first);
+  return cells;
+}
+
+std::set<std::size_t> IncrementalMsFemSolver::affected_cells(const std::set<std::size_t>& changed_cells) const
+{
+  std::set<std::size_t> affected;
+  for (const auto changed : changed_cells) {
+    const auto it = cell_boxes_.find(changed);
+    if (it == cell_boxes_.end())
+      DUNE_THROW(InvalidStateException, "coarse cell " << changed << " is not an interior cell of this rank");
+    for (const auto& local_grid : local_grid_boxes_)
+      if (overlap(local_grid.second, it->second))
+        affected.insert(local_grid.first);
+  }
+  return affected;
+}
+
+void IncrementalMsFemSolver::solve_coarse(std::unique_ptr<LocalsolutionProxy>& solution)
+{
+  coarse_operator_->apply_inverse(coarse_solution_);
+  Elliptic_MsFEM_Solver().identify_fine_scale_part(
+      problem_, localgrid_list_, coarse_solution_, coarse_space_, solution);
+  solution->add(coarse_solution_);
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
@@ -0,0 +1,86 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_INCREMENTAL_SOLVER_HH
+#define DUNE_MULTISCALE_MSFEM_INCREMENTAL_SOLVER_HH
+
+#include <dune/multiscale/common/df_io.hh>
+#include <dune/multiscale/common/traits.hh>
+#include <dune/multiscale/msfem/msfem_traits.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <utility>
+
+namespace Dune {
+namespace Multiscale {
+
+class CoarseScaleOperator;
+class LocalGridList;
+class LocalProblemSolver;
+class LocalsolutionProxy;
+
+namespace Problem {
+struct ProblemContainer;
+}
+
+/**
+ * \brief MsFEM solver for a sequence of problems that only differ by local changes of the diffusion
+ *
+ * apply solves like Elliptic_MsFEM_Solver, but the local solutions, the coarse system with all coarse element
+ * contributions and the coarse solution are kept until the solver is destroyed. After the problem's diffusion was
+ * changed on some coarse cells, update only re-solves the local problems whose (oversampled) local grid overlaps one
+ * of them, replaces these cells' contributions to the coarse matrix and right hand side, and solves the coarse
+ * system starting from the previous solution (for the iterative coarse solvers).
+ *
+ * Only one instance may exist at a time, it owns all local solutions in DiscreteFunctionIO. msfem.streaming and
+ * msfem.archive are not supported.
+ */
+class IncrementalMsFemSolver : public boost::noncopyable
+{
+public:
+  IncrementalMsFemSolver(const DMP::ProblemContainer& problem,
+                         const CommonTraits::SpaceType& coarse_space,
+                         LocalGridList& localgrid_list);
+  ~IncrementalMsFemSolver();
+
+  //! solves all local problems and the coarse problem
+  void apply(std::unique_ptr<LocalsolutionProxy>& solution);
+
+  /** \param changed_cells leaf indices of the coarse cells on which the diffusion changed since the last apply/update
+   * \return the number of coarse cells whose local problems were re-solved
+   */
+  std::size_t update(const std::set<std::size_t>& changed_cells, std::unique_ptr<LocalsolutionProxy>& solution);
+
+  //! leaf indices of the coarse cells that intersect the box [lower, upper], eg. to describe changed_cells
+  std::set<std::size_t> cells_in(const CommonTraits::DomainType& lower, const CommonTraits::DomainType& upper) const;
+
+private:
+  typedef std::pair<CommonTraits::DomainType, CommonTraits::DomainType> BoxType;
+
+  //! cells whose local grids overlap one of changed_cells
+  std::set<std::size_t> affected_cells(const std::set<std::size_t>& changed_cells) const;
+  void solve_coarse(std::unique_ptr<LocalsolutionProxy>& solution);
+
+  //! the local solutions are kept until destruction
+  decltype(DiscreteFunctionIO::clear_guard()) clear_guard_;
+  const DMP::ProblemContainer& problem_;
+  const CommonTraits::SpaceType& coarse_space_;
+  LocalGridList& localgrid_list_;
+  std::unique_ptr<LocalProblemSolver> local_solver_;
+  std::unique_ptr<CoarseScaleOperator> coarse_operator_;
+  CommonTraits::DiscreteFunctionType coarse_solution_;
+  //! bounding boxes of the coarse cells and of their local grids, by leaf index
+  std::map<std::size_t, BoxType> cell_boxes_;
+  std::map<std::size_t, BoxType> local_grid_boxes_;
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_INCREMENTAL_SOLVER_HH
@@ -0,0 +1,181 @@
+#include <config.h>
+
+#include "correctordeduplication.hh"
+
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/problems/selector.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/ranges.hh>
+
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace Dune {
+namespace Multiscale {
+
+static void hash_combine(std::size_t& seed, const std::size_t value)
+{
+  seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+//! value rounded to 24 significant bits, so values that only differ by round-off mostly compare equal
+static double rounded(const double value)
+{
+  if (value == 0.)
+    return 0.;
+  int exponent = 0;
+  const auto mantissa = std::frexp(value, &exponent);
+  return std::ldexp(double(std::lround(std::ldexp(mantissa, 24))), exponent - 24);
+}
+
+bool CorrectorDeduplication::Fingerprint::operator==(const Fingerprint& other) const
+{
+  return hash == other.hash && cells == other.cells && samples == other.samples;
+}
+
+bool CorrectorDeduplication::enabled(const DMP::ProblemContainer& problem)
+{
+  return problem.config().get("msfem.corrector_deduplication", false);
+}
+
+CorrectorDeduplication::CorrectorDeduplication(const DMP::ProblemContainer& problem,
+                                               const CommonTraits::SpaceType& coarse_space,
+                                               const LocalGridList& localgrid_list)
+  : localgrid_list_(localgrid_list)
+  , max_entries_(problem.config().get("msfem.corrector_deduplication_entries", std::size_t(64)))
+  , hits_(0)
+{
+  domain_lower_.fill(std::numeric_limits<double>::max());
+  domain_upper_.fill(std::numeric_limits<double>::lowest());
+  const auto& view = coarse_space.grid_view();
+  for (const auto& vertex : Dune::vertices(view)) {
+    const auto corner = vertex.geometry().center();
+    for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+      domain_lower_[i] = std::min(domain_lower_[i], double(corner[i]));
+      domain_upper_[i] = std::max(domain_upper_[i], double(corner[i]));
+    }
+  }
+  const auto& comm = view.grid().comm();
+  comm.min(domain_lower_.data(), CommonTraits::world_dim);
+  comm.max(domain_upper_.data(), CommonTraits::world_dim);
+}
+
+CorrectorDeduplication::Fingerprint
+CorrectorDeduplication::fingerprint(const MsFEMTraits::CoarseEntityType& coarse_cell,
+                                    const MsFEMTraits::LocalGridViewType& local_view,
+                                    const DMP::DiffusionBase& diffusion) const
+{
+  if (coarse_cell.hasBoundaryIntersections())
+    return {};
+  const auto origin = coarse_cell.geometry().corner(0);
+  const auto first_entity = *local_view.template begin<0>();
+  auto micro_width = first_entity.geometry().corner(first_entity.geometry().corners() - 1);
+  micro_width -= first_entity.geometry().corner(0);
+
+  Fingerprint key;
+  for (const auto cells : localgrid_list_.shape(coarse_cell))
+    key.cells.push_back(cells);
+  for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+    key.samples.push_back(rounded(micro_width[i]));
+
+  const auto tolerance = 1e-8;
+  std::array<long, CommonTraits::world_dim> offset;
+  offset.fill(std::numeric_limits<long>::max());
+  DMP::DiffusionBase::RangeType tensor;
+  // congruent local grids are traversed in the same order
+  for (const auto& entity : Dune::elements(local_view)) {
+    const auto& geometry = entity.geometry();
+    const auto lower = geometry.corner(0);
+    const auto upper = geometry.corner(geometry.corners() - 1);
+    for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+      // oversampling is cut at the domain boundary, the boundary conditions there are not translation invariant
+      if (lower[i] - domain_lower_[i] < tolerance * micro_width[i]
+          || domain_upper_[i] - upper[i] < tolerance * micro_width[i])
+        return {};
+      offset[i] = std::min(offset[i], std::lround((lower[i] - origin[i]) / micro_width[i]));
+    }
+    for (const auto& point : {geometry.center(), lower}) {
+      diffusion.evaluate(point, tensor);
+      for (const auto& row : tensor)
+        for (const auto& value : row)
+          key.samples.push_back(rounded(value));
+    }
+  }
+  key.cells.insert(key.cells.end(), offset.begin(), offset.end());
+
+  std::size_t seed = 0;
+  for (const auto cells : key.cells)
+    hash_combine(seed, std::hash<long>()(cells));
+  for (const auto sample : key.samples)
+    hash_combine(seed, std::hash<double>()(sample));
+  // 0 is reserved for cells without a fingerprint
+  key.hash = seed == 0 ? 1 : seed;
+  return key;
+}
+
+bool CorrectorDeduplication::reuse(const Fingerprint& fingerprint, LocalproblemSolutionManager& manager)
+{
+  std::shared_ptr<const Correctors> correctors(nullptr);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto candidates = correctors_.equal_range(fingerprint.hash);
+    for (auto it = candidates.first; it != candidates.second && !correctors; ++it)
+      if (it->second->fingerprint == fingerprint)
+        correctors = it->second;
+  }
+  if (!correctors)
+    return false;
+  auto& solutions = manager.getLocalSolutions();
+  assert(solutions.size() == correctors->solutions.size());
+  for (const auto i : Dune::XT::Common::value_range(solutions.size()))
+    solutions[i]->vector() = correctors->solutions[i];
+  if (correctors->coarse_matrix)
+    manager.set_coarse_matrix(CoarseElementMatrixType(*correctors->coarse_matrix));
+  ++hits_;
+  return true;
+}
+
+void CorrectorDeduplication::store(const Fingerprint& fingerprint, LocalproblemSolutionManager& manager)
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (correctors_.size() >= max_entries_)
+      return;
+  }
+  auto correctors = std::make_shared<Correctors>();
+  correctors->fingerprint = fingerprint;
+  for (const auto& solution : manager.getLocalSolutions())
+    correctors->solutions.push_back(solution->vector());
+  if (manager.coarse_matrix())
+    correctors->coarse_matrix = std::make_shared<const CoarseElementMatrixType>(*manager.coarse_matrix());
+  std::lock_guard<std::mutex> lock(mutex_);
+  // another thread may have stored the same fingerprint meanwhile
+  const auto candidates = correctors_.equal_range(fingerprint.hash);
+  for (auto it = candidates.first; it != candidates.second; ++it)
+    if (it->second->fingerprint == fingerprint)
+      return;
+  if (correctors_.size() < max_entries_)
+    correctors_.emplace(fingerprint.hash, std::move(correctors));
+}
+
+void CorrectorDeduplication::clear()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  correctors_.clear();
+}
+
+std::size_t CorrectorDeduplication::hits() const
+{
+  return hits_;
+}
+
+std::size_t CorrectorDeduplication::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return correctors_.size();
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
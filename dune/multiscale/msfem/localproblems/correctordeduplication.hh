@@ -0,0 +1,111 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_CORRECTORDEDUPLICATION_HH
+#define DUNE_MULTISCALE_MSFEM_CORRECTORDEDUPLICATION_HH
+
+#include <dune/common/dynmatrix.hh>
+#include <dune/multiscale/common/la_backend.hh>
+#include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/problems/base.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+
+class LocalGridList;
+class LocalproblemSolutionManager;
+
+/**
+ * \brief Re-uses the correctors of coarse cells whose local problems are translated copies of each other
+ *
+ * For periodic micro structures (Synthetic, ER2007) the local problems of interior coarse cells only differ by a
+ * shift of the coefficient. Each such cell gets a fingerprint: its local grid's shape and offset relative to the
+ * coarse cell plus the diffusion sampled in every micro cell (center and first corner), rounded to about seven
+ * significant digits. Cells with equal fingerprints share one set of correctors (and the algebraic coarse element
+ * matrix), which are copied instead of being solved for. The hash only selects candidates, a cell re-uses
+ * correctors only if its whole fingerprint compares equal.
+ *
+ * Only cells whose local grid does not touch the domain boundary take part, their boundary correctors vanish. The
+ * fingerprint samples the coefficient, it does not prove equality: enable with msfem.corrector_deduplication only
+ * for coefficients that are resolved by the micro grid. At most msfem.corrector_deduplication_entries distinct
+ * fingerprints keep a copy of their correctors, clear() drops them.
+ */
+class CorrectorDeduplication : public boost::noncopyable
+{
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType VectorType;
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> CoarseElementMatrixType;
+
+public:
+  //! everything the correctors of a translated cell depend on
+  struct Fingerprint
+  {
+    //! local grid shape and offset relative to the coarse cell, in micro cells
+    std::vector<long> cells;
+    //! micro cell width and the sampled diffusion tensors, rounded
+    std::vector<double> samples;
+    //! of cells and samples, 0 if the cell has no fingerprint
+    std::size_t hash = 0;
+
+    explicit operator bool() const { return hash != 0; }
+    bool operator==(const Fingerprint& other) const;
+  };
+
+private:
+  struct Correctors
+  {
+    Fingerprint fingerprint;
+    std::vector<VectorType> solutions;
+    std::shared_ptr<const CoarseElementMatrixType> coarse_matrix;
+  };
+
+public:
+  //! msfem.corrector_deduplication
+  static bool enabled(const DMP::ProblemContainer& problem);
+
+  CorrectorDeduplication(const DMP::ProblemContainer& problem,
+                         const CommonTraits::SpaceType& coarse_space,
+                         const LocalGridList& localgrid_list);
+
+  //! \return an empty fingerprint if the cell's correctors are not translation invariant
+  Fingerprint fingerprint(const MsFEMTraits::CoarseEntityType& coarse_cell,
+                          const MsFEMTraits::LocalGridViewType& local_view,
+                          const DMP::DiffusionBase& diffusion) const;
+
+  //! copies the correctors stored for fingerprint into manager. \return false if there are none. Thread safe.
+  bool reuse(const Fingerprint& fingerprint, LocalproblemSolutionManager& manager);
+  //! keeps a copy of manager's correctors for fingerprint, unless there already is one or the limit is reached.
+  //! Thread safe.
+  void store(const Fingerprint& fingerprint, LocalproblemSolutionManager& manager);
+  //! drops all stored correctors, e.g. before the local problems of a changed coefficient are solved
+  void clear();
+
+  //! number of cells that re-used correctors
+  std::size_t hits() const;
+  //! number of distinct fingerprints
+  std::size_t size() const;
+
+private:
+  const LocalGridList& localgrid_list_;
+  std::array<double, CommonTraits::world_dim> domain_lower_;
+  std::array<double, CommonTraits::world_dim> domain_upper_;
+  const std::size_t max_entries_;
+  std::unordered_multimap<std::size_t, std::shared_ptr<const Correctors>> correctors_;
+  mutable std::mutex mutex_;
+  std::atomic<std::size_t> hits_;
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_CORRECTORDEDUPLICATION_HH
@@ -0,0 +1,151 @@
+#include <config.h>
+
+#include "localdiffusioncache.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/multiscale/problems/selector.hh>
+#include <dune/xt/common/memory.hh>
+#include <dune/xt/common/ranges.hh>
+
+#include <functional>
+
+namespace Dune {
+namespace Multiscale {
+
+std::string LocalDiffusionCache::mode(const DMP::ProblemContainer& problem)
+{
+  const auto mode = problem.config().get("msfem.coefficient_cache", std::string("none"));
+  if (mode == "none")
+    return std::string();
+  if (mode != "points" && mode != "cells")
+    DUNE_THROW(InvalidStateException, "msfem.coefficient_cache has to be one of none, points, cells, not " << mode);
+  if (!problem.getModelData().linear())
+    DUNE_THROW(NotImplemented, "msfem.coefficient_cache is only implemented for linear diffusion");
+  return mode;
+}
+
+LocalDiffusionCache::LocalDiffusionCache(const DMP::DiffusionBase& diffusion,
+                                         const MsFEMTraits::LocalGridViewType& grid_view,
+                                         const std::string& mode)
+  : diffusion_(diffusion)
+  , grid_view_(grid_view)
+  , cell_index_(nullptr)
+  , points_(grid_view.size(0))
+{
+  if (mode != "cells")
+    return;
+  auto index = Dune::XT::Common::make_unique<const CellIndexType>(grid_view_);
+  if (index->valid())
+    cell_index_ = std::move(index);
+}
+
+void LocalDiffusionCache::evaluate(const DMP::DomainType& x, RangeType& y) const
+{
+  if (cell_index_) {
+    const auto cell = cell_index_->position(x);
+    if (cell >= 0) {
+      const auto it = cells_.find(cell);
+      if (it != cells_.end()) {
+        y = it->second;
+        return;
+      }
+      MsFEMTraits::LocalEntityType::EntitySeed seed;
+      cell_index_->find(x, seed);
+      diffusion_.evaluate(grid_view_.grid().entity(seed).geometry().center(), y);
+      cells_.emplace(cell, y);
+      return;
+    }
+  }
+  const auto it = points_.find(x);
+  if (it != points_.end()) {
+    y = it->second;
+    return;
+  }
+  diffusion_.evaluate(x, y);
+  points_.emplace(x, y);
+}
+
+void LocalDiffusionCache::diffusiveFlux(const DMP::DomainType& x,
+                                        const DMP::JacobianRangeType& direction,
+                                        DMP::JacobianRangeType& flux) const
+{
+  RangeType tensor;
+  evaluate(x, tensor);
+  tensor.mv(direction[0], flux[0]);
+}
+
+void LocalDiffusionCache::evaluate_batch(const std::vector<DMP::DomainType>& x, std::vector<RangeType>& y) const
+{
+  y.resize(x.size());
+  // positions in x that are not cached yet, with their cell (-1 for points_) and evaluation point
+  std::vector<std::size_t> missing;
+  std::vector<long> missing_cells;
+  std::vector<DMP::DomainType> missing_points;
+  for (std::size_t i = 0; i < x.size(); ++i) {
+    const auto cell = cell_index_ ? cell_index_->position(x[i]) : -1;
+    if (cell >= 0) {
+      const auto it = cells_.find(cell);
+      if (it != cells_.end()) {
+        y[i] = it->second;
+        continue;
+      }
+      MsFEMTraits::LocalEntityType::EntitySeed seed;
+      cell_index_->find(x[i], seed);
+      missing_points.push_back(grid_view_.grid().entity(seed).geometry().center());
+    } else {
+      const auto it = points_.find(x[i]);
+      if (it != points_.end()) {
+        y[i] = it->second;
+        continue;
+      }
+      missing_points.push_back(x[i]);
+    }
+    missing.push_back(i);
+    missing_cells.push_back(cell);
+  }
+  if (missing.empty())
+    return;
+  std::vector<RangeType> evaluations;
+  diffusion_.evaluate_batch(missing_points, evaluations);
+  for (std::size_t j = 0; j < missing.size(); ++j) {
+    y[missing[j]] = evaluations[j];
+    if (missing_cells[j] >= 0)
+      cells_.emplace(missing_cells[j], evaluations[j]);
+    else
+      points_.emplace(x[missing[j]], evaluations[j]);
+  }
+}
+
+void LocalDiffusionCache::diffusiveFlux_batch(const std::vector<DMP::DomainType>& x,
+                                              const std::vector<DMP::JacobianRangeType>& directions,
+                                              std::vector<DMP::JacobianRangeType>& fluxes) const
+{
+  linear_diffusiveFlux_batch(x, directions, fluxes);
+}
+
+size_t LocalDiffusionCache::order() const
+{
+  return diffusion_.order();
+}
+
+DMP::TensorStructure LocalDiffusionCache::structure() const
+{
+  return diffusion_.structure();
+}
+
+std::size_t LocalDiffusionCache::size() const
+{
+  return points_.size() + cells_.size();
+}
+
+std::size_t LocalDiffusionCache::PointHash::operator()(const DMP::DomainType& x) const
+{
+  std::size_t seed = 0;
+  // adding 0.0 maps -0.0 to 0.0, which compare equal and hence need the same hash
+  for (const auto i : Dune::XT::Common::value_range(DMP::DomainType::dimension))
+    seed ^= std::hash<DMP::DomainType::value_type>()(x[i] + 0.0) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  return seed;
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
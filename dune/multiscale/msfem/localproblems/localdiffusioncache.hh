@@ -0,0 +1,89 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_LOCALDIFFUSIONCACHE_HH
+#define DUNE_MULTISCALE_MSFEM_LOCALDIFFUSIONCACHE_HH
+
+#include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/msfem/localproblems/localgridsearch.hh>
+#include <dune/multiscale/problems/base.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+
+/**
+ * \brief Diffusion tensors of one local grid, evaluated once and re-used by all assembly passes
+ *
+ * Local operator, local right hand sides and the coarse matrix/rhs kernels all evaluate the diffusion at the
+ * quadrature points of the same micro cells. For coefficients like SPE10 or Tarbert every evaluation is a virtual
+ * call plus a lookup, this decorator memoizes the tensors instead. With msfem.coefficient_cache
+ *  - "points" tensors are keyed by the exact global evaluation point, results are identical to the uncached ones
+ *  - "cells" one tensor, taken in the micro cell's center, is used for the whole cell. This is only exact for
+ *    coefficients that are piecewise constant on the local grid; falls back to "points" on non-structured grids
+ *
+ * \note Not thread safe. An instance belongs to one coarse cell, whose local problems and coarse integrals are
+ * always assembled by a single thread. The diffusive flux is computed as A(x) * direction (linear problems only).
+ */
+class LocalDiffusionCache : public DMP::DiffusionBase, public boost::noncopyable
+{
+  typedef DMP::DiffusionBase BaseType;
+  typedef StructuredCellIndex<MsFEMTraits::LocalGridViewType> CellIndexType;
+
+public:
+  typedef BaseType::RangeType RangeType;
+
+  //! the cache mode configured in msfem.coefficient_cache, empty if caching is disabled
+  static std::string mode(const DMP::ProblemContainer& problem);
+
+  LocalDiffusionCache(const DMP::DiffusionBase& diffusion,
+                      const MsFEMTraits::LocalGridViewType& grid_view,
+                      const std::string& mode);
+
+  virtual void evaluate(const DMP::DomainType& x, RangeType& y) const override final;
+
+  virtual void diffusiveFlux(const DMP::DomainType& x,
+                             const DMP::JacobianRangeType& direction,
+                             DMP::JacobianRangeType& flux) const override final;
+
+  //! looks up all points, the missing tensors are computed with one evaluate_batch of the wrapped diffusion
+  virtual void evaluate_batch(const std::vector<DMP::DomainType>& x, std::vector<RangeType>& y) const override final;
+
+  virtual void diffusiveFlux_batch(const std::vector<DMP::DomainType>& x,
+                                   const std::vector<DMP::JacobianRangeType>& directions,
+                                   std::vector<DMP::JacobianRangeType>& fluxes) const override final;
+
+  virtual size_t order() const override final;
+
+  //! the structure of the wrapped diffusion
+  virtual DMP::TensorStructure structure() const override final;
+
+  //! number of distinct tensors held
+  std::size_t size() const;
+
+private:
+  struct PointHash
+  {
+    std::size_t operator()(const DMP::DomainType& x) const;
+  };
+
+  const DMP::DiffusionBase& diffusion_;
+  const MsFEMTraits::LocalGridViewType grid_view_;
+  //! only set in "cells" mode
+  std::unique_ptr<const CellIndexType> cell_index_;
+  mutable std::unordered_map<DMP::DomainType, RangeType, PointHash> points_;
+  mutable std::unordered_map<long, RangeType> cells_;
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_LOCALDIFFUSIONCACHE_HH
@@ -5,6 +5,7 @@
 #include <boost/assert.hpp>
 #include <boost/multi_array/multi_array_ref.hpp>
 #include <dune/common/exceptions.hh>
+#include <dune/multiscale/common/grid_creation.hh>
 #include <dune/multiscale/common/mygridfactory.hh>
 #include <dune/multiscale/problems/selector.hh>
 #include <dune/multiscale/tools/misc.hh>
@@ -71,6 +72,7 @@ LocalGridList::LocalGridList(const Problem::ProblemContainer& problem, const Com
     MS_LOG_DEBUG << "rank " << MPIHelper::getCollectiveCommunication().rank() << " lower " << lowerLeft << " upper "
                  << upperRight << std::endl;
     subGridList_[coarse_index] = FactoryType::createLocalGrid(lowerLeft, upperRight, elements_per_dim);
+    std::copy(elements_per_dim.begin(), elements_per_dim.end(), shapes_[coarse_index].begin());
   }
 }
 
@@ -110,6 +112,34 @@ std::size_t LocalGridList::size() const
   return subGridList_.size();
 }
 
+const LocalGridList::ShapeType& LocalGridList::shape(const MsFEMTraits::CoarseEntityType& entity) const
+{
+  const auto found = shapes_.find(coarseGridLeafIndexSet_.index(entity));
+  BOOST_ASSERT_MSG(found != shapes_.end(), "There is no subgrid for the entity you provided!");
+  return found->second;
+}
+
+std::shared_ptr<const NestedProjectionMap>
+LocalGridList::nested_projection(const CommonTraits::GridType& fine_grid) const
+{
+  const auto id = grid_id(fine_grid);
+  if (id == 0)
+    return nullptr;
+  std::lock_guard<std::mutex> lock(nested_projections_mutex_);
+  const auto found = nested_projections_.find(id);
+  return found == nested_projections_.end() ? nullptr : found->second;
+}
+
+void LocalGridList::set_nested_projection(const CommonTraits::GridType& fine_grid,
+                                          std::shared_ptr<const NestedProjectionMap> map) const
+{
+  const auto id = grid_id(fine_grid);
+  if (id == 0)
+    return;
+  std::lock_guard<std::mutex> lock(nested_projections_mutex_);
+  nested_projections_[id] = map;
+}
+
 bool LocalGridList::covers_strict(const MsFEMTraits::CoarseEntityType& coarse_entity,
                                   const MsFEMTraits::LocalEntityType& local_entity)
 {
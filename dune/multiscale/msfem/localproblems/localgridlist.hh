@@ -15,9 +15,11 @@
 #include <dune/common/shared_ptr.hh>
 #include <dune/stuff/grid/entity.hh>
 
+#include <array>
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace Dune {
@@ -26,6 +28,7 @@ namespace Multiscale {
 namespace Problem {
 struct ProblemContainer;
 }
+struct NestedProjectionMap;
 
 //! container for cell problem subgrids
 class LocalGridList : public boost::noncopyable
@@ -34,6 +37,9 @@ class LocalGridList : public boost::noncopyable
   typedef typename LeafIndexSet::IndexType IndexType;
 
 public:
+  //! number of local grid elements per dimension
+  typedef std::array<unsigned int, CommonTraits::world_dim> ShapeType;
+
   LocalGridList(const Dune::Multiscale::Problem::ProblemContainer& problem, const CommonTraits::SpaceType& coarseSpace);
 
   //! TODO toggle commnet. only used in ProxyGridView
@@ -52,6 +58,17 @@ public:
 
   std::size_t size() const;
 
+  //! local grids with the same shape are topologically identical
+  const ShapeType& shape(const MsFEMTraits::CoarseEntityType& entity) const;
+
+  //! MsFEMProjection's transfer of local dofs onto fine_grid, nullptr until it was set
+  std::shared_ptr<const NestedProjectionMap> nested_projection(const CommonTraits::GridType& fine_grid) const;
+  /** caches map for nested_projection, keyed by the grid_id of fine_grid, so a later grid at the same address does
+   * not get this map. Nothing is cached for grids without a grid_id.
+   */
+  void set_nested_projection(const CommonTraits::GridType& fine_grid,
+                             std::shared_ptr<const NestedProjectionMap> map) const;
+
   //! returns true iff all corners of local_entity are inside coarse_entity
   static bool covers_strict(const MsFEMTraits::CoarseEntityType& coarse_entity,
                             const MsFEMTraits::LocalEntityType& local_entity);
@@ -60,13 +77,18 @@ public:
       const MsFEMTraits::CoarseEntityType& coarse_entity,
       const Dune::Geometry<CommonTraits::world_dim, CommonTraits::world_dim, GridImp, GeometryImp>& local_geometry);
   //! returns true if local_entity's center is inside coarse_entity
-  bool covers(const MsFEMTraits::CoarseEntityType& coarse_entity, const MsFEMTraits::LocalEntityType& local_entity);
+  static bool covers(const MsFEMTraits::CoarseEntityType& coarse_entity,
+                     const MsFEMTraits::LocalEntityType& local_entity);
 
 private:
   typedef std::map<IndexType, std::shared_ptr<MsFEMTraits::LocalGridType>> LocalGridStorageType;
 
   const CommonTraits::SpaceType& coarseSpace_;
   LocalGridStorageType subGridList_;
+  std::map<IndexType, ShapeType> shapes_;
+  //! by grid_id of the fine grid
+  mutable std::map<std::size_t, std::shared_ptr<const NestedProjectionMap>> nested_projections_;
+  mutable std::mutex nested_projections_mutex_;
   const LeafIndexSet& coarseGridLeafIndexSet_;
 };
 
@@ -10,6 +10,12 @@
 Dune::Multiscale::LocalGridSearch::EntityVectorType Dune::Multiscale::LocalGridSearch::
 operator()(const PointContainerType& points)
 {
+  {
+    EntityVectorType ret_entities(points.size());
+    if (structured_search(points, ret_entities))
+      return ret_entities;
+  }
+
   typedef typename EntityVectorType::value_type EPV;
   const auto is_null = [&](const EPV& ptr) { return ptr == nullptr; };
   const auto not_null = [&](const EPV& ptr) { return ptr != nullptr; };
@@ -54,6 +60,46 @@ operator()(const PointContainerType& points)
   return ret_entities;
 }
 
+bool Dune::Multiscale::LocalGridSearch::structured_search(const PointContainerType& points,
+                                                         EntityVectorType& entities)
+{
+  if (points.empty() || !coarse_cell_index_->valid())
+    return false;
+  // the points of one fine element are inside a single coarse cell, its center decides which
+  CommonTraits::DomainType center(0);
+  for (const auto& point : points)
+    center += point;
+  center /= points.size();
+  typename CommonTraits::EntityType::EntitySeed coarse_seed;
+  if (!coarse_cell_index_->find(center, coarse_seed))
+    return false;
+  const auto& grid = static_view_.grid();
+  const auto coarse_entity = grid.entity(coarse_seed);
+  if (!covers_strict(coarse_entity, points.begin(), points.end()))
+    return false;
+
+  const auto index = grid.leafIndexSet().index(coarse_entity);
+  const auto& localgrid = gridlist_.getSubGrid(coarse_entity);
+  auto& local_index = local_cell_indices_[index];
+  if (!local_index)
+    local_index = Dune::XT::Common::make_unique<LocalCellIndexType>(localgrid.leafGridView());
+  if (!local_index->valid())
+    return false;
+
+  typedef typename EntityVectorType::value_type::element_type LocalEntityType;
+  typename LocalEntityType::EntitySeed local_seed;
+  for (const auto i : Dune::XT::Common::value_range(points.size())) {
+    if (!local_index->find(points[i], local_seed))
+      return false;
+    auto local_entity = localgrid.entity(local_seed);
+    if (!Stuff::Grid::reference_element(local_entity).checkInside(local_entity.geometry().local(points[i])))
+      return false;
+    entities[i] = Dune::XT::Common::make_unique<LocalEntityType>(std::move(local_entity));
+  }
+  current_coarse_entity_ = Dune::XT::Common::make_unique<MsFEMTraits::CoarseEntityType>(coarse_entity);
+  return true;
+}
+
 bool Dune::Multiscale::LocalGridSearch::covers_strict(const CommonTraits::SpaceType::EntityType& coarse_entity,
                                                       const Dune::Multiscale::LocalGridSearch::PointIterator first,
                                                       const Dune::Multiscale::LocalGridSearch::PointIterator last)
@@ -73,6 +119,7 @@ Dune::Multiscale::LocalGridSearch::LocalGridSearch(const CommonTraits::SpaceType
   , gridlist_(gridlist)
   , static_view_(coarse_space_.grid_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>())
   , static_iterator_(nullptr)
+  , coarse_cell_index_(std::make_shared<CoarseCellIndexType>(static_view_))
 {
 }
 
@@ -81,6 +128,7 @@ Dune::Multiscale::LocalGridSearch::LocalGridSearch(const Dune::Multiscale::Local
   , gridlist_(other.gridlist_)
   , static_view_(coarse_space_.grid_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>())
   , static_iterator_(nullptr)
+  , coarse_cell_index_(other.coarse_cell_index_)
 {
 }
 
@@ -3,12 +3,146 @@
 
 #include <dune/multiscale/msfem/msfem_traits.hh>
 #include <dune/stuff/grid/search.hh>
+#include <dune/stuff/grid/entity.hh>
+#include <dune/common/fvector.hh>
+#include <dune/geometry/referenceelements.hh>
+#include <dune/xt/common/ranges.hh>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace Dune {
 namespace Multiscale {
 
 class LocalGridList;
 
+/** \brief O(1) point location on axis aligned, equidistant cube grids (YaspGrid, SPGrid)
+ *
+ * A single pass over the view's elements maps each element's lexicographic cell index to its seed.
+ * If the view turns out not to be such a grid, valid() is false and a generic search has to be used.
+ */
+template <class GridViewImp>
+class StructuredCellIndex
+{
+  static constexpr int dim = GridViewImp::dimension;
+  typedef typename GridViewImp::ctype ctype;
+  typedef typename GridViewImp::template Codim<0>::Entity EntityType;
+  typedef typename EntityType::EntitySeed SeedType;
+
+public:
+  typedef FieldVector<ctype, dim> DomainType;
+
+  explicit StructuredCellIndex(const GridViewImp& view)
+    : valid_(true)
+    , origin_(std::numeric_limits<ctype>::max())
+    , width_(0)
+  {
+    std::vector<DomainType> lower_corners;
+    for (const auto& entity : elements(view)) {
+      const auto& geometry = entity.geometry();
+      if (!entity.type().isCube() || !geometry.affine()) {
+        valid_ = false;
+        return;
+      }
+      const auto lower = geometry.corner(0);
+      auto width = geometry.corner(geometry.corners() - 1);
+      width -= lower;
+      if (lower_corners.empty())
+        width_ = width;
+      for (const auto i : Dune::XT::Common::value_range(dim)) {
+        // axis aligned cubes have their first and last corner on the diagonal
+        if (width[i] <= 0 || std::abs(width[i] - width_[i]) > tolerance_ * width_[i]) {
+          valid_ = false;
+          return;
+        }
+        origin_[i] = std::min(origin_[i], lower[i]);
+      }
+      lower_corners.push_back(lower);
+      seeds_.push_back(entity.seed());
+    }
+    if (seeds_.empty()) {
+      valid_ = false;
+      return;
+    }
+    std::fill(cells_.begin(), cells_.end(), 0);
+    std::vector<std::array<long, dim>> multi_indices(seeds_.size());
+    for (const auto e : Dune::XT::Common::value_range(seeds_.size()))
+      for (const auto i : Dune::XT::Common::value_range(dim)) {
+        multi_indices[e][i] = std::lround((lower_corners[e][i] - origin_[i]) / width_[i]);
+        cells_[i] = std::max(cells_[i], multi_indices[e][i] + 1);
+      }
+    long total = 1;
+    for (const auto cells : cells_)
+      total *= cells;
+    positions_.assign(total, -1);
+    for (const auto e : Dune::XT::Common::value_range(seeds_.size()))
+      positions_[linear_index(multi_indices[e])] = e;
+  }
+
+  bool valid() const
+  {
+    return valid_;
+  }
+
+  /** \param[out] seed seed of the element containing point, a point on an element face is assigned to the upper
+   * \return false if point is outside of the view
+   */
+  bool find(const DomainType& point, SeedType& seed) const
+  {
+    const auto cell = position(point);
+    if (cell < 0)
+      return false;
+    seed = seeds_[cell];
+    return true;
+  }
+
+  /** \return a number in [0, number of view elements) that identifies the element containing point, -1 if point is
+   * outside of the view
+   */
+  long position(const DomainType& point) const
+  {
+    if (!valid_)
+      return -1;
+    std::array<long, dim> multi_index;
+    for (const auto i : Dune::XT::Common::value_range(dim)) {
+      const auto coordinate = (point[i] - origin_[i]) / width_[i];
+      auto& index = multi_index[i];
+      index = long(std::floor(coordinate));
+      // points on the outer boundary belong to the first/last cell
+      if (index == cells_[i] && coordinate <= cells_[i] + tolerance_)
+        --index;
+      else if (index == -1 && coordinate >= -tolerance_)
+        index = 0;
+      if (index < 0 || index >= cells_[i])
+        return -1;
+    }
+    return positions_[linear_index(multi_index)];
+  }
+
+private:
+  long linear_index(const std::array<long, dim>& multi_index) const
+  {
+    long index = 0;
+    for (int i = dim - 1; i >= 0; --i)
+      index = index * cells_[i] + multi_index[i];
+    return index;
+  }
+
+  static constexpr ctype tolerance_ = 1e-10;
+  bool valid_;
+  DomainType origin_;
+  DomainType width_;
+  std::array<long, dim> cells_;
+  std::vector<SeedType> seeds_;
+  //! lexicographic cell index -> position in seeds_, -1 for cells not in the view
+  std::vector<long> positions_;
+};
+
 //! given a Localgridlist, facilitate searching for evaluation points in a pseudo-hierachical manner
 class LocalGridSearch : public DSG::EntitySearchBase<MsFEMTraits::LocalGridViewType>
 {
@@ -18,6 +152,8 @@ class LocalGridSearch : public DSG::EntitySearchBase<MsFEMTraits::LocalGridViewT
   typedef typename CommonTraits::SpaceType::EntityType::EntityPointer CoarseEntityPointerType;
   typedef std::vector<CommonTraits::DomainType> PointContainerType;
   typedef PointContainerType::const_iterator PointIterator;
+  typedef StructuredCellIndex<CommonTraits::InteriorGridViewType> CoarseCellIndexType;
+  typedef StructuredCellIndex<MsFEMTraits::LocalGridViewType> LocalCellIndexType;
 
 public:
   typedef typename BaseType::EntityVectorType EntityVectorType;
@@ -34,6 +170,9 @@ public:
                      const PointIterator last);
 
 private:
+  //! direct index computation for structured grids, returns false if the generic search is needed
+  bool structured_search(const PointContainerType& points, EntityVectorType& entities);
+
   const CommonTraits::SpaceType& coarse_space_;
   const LocalGridList& gridlist_;
   std::map<IndexType, std::unique_ptr<PerGridSearchType>> coarse_searches_;
@@ -41,6 +180,8 @@ private:
   CommonTraits::InteriorGridViewType static_view_;
   typedef typename CommonTraits::InteriorGridViewType::template Codim<0>::Iterator InteriorIteratorType;
   std::unique_ptr<InteriorIteratorType> static_iterator_;
+  std::shared_ptr<const CoarseCellIndexType> coarse_cell_index_;
+  std::map<IndexType, std::unique_ptr<LocalCellIndexType>> local_cell_indices_;
 };
 
 } // namespace Multiscale {
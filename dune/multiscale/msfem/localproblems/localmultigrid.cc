@@ -0,0 +1,529 @@
+#include <config.h>
+
+#include "localmultigrid.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/geometry/quadraturerules.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/logging.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/problems/selector.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace Dune {
+namespace Multiscale {
+
+static double dot(const std::vector<double>& x, const std::vector<double>& y)
+{
+  double result = 0;
+  for (const auto i : Dune::XT::Common::value_range(x.size()))
+    result += x[i] * y[i];
+  return result;
+}
+
+LocalMultigridInverse::LocalMultigridInverse(const MsFEMTraits::LocalSpaceType& space,
+                                             const DMP::DiffusionBase& diffusion,
+                                             const std::set<size_t>& constrained,
+                                             const DMP::ProblemContainer& problem)
+  : precision_(problem.config().get("msfem.localproblemsolver_precision", 1e-5))
+  , max_iterations_(problem.config().get("msfem.multigrid.max_iter", std::size_t(200)))
+  , smoothing_steps_(problem.config().get("msfem.multigrid.smoothing_steps", std::size_t(2)))
+  , damping_(problem.config().get("msfem.multigrid.damping", 0.6))
+  , verbose_(problem.config().get("msfem.local_solver_verbose", 0))
+{
+  const auto& view = space.grid_view();
+  Level finest;
+  const auto origin = span_lattice(view, finest);
+
+  // element matrices with the quadrature of the assembled operator, cell averaged tensors and the DoF of each
+  // lattice vertex
+  const auto offsets = corner_offsets(finest);
+  finest.coefficients.assign(finest.num_cells * dim * dim, 0.);
+  finest.element_matrices.assign(finest.num_cells * corners * corners, 0.);
+  dof_of_vertex_.assign(finest.num_vertices, std::numeric_limits<std::size_t>::max());
+  std::vector<long> vertex_of_dof(space.mapper().size(), -1);
+  std::vector<DMP::DomainType> points;
+  std::vector<DMP::DiffusionBase::RangeType> tensors;
+  DMP::DomainType flux;
+  for (const auto& entity : elements(view)) {
+    const auto& geometry = entity.geometry();
+    const auto lower = geometry.corner(0);
+    long cell = 0;
+    for (const auto i : Dune::XT::Common::value_range(dim))
+      cell += std::lround((lower[i] - origin[i]) / finest.width[i]) * finest.cell_strides[i];
+    const auto& lg_points = space.lagrange_points(entity);
+    if (lg_points.size() != corners)
+      DUNE_THROW(NotImplemented, "msfem.local_solver = multigrid needs a Q1 local space");
+    const auto dofs = space.mapper().globalIndices(entity);
+    const auto cell_vertex = first_vertex(finest, cell);
+    // the lattice corner of each local base function
+    std::vector<std::size_t> corner_of_base(corners, corners);
+    for (const auto k : Dune::XT::Common::value_range(lg_points.size())) {
+      const auto point = geometry.global(lg_points[k]);
+      long vertex = 0;
+      for (const auto i : Dune::XT::Common::value_range(dim))
+        vertex += std::lround((point[i] - origin[i]) / finest.width[i]) * finest.strides[i];
+      dof_of_vertex_[vertex] = dofs[k];
+      vertex_of_dof[dofs[k]] = vertex;
+      for (const auto l : Dune::XT::Common::value_range(corners))
+        if (cell_vertex + offsets[l] == vertex)
+          corner_of_base[k] = l;
+    }
+    if (std::any_of(corner_of_base.begin(), corner_of_base.end(), [](const std::size_t l) { return l >= corners; }))
+      DUNE_THROW(NotImplemented, "msfem.local_solver = multigrid needs a Q1 local space");
+
+    // same integrand order as GDT's elliptic local evaluation
+    const auto base = space.base_function_set(entity);
+    const auto gradient_order = std::max(int(base.order()) - 1, 0);
+    const auto& quadrature =
+        QuadratureRules<double, dim>::rule(entity.type(), int(diffusion.order()) + 2 * gradient_order);
+    points.clear();
+    for (const auto& quad_point : quadrature)
+      points.push_back(geometry.global(quad_point.position()));
+    diffusion.evaluate_batch(points, tensors);
+    const auto element = &finest.element_matrices[cell * corners * corners];
+    const auto coefficients = &finest.coefficients[cell * dim * dim];
+    const auto volume = geometry.volume();
+    for (const auto q : Dune::XT::Common::value_range(quadrature.size())) {
+      const auto& x = quadrature[q].position();
+      const auto factor = quadrature[q].weight() * geometry.integrationElement(x);
+      const auto jacobians = base.jacobian(x);
+      for (const auto j : Dune::XT::Common::value_range(corners)) {
+        tensors[q].mv(jacobians[j][0], flux);
+        for (const auto i : Dune::XT::Common::value_range(corners))
+          element[corner_of_base[i] * corners + corner_of_base[j]] += factor * (flux * jacobians[i][0]);
+      }
+      for (const auto a : Dune::XT::Common::value_range(dim))
+        for (const auto b : Dune::XT::Common::value_range(dim))
+          coefficients[a * dim + b] += factor / volume * tensors[q][a][b];
+    }
+  }
+  if (std::any_of(vertex_of_dof.begin(), vertex_of_dof.end(), [](const long vertex) { return vertex < 0; })
+      || long(vertex_of_dof.size()) != finest.num_vertices)
+    DUNE_THROW(NotImplemented, "msfem.local_solver = multigrid needs a Q1 local space");
+  finest.constrained.assign(finest.num_vertices, 0);
+  for (const auto dof : constrained)
+    finest.constrained[vertex_of_dof[dof]] = 1;
+  init_operator(finest);
+  levels_.push_back(std::move(finest));
+
+  while (coarsenable(levels_.back()))
+    add_coarser_level();
+  factorize_coarsest();
+
+  const auto size = levels_.front().num_vertices;
+  cg_solution_.resize(size);
+  cg_residual_.resize(size);
+  direction_.resize(size);
+  product_.resize(size);
+}
+
+bool LocalMultigridInverse::coarsenable(const MsFEMTraits::LocalSpaceType& space)
+{
+  Level finest;
+  span_lattice(space.grid_view(), finest);
+  return coarsenable(finest);
+}
+
+bool LocalMultigridInverse::coarsenable(const Level& level)
+{
+  return std::all_of(level.cells.begin(), level.cells.end(), [](const long cells) { return cells % 2 == 0; });
+}
+
+std::array<double, LocalMultigridInverse::dim>
+LocalMultigridInverse::span_lattice(const MsFEMTraits::LocalGridViewType& view, Level& level)
+{
+  std::array<double, dim> origin, upper;
+  origin.fill(std::numeric_limits<double>::max());
+  upper.fill(std::numeric_limits<double>::lowest());
+  bool first = true;
+  for (const auto& entity : elements(view)) {
+    const auto& geometry = entity.geometry();
+    if (!entity.type().isCube() || !geometry.affine())
+      DUNE_THROW(NotImplemented, "msfem.local_solver = multigrid needs axis aligned cube grids");
+    const auto lower = geometry.corner(0);
+    const auto diagonal = geometry.corner(geometry.corners() - 1);
+    for (const auto i : Dune::XT::Common::value_range(dim)) {
+      const auto width = diagonal[i] - lower[i];
+      if (first)
+        level.width[i] = width;
+      else if (width <= 0 || std::abs(width - level.width[i]) > 1e-10 * level.width[i])
+        DUNE_THROW(NotImplemented, "msfem.local_solver = multigrid needs equidistant local grids");
+      origin[i] = std::min(origin[i], double(lower[i]));
+      upper[i] = std::max(upper[i], double(diagonal[i]));
+    }
+    first = false;
+  }
+  for (const auto i : Dune::XT::Common::value_range(dim))
+    level.cells[i] = std::lround((upper[i] - origin[i]) / level.width[i]);
+  init_lattice(level);
+  return origin;
+}
+
+void LocalMultigridInverse::init_lattice(Level& level)
+{
+  level.cell_strides[0] = 1;
+  level.strides[0] = 1;
+  for (const auto i : Dune::XT::Common::value_range(1, dim)) {
+    level.cell_strides[i] = level.cell_strides[i - 1] * level.cells[i - 1];
+    level.strides[i] = level.strides[i - 1] * (level.cells[i - 1] + 1);
+  }
+  level.num_cells = level.cell_strides[dim - 1] * level.cells[dim - 1];
+  level.num_vertices = level.strides[dim - 1] * (level.cells[dim - 1] + 1);
+}
+
+std::array<long, LocalMultigridInverse::corners> LocalMultigridInverse::corner_offsets(const Level& level)
+{
+  std::array<long, corners> offsets;
+  for (const auto l : Dune::XT::Common::value_range(corners)) {
+    offsets[l] = 0;
+    for (const auto a : Dune::XT::Common::value_range(dim))
+      offsets[l] += ((l >> a) & 1) * level.strides[a];
+  }
+  return offsets;
+}
+
+long LocalMultigridInverse::first_vertex(const Level& level, const long cell)
+{
+  long rest = cell, vertex = 0;
+  for (const auto a : Dune::XT::Common::value_range(dim)) {
+    vertex += (rest % level.cells[a]) * level.strides[a];
+    rest /= level.cells[a];
+  }
+  return vertex;
+}
+
+void LocalMultigridInverse::init_operator(Level& level) const
+{
+  if (level.element_matrices.empty()) {
+    // 1D integrals of the linear shape functions (and their derivatives) on [0, 1]
+    const auto mass = [](const long p, const long q) { return p == q ? 1. / 3. : 1. / 6.; };
+    const auto stiffness = [](const long p, const long q) { return p == q ? 1. : -1.; };
+    const auto mixed = [](const long p, const long /*q*/) { return p ? .5 : -.5; };
+    double volume = 1;
+    for (const auto width : level.width)
+      volume *= width;
+    // \int_T \partial_a \phi_i \partial_b \phi_j on one cell, at [((a * dim + b) * corners + i) * corners + j]
+    std::vector<double> reference(dim * dim * corners * corners, 0.);
+    for (const auto a : Dune::XT::Common::value_range(dim))
+      for (const auto b : Dune::XT::Common::value_range(dim))
+        for (const auto i : Dune::XT::Common::value_range(corners))
+          for (const auto j : Dune::XT::Common::value_range(corners)) {
+            double value = volume;
+            for (const auto c : Dune::XT::Common::value_range(dim)) {
+              const long p = (i >> c) & 1;
+              const long q = (j >> c) & 1;
+              if (a == b && c == a)
+                value *= stiffness(p, q) / (level.width[c] * level.width[c]);
+              else if (c == a)
+                value *= mixed(p, q) / level.width[c];
+              else if (c == b)
+                value *= mixed(q, p) / level.width[c];
+              else
+                value *= mass(p, q);
+            }
+            reference[((a * dim + b) * corners + i) * corners + j] = value;
+          }
+    level.element_matrices.assign(level.num_cells * corners * corners, 0.);
+    for (const auto cell : Dune::XT::Common::value_range(level.num_cells))
+      for (const auto ab : Dune::XT::Common::value_range(dim * dim)) {
+        const auto coefficient = level.coefficients[cell * dim * dim + ab];
+        for (const auto k : Dune::XT::Common::value_range(corners * corners))
+          level.element_matrices[cell * corners * corners + k] += coefficient * reference[ab * corners * corners + k];
+      }
+  }
+
+  const auto offsets = corner_offsets(level);
+  std::vector<double> diagonal(level.num_vertices, 0.);
+  for (const auto cell : Dune::XT::Common::value_range(level.num_cells)) {
+    const auto base = first_vertex(level, cell);
+    for (const auto l : Dune::XT::Common::value_range(corners))
+      diagonal[base + offsets[l]] += level.element_matrices[(cell * corners + l) * corners + l];
+  }
+  level.inverse_diagonal.resize(level.num_vertices);
+  for (const auto v : Dune::XT::Common::value_range(level.num_vertices))
+    level.inverse_diagonal[v] = level.constrained[v] ? 1. : 1. / diagonal[v];
+  level.rhs.assign(level.num_vertices, 0.);
+  level.solution.assign(level.num_vertices, 0.);
+  level.residual.assign(level.num_vertices, 0.);
+}
+
+void LocalMultigridInverse::add_coarser_level()
+{
+  const auto& fine = levels_.back();
+  Level coarse;
+  for (const auto a : Dune::XT::Common::value_range(dim)) {
+    coarse.cells[a] = fine.cells[a] / 2;
+    coarse.width[a] = 2 * fine.width[a];
+  }
+  init_lattice(coarse);
+
+  // averaged tensors of the 2^d children
+  coarse.coefficients.assign(coarse.num_cells * dim * dim, 0.);
+  for (const auto cell : Dune::XT::Common::value_range(fine.num_cells)) {
+    long rest = cell, coarse_cell = 0;
+    for (const auto a : Dune::XT::Common::value_range(dim)) {
+      coarse_cell += ((rest % fine.cells[a]) / 2) * coarse.cell_strides[a];
+      rest /= fine.cells[a];
+    }
+    for (const auto ab : Dune::XT::Common::value_range(dim * dim))
+      coarse.coefficients[coarse_cell * dim * dim + ab] += fine.coefficients[cell * dim * dim + ab] / corners;
+  }
+  coarse.constrained.assign(coarse.num_vertices, 0);
+  for (const auto vertex : Dune::XT::Common::value_range(coarse.num_vertices)) {
+    long rest = vertex, fine_vertex = 0;
+    for (const auto a : Dune::XT::Common::value_range(dim)) {
+      fine_vertex += 2 * (rest % (coarse.cells[a] + 1)) * fine.strides[a];
+      rest /= coarse.cells[a] + 1;
+    }
+    coarse.constrained[vertex] = fine.constrained[fine_vertex];
+  }
+  init_operator(coarse);
+  levels_.push_back(std::move(coarse));
+}
+
+void LocalMultigridInverse::apply_operator(const Level& level,
+                                           const std::vector<double>& x,
+                                           std::vector<double>& y) const
+{
+  const auto offsets = corner_offsets(level);
+  std::fill(y.begin(), y.end(), 0.);
+  std::array<double, corners> local_x;
+  for (const auto cell : Dune::XT::Common::value_range(level.num_cells)) {
+    const auto base = first_vertex(level, cell);
+    // constrained columns only multiply zero DoFs, dropping them keeps the operator symmetric
+    for (const auto l : Dune::XT::Common::value_range(corners)) {
+      const auto vertex = base + offsets[l];
+      local_x[l] = level.constrained[vertex] ? 0. : x[vertex];
+    }
+    const auto element = &level.element_matrices[cell * corners * corners];
+    for (const auto i : Dune::XT::Common::value_range(corners)) {
+      double value = 0;
+      for (const auto j : Dune::XT::Common::value_range(corners))
+        value += element[i * corners + j] * local_x[j];
+      y[base + offsets[i]] += value;
+    }
+  }
+  for (const auto vertex : Dune::XT::Common::value_range(level.num_vertices))
+    if (level.constrained[vertex])
+      y[vertex] = x[vertex];
+}
+
+void LocalMultigridInverse::factorize_coarsest()
+{
+  const auto& level = levels_.back();
+  const long size = level.num_vertices;
+  coarsest_bandwidth_ = 0;
+  for (const auto stride : level.strides)
+    coarsest_bandwidth_ += stride;
+  const long width = coarsest_bandwidth_ + 1;
+  coarsest_factor_.assign(size * width, 0.);
+  const auto entry = [&](const long i, const long j) -> double& { return coarsest_factor_[i * width + i - j]; };
+
+  // lower triangle of the operator as applied by apply_operator
+  const auto offsets = corner_offsets(level);
+  for (const auto cell : Dune::XT::Common::value_range(level.num_cells)) {
+    const auto base = first_vertex(level, cell);
+    for (const auto i : Dune::XT::Common::value_range(corners))
+      for (const auto j : Dune::XT::Common::value_range(corners)) {
+        const auto row = base + offsets[i];
+        const auto col = base + offsets[j];
+        if (row >= col && !level.constrained[row] && !level.constrained[col])
+          entry(row, col) += level.element_matrices[(cell * corners + i) * corners + j];
+      }
+  }
+  for (const auto vertex : Dune::XT::Common::value_range(size))
+    if (level.constrained[vertex])
+      entry(vertex, vertex) = 1.;
+
+  // in place, column by column
+  for (const auto j : Dune::XT::Common::value_range(size)) {
+    for (const auto k : Dune::XT::Common::value_range(std::max(0l, j - coarsest_bandwidth_), j))
+      entry(j, j) -= entry(j, k) * entry(j, k);
+    if (!(entry(j, j) > 0.))
+      DUNE_THROW(InvalidStateException, "coarsest multigrid level of a local problem is not positive definite");
+    entry(j, j) = std::sqrt(entry(j, j));
+    for (const auto i : Dune::XT::Common::value_range(j + 1, std::min(size, j + width))) {
+      for (const auto k : Dune::XT::Common::value_range(std::max(0l, i - coarsest_bandwidth_), j))
+        entry(i, j) -= entry(i, k) * entry(j, k);
+      entry(i, j) /= entry(j, j);
+    }
+  }
+  if (verbose_ > 0)
+    MS_LOG_DEBUG << "local multigrid: " << levels_.size() << " levels, coarsest with " << size
+                 << " vertices and half bandwidth " << coarsest_bandwidth_ << std::endl;
+}
+
+void LocalMultigridInverse::solve_coarsest(const Level& level) const
+{
+  const long size = level.num_vertices;
+  const long width = coarsest_bandwidth_ + 1;
+  const auto entry = [&](const long i, const long j) { return coarsest_factor_[i * width + i - j]; };
+  auto& x = level.solution;
+  // L y = rhs, then L^T x = y
+  for (const auto i : Dune::XT::Common::value_range(size)) {
+    double value = level.rhs[i];
+    for (const auto k : Dune::XT::Common::value_range(std::max(0l, i - coarsest_bandwidth_), i))
+      value -= entry(i, k) * x[k];
+    x[i] = value / entry(i, i);
+  }
+  for (long i = size - 1; i >= 0; --i) {
+    double value = x[i];
+    for (const auto k : Dune::XT::Common::value_range(i + 1, std::min(size, i + width)))
+      value -= entry(k, i) * x[k];
+    x[i] = value / entry(i, i);
+  }
+}
+
+void LocalMultigridInverse::smooth(const Level& level) const
+{
+  for (std::size_t step = 0; step < smoothing_steps_; ++step) {
+    apply_operator(level, level.solution, level.residual);
+    for (const auto v : Dune::XT::Common::value_range(level.num_vertices))
+      level.solution[v] += damping_ * level.inverse_diagonal[v] * (level.rhs[v] - level.residual[v]);
+  }
+}
+
+void LocalMultigridInverse::v_cycle(const std::size_t level_index) const
+{
+  const auto& level = levels_[level_index];
+  std::fill(level.solution.begin(), level.solution.end(), 0.);
+  if (level_index + 1 == levels_.size()) {
+    solve_coarsest(level);
+    return;
+  }
+  const auto& coarse = levels_[level_index + 1];
+  smooth(level);
+  apply_operator(level, level.solution, level.residual);
+  for (const auto v : Dune::XT::Common::value_range(level.num_vertices))
+    level.residual[v] = level.rhs[v] - level.residual[v];
+  restrict_residual(level, coarse);
+  v_cycle(level_index + 1);
+  prolongate_correction(coarse, level);
+  smooth(level);
+}
+
+void LocalMultigridInverse::restrict_residual(const Level& fine, const Level& coarse) const
+{
+  std::fill(coarse.rhs.begin(), coarse.rhs.end(), 0.);
+  std::array<long, dim> multi_index;
+  for (const auto vertex : Dune::XT::Common::value_range(fine.num_vertices)) {
+    if (fine.constrained[vertex])
+      continue;
+    long rest = vertex;
+    for (const auto a : Dune::XT::Common::value_range(dim)) {
+      multi_index[a] = rest % (fine.cells[a] + 1);
+      rest /= fine.cells[a] + 1;
+    }
+    // transposed trilinear interpolation, odd fine indices lie between two coarse vertices
+    for (const auto combination : Dune::XT::Common::value_range(corners)) {
+      double weight = 1;
+      long coarse_vertex = 0;
+      bool contributes = true;
+      for (const auto a : Dune::XT::Common::value_range(dim)) {
+        const long upper = (combination >> a) & 1;
+        if (multi_index[a] % 2 == 0) {
+          contributes = contributes && !upper;
+          coarse_vertex += (multi_index[a] / 2) * coarse.strides[a];
+        } else {
+          weight *= .5;
+          coarse_vertex += ((multi_index[a] - 1) / 2 + upper) * coarse.strides[a];
+        }
+      }
+      if (contributes)
+        coarse.rhs[coarse_vertex] += weight * fine.residual[vertex];
+    }
+  }
+  for (const auto vertex : Dune::XT::Common::value_range(coarse.num_vertices))
+    if (coarse.constrained[vertex])
+      coarse.rhs[vertex] = 0.;
+}
+
+void LocalMultigridInverse::prolongate_correction(const Level& coarse, const Level& fine) const
+{
+  std::array<long, dim> multi_index;
+  for (const auto vertex : Dune::XT::Common::value_range(fine.num_vertices)) {
+    if (fine.constrained[vertex])
+      continue;
+    long rest = vertex;
+    for (const auto a : Dune::XT::Common::value_range(dim)) {
+      multi_index[a] = rest % (fine.cells[a] + 1);
+      rest /= fine.cells[a] + 1;
+    }
+    for (const auto combination : Dune::XT::Common::value_range(corners)) {
+      double weight = 1;
+      long coarse_vertex = 0;
+      bool contributes = true;
+      for (const auto a : Dune::XT::Common::value_range(dim)) {
+        const long upper = (combination >> a) & 1;
+        if (multi_index[a] % 2 == 0) {
+          contributes = contributes && !upper;
+          coarse_vertex += (multi_index[a] / 2) * coarse.strides[a];
+        } else {
+          weight *= .5;
+          coarse_vertex += ((multi_index[a] - 1) / 2 + upper) * coarse.strides[a];
+        }
+      }
+      if (contributes)
+        fine.solution[vertex] += weight * coarse.solution[coarse_vertex];
+    }
+  }
+}
+
+void LocalMultigridInverse::apply(const VectorType& rhs, VectorType& solution) const
+{
+  const auto& b = rhs.backend();
+  auto& x = solution.backend();
+  const auto& finest = levels_.front();
+  for (const auto vertex : Dune::XT::Common::value_range(finest.num_vertices))
+    cg_residual_[vertex] = finest.constrained[vertex] ? 0. : b[dof_of_vertex_[vertex]][0];
+  std::fill(cg_solution_.begin(), cg_solution_.end(), 0.);
+
+  // preconditioned conjugate gradients, one V-cycle per iteration
+  const auto initial_norm = std::sqrt(dot(cg_residual_, cg_residual_));
+  bool converged = initial_norm == 0.;
+  std::size_t iteration = 0;
+  if (!converged) {
+    finest.rhs = cg_residual_;
+    v_cycle(0);
+    direction_ = finest.solution;
+    auto preconditioned_norm = dot(cg_residual_, finest.solution);
+    for (; iteration < max_iterations_ && !converged; ++iteration) {
+      apply_operator(finest, direction_, product_);
+      const auto alpha = preconditioned_norm / dot(direction_, product_);
+      for (const auto v : Dune::XT::Common::value_range(finest.num_vertices)) {
+        cg_solution_[v] += alpha * direction_[v];
+        cg_residual_[v] -= alpha * product_[v];
+      }
+      const auto norm = std::sqrt(dot(cg_residual_, cg_residual_));
+      if (verbose_ > 1)
+        MS_LOG_DEBUG << "local multigrid CG iteration " << iteration << ", reduction " << norm / initial_norm
+                     << std::endl;
+      converged = norm <= precision_ * initial_norm;
+      if (converged)
+        break;
+      finest.rhs = cg_residual_;
+      v_cycle(0);
+      const auto next_norm = dot(cg_residual_, finest.solution);
+      const auto beta = next_norm / preconditioned_norm;
+      preconditioned_norm = next_norm;
+      for (const auto v : Dune::XT::Common::value_range(finest.num_vertices))
+        direction_[v] = finest.solution[v] + beta * direction_[v];
+    }
+  }
+  if (!converged)
+    DUNE_THROW(InvalidStateException,
+               "multigrid preconditioned CG for local problem did not converge in " << max_iterations_
+                                                                                       << " iterations");
+  if (verbose_ > 0)
+    MS_LOG_DEBUG << "local multigrid CG converged after " << iteration + 1 << " iterations on " << levels_.size()
+                 << " levels" << std::endl;
+  for (const auto vertex : Dune::XT::Common::value_range(finest.num_vertices))
+    x[dof_of_vertex_[vertex]][0] = cg_solution_[vertex];
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
@@ -0,0 +1,126 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_LOCALMULTIGRID_HH
+#define DUNE_MULTISCALE_MSFEM_LOCALMULTIGRID_HH
+
+#include <dune/multiscale/common/la_backend.hh>
+#include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/problems/base.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <cstddef>
+#include <set>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+
+/**
+ * \brief CG solver for local problems on structured cube grids, preconditioned by geometric multigrid
+ *
+ * The Q1 stiffness operator is applied cell by cell from stored element matrices, no factorization of the local grid
+ * is computed and LocalProblemOperator does not assemble its sparse system matrix for this solver, it only allocates
+ * it with the shared pattern. On the local grid the element matrices are integrated with the quadrature of the
+ * assembled GDT::Operators::EllipticCG, so the operator is the assembled one for any coefficient. Coarser levels are obtained
+ * by repeatedly merging 2^d cells, with the children's cell averaged tensors, as long as the number of cells per
+ * direction is even; their element matrices are integrated analytically. One V-cycle with damped Jacobi smoothing
+ * and trilinear transfer is used as preconditioner, the coarsest level is solved exactly with a banded Cholesky
+ * factorization. Memory is O(local DoFs) as long as the coarsest level is small, ie. the cell counts per direction
+ * contain enough factors of two. Grids with an odd number of cells in some direction can not be coarsened at all,
+ * LocalProblemOperator then uses the sparse direct solver instead, see coarsenable.
+ *
+ * Needs symmetric diffusion. Dirichlet constrained DoFs are kept at zero, ie. the right hand sides have to vanish
+ * there.
+ */
+class LocalMultigridInverse : public boost::noncopyable
+{
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType VectorType;
+  static constexpr int dim = MsFEMTraits::LocalGridType::dimension;
+  static constexpr std::size_t corners = 1 << dim;
+
+  struct Level
+  {
+    std::array<long, dim> cells;
+    std::array<double, dim> width;
+    //! lexicographic cell and vertex strides
+    std::array<long, dim> cell_strides;
+    std::array<long, dim> strides;
+    long num_cells;
+    long num_vertices;
+    //! per cell, row major dim x dim, averaged over the cell
+    std::vector<double> coefficients;
+    //! per cell, row major corners x corners, corners numbered lexicographically
+    std::vector<double> element_matrices;
+    std::vector<char> constrained;
+    std::vector<double> inverse_diagonal;
+    mutable std::vector<double> rhs;
+    mutable std::vector<double> solution;
+    mutable std::vector<double> residual;
+  };
+
+public:
+  LocalMultigridInverse(const MsFEMTraits::LocalSpaceType& space,
+                        const DMP::DiffusionBase& diffusion,
+                        const std::set<size_t>& constrained,
+                        const DMP::ProblemContainer& problem);
+
+  //! true if space's grid has an even number of cells in each direction, ie. there is at least one coarser level
+  static bool coarsenable(const MsFEMTraits::LocalSpaceType& space);
+
+  //! solves for one right hand side, not thread safe
+  void apply(const VectorType& rhs, VectorType& solution) const;
+
+private:
+  //! y = A x on level
+  void apply_operator(const Level& level, const std::vector<double>& x, std::vector<double>& y) const;
+  //! one V-cycle for level.rhs, result in level.solution
+  void v_cycle(const std::size_t level_index) const;
+  void smooth(const Level& level) const;
+  void restrict_residual(const Level& fine, const Level& coarse) const;
+  void prolongate_correction(const Level& coarse, const Level& fine) const;
+
+  //! cells, widths, strides and sizes of the lattice spanned by view, returns its lowest corner
+  static std::array<double, dim> span_lattice(const MsFEMTraits::LocalGridViewType& view, Level& level);
+  static bool coarsenable(const Level& level);
+  //! strides and sizes from level.cells
+  static void init_lattice(Level& level);
+  //! lattice offsets of a cell's corners from its lowest vertex
+  static std::array<long, corners> corner_offsets(const Level& level);
+  //! lowest vertex of cell
+  static long first_vertex(const Level& level, const long cell);
+  /** element matrices from the coefficients, unless they are set already, the inverse diagonal and work vectors.
+   *  Needs coefficients and constrained.
+   */
+  void init_operator(Level& level) const;
+  void add_coarser_level();
+  //! banded Cholesky factorization of the coarsest level's operator
+  void factorize_coarsest();
+  //! level.solution for level.rhs on the coarsest level
+  void solve_coarsest(const Level& level) const;
+
+  std::vector<Level> levels_;
+  //! lexicographic vertex index on the finest level -> DoF index of the local space
+  std::vector<std::size_t> dof_of_vertex_;
+  //! half bandwidth of the coarsest operator in lexicographic vertex order
+  long coarsest_bandwidth_;
+  //! lower band of the Cholesky factor L, L(i, j) at [i * (coarsest_bandwidth_ + 1) + i - j]
+  std::vector<double> coarsest_factor_;
+  const double precision_;
+  const std::size_t max_iterations_;
+  const std::size_t smoothing_steps_;
+  const double damping_;
+  const int verbose_;
+  mutable std::vector<double> cg_solution_;
+  mutable std::vector<double> cg_residual_;
+  mutable std::vector<double> direction_;
+  mutable std::vector<double> product_;
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_LOCALMULTIGRID_HH
@@ -12,10 +12,12 @@
 #include <dune/xt/common/filesystem.hh>
 #include <dune/xt/common/exceptions.hh>
 #include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/timings.hh>
 #include <dune/multiscale/common/heterogenous.hh>
 #include <dune/multiscale/tools/misc.hh>
 #include <dune/multiscale/problems/selector.hh>
 #include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
@@ -23,6 +25,7 @@
 #include <dune/gdt/operators/prolongations.hh>
 #include <dune/gdt/spaces/constraints.hh>
 #include <dune/gdt/functionals/l2.hh>
+#include <dune/stuff/grid/walker/apply-on.hh>
 
 namespace Dune {
 namespace Multiscale {
@@ -42,6 +45,7 @@ class BoundaryValueHelper
 
 public:
   BoundaryValueHelper(const DMP::ProblemContainer& problem,
+                      const DMP::DiffusionBase& diffusion,
                       const MsFEMTraits::LocalSpaceType& localSpace,
                       const Problem::LocalDiffusionType& local_diffusion_operator,
                       MsFEMTraits::LocalSolutionVectorType& allLocalRHS,
@@ -50,28 +54,16 @@ public:
     , dirichletExtensionLocal(localSpace_, "dirichletExtension")
     , local_neumann(problem.getNeumannData().transfer<MsFEMTraits::LocalEntityType>())
     , neumann_functional(local_neumann, allLocalRHS[coarseBaseFunc]->vector(), localSpace_)
-    , dl_corrector_functional(problem.getDiffusion(), dirichletExtensionLocal, local_diffusion_operator)
+    , dl_corrector_functional(diffusion, dirichletExtensionLocal, local_diffusion_operator)
     , dirichlet_corrector(
           local_diffusion_operator, allLocalRHS[++coarseBaseFunc]->vector(), localSpace_, dl_corrector_functional)
-    , problem_(problem)
   {
   }
 
-  void dirichlet_projection(const CommonTraits::SpaceType& coarse_space)
+  void dirichlet_projection(const CommonTraits::ConstDiscreteFunctionType& coarseDirichletExtension)
   {
-    GDT::SystemAssembler<CommonTraits::SpaceType> coarse_system_assembler(coarse_space);
-    const auto& dirichlet_data = problem_.getDirichletData();
-    CommonTraits::DiscreteFunctionType dirichletExtensionCoarse(coarse_space, "Dirichlet Extension Coarse");
-    GDT::Operators::DirichletProjectionLocalizable<CommonTraits::GridViewType,
-                                                   Problem::DirichletDataBase,
-                                                   CommonTraits::DiscreteFunctionType>
-        coarse_dirichlet_projection_operator(
-            coarse_space.grid_view(), problem_.getModelData().boundaryInfo(), dirichlet_data, dirichletExtensionCoarse);
-    coarse_system_assembler.add(coarse_dirichlet_projection_operator,
-                                new DSG::ApplyOn::BoundaryEntities<CommonTraits::GridViewType>());
-    coarse_system_assembler.assemble();
     GDT::Operators::LagrangeProlongation<MsFEMTraits::LocalGridViewType> projection(localSpace_.grid_view());
-    projection.apply(dirichletExtensionCoarse, dirichletExtensionLocal);
+    projection.apply(coarseDirichletExtension, dirichletExtensionLocal);
   }
 
   void add_to(GDT::SystemAssembler<MsFEMTraits::LocalSpaceType>& system_assembler)
@@ -87,31 +79,104 @@ private:
   NeumannFunctional neumann_functional;
   GDT::LocalFunctional::Codim0Integral<DirichletProduct> dl_corrector_functional;
   DirichletCorrectorFunctionalType dirichlet_corrector;
-  const DMP::ProblemContainer& problem_;
 };
 
 LocalProblemOperator::LocalProblemOperator(const DMP::ProblemContainer& problem,
+                                           const DMP::DiffusionBase& diffusion,
                                            const CommonTraits::SpaceType& coarse_space,
-                                           const MsFEMTraits::LocalSpaceType& space)
+                                           const MsFEMTraits::LocalSpaceType& space,
+                                           LocalStructure& structure)
   : localSpace_(space)
-  , local_diffusion_operator_(problem.getDiffusion())
+  , solver_(local_solver(problem, localSpace_))
+  , diffusion_(diffusion)
+  , local_diffusion_operator_(diffusion_)
   , coarse_space_(coarse_space)
-  , system_matrix_(localSpace_.mapper().size(), localSpace_.mapper().size(), EllipticOperatorType::pattern(localSpace_))
+  , structure_(structure)
+  , system_matrix_(localSpace_.mapper().size(), localSpace_.mapper().size(), structure_.pattern())
   , system_assembler_(localSpace_)
   , elliptic_operator_(local_diffusion_operator_, system_matrix_, localSpace_)
   , dirichletConstraints_(problem.getModelData().subBoundaryInfo(), localSpace_.mapper().size(), true)
+  , use_dense_(dense_local_solver(problem, solver_, localSpace_.mapper().size()))
 #if HAVE_UMFPACK
-  , use_umfpack_(problem.config().get("msfem.local_solver", std::string("umfpack")) == std::string("umfpack"))
+  , use_umfpack_(!use_dense_ && solver_ == "umfpack")
 #else
   , use_umfpack_(false)
 #endif
+  , use_cholmod_(!use_dense_ && solver_ == "cholmod")
+  , use_multigrid_(solver_ == "multigrid")
   , problem_(problem)
 {
-  system_assembler_.add(elliptic_operator_);
+  // the multigrid solver applies its own element matrices, the system matrix is left unassembled
+  if (!use_multigrid_)
+    system_assembler_.add(elliptic_operator_);
 }
 
-void LocalProblemOperator::assemble_all_local_rhs(const MsFEMTraits::CoarseEntityType& coarseEntity,
-                                                  MsFEMTraits::LocalSolutionVectorType& allLocalRHS)
+bool LocalProblemOperator::algebraic_coarse_assembly(const DMP::ProblemContainer& problem)
+{
+  const auto assembly = problem.config().get("msfem.coarse_assembly", std::string("quadrature"));
+  if (assembly != "quadrature" && assembly != "algebraic")
+    DUNE_THROW(InvalidStateException, "msfem.coarse_assembly has to be quadrature or algebraic, not " << assembly);
+  return assembly == "algebraic";
+}
+
+std::string LocalProblemOperator::local_solver(const DMP::ProblemContainer& problem)
+{
+  const bool symmetric = problem.getModelData().symmetricDiffusion();
+  const std::string fallback = (HAVE_CHOLMOD && symmetric) ? "cholmod" : "umfpack";
+  auto solver = problem.config().get("msfem.local_solver", std::string("auto"));
+  if (solver == "auto")
+    solver = fallback;
+  if (solver == "cholmod" && !HAVE_CHOLMOD)
+    DUNE_THROW(NotImplemented, "msfem.local_solver = cholmod, but dune-multiscale was built without CHOLMOD");
+  if ((solver == "cholmod" || solver == "multigrid") && !symmetric)
+    DUNE_THROW(InvalidStateException, "msfem.local_solver = " << solver << " needs a problem with symmetric diffusion");
+  return solver;
+}
+
+std::string LocalProblemOperator::local_solver(const DMP::ProblemContainer& problem,
+                                               const MsFEMTraits::LocalSpaceType& space)
+{
+  const auto solver = local_solver(problem);
+  if (solver != "multigrid" || LocalMultigridInverse::coarsenable(space))
+    return solver;
+  return HAVE_CHOLMOD ? "cholmod" : "umfpack";
+}
+
+bool LocalProblemOperator::dense_local_solver(const DMP::ProblemContainer& problem,
+                                              const std::string& solver,
+                                              const std::size_t numDofs)
+{
+#if HAVE_LAPACK
+  return (solver == "umfpack" || solver == "cholmod")
+         && numDofs <= problem.config().get("msfem.dense_local_solver_cutoff", std::size_t(256));
+#else
+  return false;
+#endif
+}
+
+void LocalProblemOperator::coarse_dirichlet_extension(const DMP::ProblemContainer& problem,
+                                                      CommonTraits::DiscreteFunctionType& coarseDirichletExtension)
+{
+  Dune::XT::Common::ScopedTiming st("msfem.local.dirichlet_extension");
+  const auto& coarse_space = coarseDirichletExtension.space();
+  coarseDirichletExtension.vector() *= 0;
+  GDT::SystemAssembler<CommonTraits::SpaceType> coarse_system_assembler(coarse_space);
+  GDT::Operators::DirichletProjectionLocalizable<CommonTraits::GridViewType,
+                                                 Problem::DirichletDataBase,
+                                                 CommonTraits::DiscreteFunctionType>
+      coarse_dirichlet_projection_operator(coarse_space.grid_view(),
+                                           problem.getModelData().boundaryInfo(),
+                                           problem.getDirichletData(),
+                                           coarseDirichletExtension);
+  coarse_system_assembler.add(coarse_dirichlet_projection_operator,
+                              new DSG::ApplyOn::BoundaryEntities<CommonTraits::GridViewType>());
+  coarse_system_assembler.assemble();
+}
+
+void LocalProblemOperator::assemble_all_local_rhs(
+    const MsFEMTraits::CoarseEntityType& coarseEntity,
+    const CommonTraits::ConstDiscreteFunctionType& coarseDirichletExtension,
+    MsFEMTraits::LocalSolutionVectorType& allLocalRHS)
 {
   BOOST_ASSERT_MSG(allLocalRHS.size() > 0, "You need to preallocate the necessary space outside this function!");
 
@@ -126,8 +191,8 @@ void LocalProblemOperator::assemble_all_local_rhs(const MsFEMTraits::CoarseEntit
   std::unique_ptr<BVHelper> bv_helper(nullptr);
   if (coarseEntity.hasBoundaryIntersections()) {
     bv_helper = Dune::XT::Common::make_unique<BVHelper>(
-        problem_, localSpace_, local_diffusion_operator_, allLocalRHS, numInnerCorrectors);
-    bv_helper->dirichlet_projection(coarse_space_);
+        problem_, diffusion_, localSpace_, local_diffusion_operator_, allLocalRHS, numInnerCorrectors);
+    bv_helper->dirichlet_projection(coarseDirichletExtension);
   }
 
   typedef GDT::Functionals::L2Volume<Problem::LocalDiffusionType,
@@ -142,7 +207,7 @@ void LocalProblemOperator::assemble_all_local_rhs(const MsFEMTraits::CoarseEntit
   for (; coarseBaseFunc < numInnerCorrectors; ++coarseBaseFunc) {
     assert(allLocalRHS[coarseBaseFunc]);
     GDT::LocalFunctional::Codim0Integral<CoarseBasisProduct> local_rhs_functional(
-        problem_.getDiffusion(), coarseBaseFunctionSet, local_diffusion_operator_, coarseBaseFunc);
+        diffusion_, coarseBaseFunctionSet, local_diffusion_operator_, coarseBaseFunc);
     auto& rhs_vector = allLocalRHS[coarseBaseFunc]->vector();
     rhs_functionals[coarseBaseFunc] = Dune::XT::Common::make_unique<RhsFunctionalType>(
         local_diffusion_operator_, rhs_vector, localSpace_, local_rhs_functional);
@@ -151,47 +216,150 @@ void LocalProblemOperator::assemble_all_local_rhs(const MsFEMTraits::CoarseEntit
 
   if (coarseEntity.hasBoundaryIntersections())
     bv_helper->add_to(system_assembler_);
+
+  // without oversampling all micro cells are covered and the system matrix is copied before the constraints are
+  // applied, otherwise, or if the system matrix is not assembled, the stiffness on the covered cells is assembled in
+  // the same grid walk
+  const bool algebraic_coarse_matrix = algebraic_coarse_assembly(problem_);
+  const bool copy_system_matrix = !use_multigrid_ && problem_.config().get("msfem.oversampling_layers", 0) == 0;
+  if (algebraic_coarse_matrix && !copy_system_matrix) {
+    covered_matrix_ = Dune::XT::Common::make_unique<LocalLinearOperatorType>(
+        localSpace_.mapper().size(), localSpace_.mapper().size(), structure_.pattern());
+    covered_operator_ =
+        Dune::XT::Common::make_unique<EllipticOperatorType>(local_diffusion_operator_, *covered_matrix_, localSpace_);
+    typedef DSG::ApplyOn::FilteredEntities<MsFEMTraits::LocalGridViewType> OnCoveredEntities;
+    system_assembler_.add(
+        *covered_operator_,
+        new OnCoveredEntities([&coarseEntity](const MsFEMTraits::LocalGridViewType& /*view*/,
+                                              const MsFEMTraits::LocalEntityType& entity) {
+          return LocalGridList::covers(coarseEntity, entity);
+        }));
+  }
   system_assembler_.assemble();
+  if (algebraic_coarse_matrix && copy_system_matrix)
+    covered_matrix_ = Dune::XT::Common::make_unique<LocalLinearOperatorType>(system_matrix_);
 
   // dirichlet-0 for all rhs
   typedef DSG::ApplyOn::BoundaryEntities<MsFEMTraits::LocalGridViewType> OnLocalBoundaryEntities;
   system_assembler_.add(dirichletConstraints_, new OnLocalBoundaryEntities());
 
   system_assembler_.assemble();
-  dirichletConstraints_.apply(system_matrix_);
+  if (!use_multigrid_)
+    dirichletConstraints_.apply(system_matrix_);
   for (auto& rhs : allLocalRHS)
     dirichletConstraints_.apply(rhs->vector());
+  if (use_multigrid_)
+    local_multigrid_inverse_ = Dune::XT::Common::make_unique<LocalMultigridInverse>(
+        localSpace_, diffusion_, dirichletConstraints_.dirichlet_DoFs(), problem_);
+#if HAVE_LAPACK
+  if (use_dense_)
+    local_dense_inverse_ = Dune::XT::Common::make_unique<LocalDenseInverse>(
+        system_matrix_, dirichletConstraints_.dirichlet_DoFs(), problem_.getModelData().symmetricDiffusion());
+#endif
 #if HAVE_UMFPACK
   if (use_umfpack_)
-    local_direct_inverse_ = Dune::XT::Common::make_unique<LocalDirectInverseType>(
-        system_matrix_.backend(), problem_.config().get("msfem.local_solver_verbose", 0));
+    local_direct_inverse_ = Dune::XT::Common::make_unique<LocalDirectInverse>(
+        structure_, system_matrix_, problem_.config().get("msfem.local_solver_verbose", 0));
+#endif
+#if HAVE_CHOLMOD
+  if (use_cholmod_) {
+    const auto verbose = problem_.config().get("msfem.local_solver_verbose", 0);
+    local_cholesky_inverse_ = Dune::XT::Common::make_unique<LocalCholeskyInverse>(
+        structure_, system_matrix_, dirichletConstraints_.dirichlet_DoFs(), verbose);
+  }
 #endif
 }
 
-void LocalProblemOperator::apply_inverse(const MsFEMTraits::LocalGridDiscreteFunctionType& current_rhs,
-                                         MsFEMTraits::LocalGridDiscreteFunctionType& current_solution)
+void LocalProblemOperator::apply_inverse(MsFEMTraits::LocalSolutionVectorType& allLocalRHS,
+                                         MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+                                         const std::size_t numSolves,
+                                         const std::size_t firstSolve)
 {
-  if (!current_rhs.dofs_valid())
-    DUNE_THROW(Dune::InvalidStateException, "Local MsFEM Problem RHS invalid.");
+  BOOST_ASSERT_MSG(allLocalRHS.size() == allLocalSolutions.size(), "Need exactly one solution per right hand side!");
+  assert(firstSolve <= numSolves && numSolves <= allLocalRHS.size());
+  for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+    if (!allLocalRHS[i]->dofs_valid())
+      DUNE_THROW(Dune::InvalidStateException, "Local MsFEM Problem RHS " << i << " invalid.");
 
-  typedef BackendChooser<MsFEMTraits::LocalSpaceType>::InverseOperatorType LocalInverseOperatorType;
-  const LocalInverseOperatorType local_inverse(system_matrix_, current_rhs.space().communicator());
-
-  auto options = local_inverse.options(problem_.config().get("msfem.local_solver", "umfpack"));
-  options["precision"] = problem_.config().get("msfem.localproblemsolver_precision", 1e-5);
-  options["verbose"] = problem_.config().get("msfem.local_solver_verbose", "0");
-  {
-    InverseOperatorResult stat;
-    auto writable_rhs = current_rhs.vector().copy();
+  if (use_multigrid_) {
+    for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+      local_multigrid_inverse_->apply(allLocalRHS[i]->vector(), allLocalSolutions[i]->vector());
+  } else
+#if HAVE_LAPACK
+  if (use_dense_) {
+    local_dense_inverse_->apply(allLocalRHS, allLocalSolutions, numSolves, firstSolve);
+  } else
+#endif
 #if HAVE_UMFPACK
-    if (use_umfpack_)
-      local_direct_inverse_->apply(current_solution.vector().backend(), writable_rhs.backend(), stat);
-    else
+  if (use_umfpack_) {
+    // the factorization computed in assemble_all_local_rhs is shared by all right hand sides
+    for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+      local_direct_inverse_->apply(allLocalRHS[i]->vector(), allLocalSolutions[i]->vector());
+  } else
+#endif
+#if HAVE_CHOLMOD
+  if (use_cholmod_) {
+    for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+      local_cholesky_inverse_->apply(allLocalRHS[i]->vector(), allLocalSolutions[i]->vector());
+  } else
 #endif
-      local_inverse.apply(current_solution.vector(), writable_rhs, options);
+  {
+    typedef BackendChooser<MsFEMTraits::LocalSpaceType>::InverseOperatorType LocalInverseOperatorType;
+    const LocalInverseOperatorType local_inverse(system_matrix_, localSpace_.communicator());
+
+    auto options = local_inverse.options(solver_);
+    options["precision"] = problem_.config().get("msfem.localproblemsolver_precision", 1e-5);
+    options["verbose"] = problem_.config().get("msfem.local_solver_verbose", "0");
+    for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+      local_inverse.apply(allLocalRHS[i]->vector(), allLocalSolutions[i]->vector(), options);
+  }
+
+  for (const auto i : Dune::XT::Common::value_range(numSolves, allLocalSolutions.size()))
+    allLocalSolutions[i]->vector() *= 0;
+  for (const auto i : Dune::XT::Common::value_range(firstSolve, numSolves))
+    if (!allLocalSolutions[i]->dofs_valid())
+      DUNE_THROW(Dune::InvalidStateException, "Solution " << i << " of the local msfem problem invalid!");
+}
+
+void LocalProblemOperator::coarse_element_matrix(const MsFEMTraits::CoarseEntityType& coarseEntity,
+                                                 const MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+                                                 const std::size_t numInnerCorrectors,
+                                                 CoarseElementMatrixType& matrix) const
+{
+  if (!covered_matrix_)
+    DUNE_THROW(InvalidStateException, "the coarse element matrix needs msfem.coarse_assembly = algebraic");
+  assert(allLocalSolutions.size() >= numInnerCorrectors);
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType LocalVectorType;
+  const auto size = localSpace_.mapper().size();
+  const auto coarseBaseFunctionSet = coarse_space_.base_function_set(coarseEntity);
+  assert(coarseBaseFunctionSet.size() == numInnerCorrectors);
+  const auto& coarse_geometry = coarseEntity.geometry();
+
+  // the columns of Q. Local grids are nested in the coarse grid, so the interpolation of the coarse base functions is
+  // exact on all covered micro cells, the (extrapolated) values on the others do not contribute
+  std::vector<LocalVectorType> columns(numInnerCorrectors, LocalVectorType(size, 0.));
+  for (const auto& local_entity : Dune::elements(localSpace_.grid_view())) {
+    const auto& geometry = local_entity.geometry();
+    const auto& lg_points = localSpace_.lagrange_points(local_entity);
+    const auto local_dofs = localSpace_.mapper().globalIndices(local_entity);
+    for (const auto lg_i : Dune::XT::Common::value_range(lg_points.size())) {
+      const auto coarse_point = coarse_geometry.local(geometry.global(lg_points[lg_i]));
+      const auto coarse_values = coarseBaseFunctionSet.evaluate(coarse_point);
+      for (const auto i : Dune::XT::Common::value_range(numInnerCorrectors))
+        columns[i].set_entry(local_dofs[lg_i], coarse_values[i][0]);
+    }
+  }
+  for (const auto i : Dune::XT::Common::value_range(numInnerCorrectors))
+    columns[i] += allLocalSolutions[i]->vector();
+
+  // Q^T (A Q), one sparse matrix vector product per column
+  matrix.resize(numInnerCorrectors, numInnerCorrectors);
+  LocalVectorType product(size, 0.);
+  for (const auto j : Dune::XT::Common::value_range(numInnerCorrectors)) {
+    covered_matrix_->mv(columns[j], product);
+    for (const auto i : Dune::XT::Common::value_range(numInnerCorrectors))
+      matrix[i][j] = columns[i].dot(product);
   }
-  if (!current_solution.dofs_valid())
-    DUNE_THROW(Dune::InvalidStateException, "Current solution of the local msfem problem invalid!");
 }
 
 } // namespace Multiscale {
@@ -6,12 +6,15 @@
 #define LOCALOPERATOR_HH
 
 #include <memory>
+#include <string>
 
+#include <dune/common/dynmatrix.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 #include <dune/gdt/assembler/system.hh>
 #include <dune/multiscale/problems/base.hh>
 #include <dune/multiscale/msfem/diffusion_evaluation.hh>
-#include <dune/istl/umfpack.hh>
+#include <dune/multiscale/msfem/localproblems/localstructurecache.hh>
+#include <dune/multiscale/msfem/localproblems/localmultigrid.hh>
 
 namespace Dune {
 namespace Multiscale {
@@ -23,45 +26,126 @@ class LocalProblemOperator
   typedef GDT::Spaces::DirichletConstraints<typename MsFEMTraits::LocalGridViewType::Intersection>
       DirichletConstraintsType;
   typedef DSG::BoundaryInfos::AllDirichlet<MsFEMTraits::LocalGridType::LeafGridView::Intersection> BoundaryInfoType;
-#if HAVE_UMFPACK
-  typedef UMFPack<typename LocalLinearOperatorType::BackendType> LocalDirectInverseType;
-#else
-  typedef void LocalDirectInverseType;
-#endif
 
 public:
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> CoarseElementMatrixType;
+
+  //! true if msfem.coarse_assembly is "algebraic", ie. coarse element matrices are computed by coarse_element_matrix
+  static bool algebraic_coarse_assembly(const DMP::ProblemContainer& problem);
+
+  /** msfem.local_solver: umfpack, cholmod, multigrid (see LocalMultigridInverse) or one of the ISTL solver types.
+   * The default, auto, is cholmod (sparse Cholesky) if it is available and the problem has symmetric diffusion,
+   * umfpack otherwise.
+   */
+  static std::string local_solver(const DMP::ProblemContainer& problem);
+
+  //! local_solver(problem), but the sparse direct one instead of multigrid if space's grid can not be coarsened
+  static std::string local_solver(const DMP::ProblemContainer& problem, const MsFEMTraits::LocalSpaceType& space);
+
+  /** true if solver is direct, LAPACK is available and numDofs does not exceed msfem.dense_local_solver_cutoff.
+   * The local problems are then factorized as dense matrices.
+   */
+  static bool
+  dense_local_solver(const DMP::ProblemContainer& problem, const std::string& solver, const std::size_t numDofs);
+
+  /**
+   * @param diffusion The problem's diffusion, or a LocalDiffusionCache of it on this local grid
+   * @param structure Sparsity pattern and symbolic factorization shared with all local problems on congruent grids
+   */
   LocalProblemOperator(const DMP::ProblemContainer& problem,
+                       const DMP::DiffusionBase& diffusion,
                        const CommonTraits::SpaceType& coarse_space,
-                       const MsFEMTraits::LocalSpaceType& subDiscreteFunctionSpace);
+                       const MsFEMTraits::LocalSpaceType& subDiscreteFunctionSpace,
+                       LocalStructure& structure);
+
+  /** Project the Dirichlet data onto the coarse space.
+  *
+  * This only depends on the problem, not on the coarse cell, so it is computed once and then shared
+  * by all local problems with boundary intersections.
+  * @param[out] coarseDirichletExtension Coarse function with the projected Dirichlet values on boundary DoFs.
+  */
+  static void coarse_dirichlet_extension(const DMP::ProblemContainer& problem,
+                                         CommonTraits::DiscreteFunctionType& coarseDirichletExtension);
 
   /** Assemble right hand side vectors for all local problems on one coarse cell.
   *
   * @param[in] coarseEntity The coarse cell.
+  * @param[in] coarseDirichletExtension The result of coarse_dirichlet_extension.
   * @param[out] allLocalRHS A vector with pointers to the discrete functions for the right hand sides.
   *
   * @note The vector allLocalRHS is assumed to have the correct size and contain pointers to all local rhs
   * functions. The discrete functions in allLocalRHS will be cleared in this function.
   */
   void assemble_all_local_rhs(const MsFEMTraits::CoarseEntityType& coarseEntity,
+                              const CommonTraits::ConstDiscreteFunctionType& coarseDirichletExtension,
                               MsFEMTraits::LocalSolutionVectorType& allLocalRHS);
 
-  void apply_inverse(const MsFEMTraits::LocalGridDiscreteFunctionType& current_rhs,
-                     MsFEMTraits::LocalGridDiscreteFunctionType& current_solution);
+  /** Solve the local problems for all right hand sides of one coarse cell at once.
+  *
+  * The system matrix is factorized (or the iterative solver is set up) only once, each right hand side then only costs
+  * a back-substitution (or one Krylov solve).
+  *
+  * @param[in] allLocalRHS The right hand sides as produced by assemble_all_local_rhs. Used as scratch space.
+  * @param[out] allLocalSolutions The local solutions, same size and ordering as allLocalRHS.
+  * @param[in] numSolves Only the first numSolves systems are solved, the remaining solutions are set to zero.
+  * @param[in] firstSolve The systems before firstSolve are not solved either, their solutions are left untouched.
+  */
+  void apply_inverse(MsFEMTraits::LocalSolutionVectorType& allLocalRHS,
+                     MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+                     const std::size_t numSolves,
+                     const std::size_t firstSolve = 0);
+
+  /** The MsFEM coarse element matrix as Galerkin product Q^T A Q.
+  *
+  * A is the local stiffness matrix restricted to the micro cells covered by the coarse cell, the columns of Q are
+  * the Lagrange interpolants of the coarse base functions plus their correctors. Entry (i, j) hence equals
+  * \int_T A \nabla(\phi_j + Q_j) \cdot \nabla(\phi_i + Q_i), without quadrature on the coarse level.
+  * This is not the discretization of the quadrature kernel MsFEMCodim0Integral: that one evaluates the coarse base
+  * function gradients at the micro elements' local coordinates instead of at the quadrature points' coarse
+  * coordinates, so msfem.coarse_assembly = algebraic changes the coarse matrix unless a coarse cell has one micro
+  * cell. The coarse_element_matrix test compares the result to quadrature at the right points.
+  * Requires algebraic_coarse_assembly and a preceding assemble_all_local_rhs for the same coarse cell.
+  *
+  * @param[in] allLocalSolutions The local solutions, the first numInnerCorrectors ones are the correctors.
+  * @param[out] matrix Resized to numInnerCorrectors x numInnerCorrectors.
+  */
+  void coarse_element_matrix(const MsFEMTraits::CoarseEntityType& coarseEntity,
+                             const MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+                             const std::size_t numInnerCorrectors,
+                             CoarseElementMatrixType& matrix) const;
 
 private:
   const MsFEMTraits::LocalSpaceType localSpace_;
+  //! local_solver(problem, localSpace_)
+  const std::string solver_;
+  const DMP::DiffusionBase& diffusion_;
   const Problem::LocalDiffusionType local_diffusion_operator_;
   const CommonTraits::SpaceType& coarse_space_;
+  LocalStructure& structure_;
+  //! allocated with the shared pattern, but neither assembled nor constrained for the multigrid solver
   LocalLinearOperatorType system_matrix_;
   GDT::SystemAssembler<MsFEMTraits::LocalSpaceType> system_assembler_;
   EllipticOperatorType elliptic_operator_;
+  //! unconstrained stiffness matrix on the covered micro cells, only with algebraic_coarse_assembly
+  std::unique_ptr<LocalLinearOperatorType> covered_matrix_;
+  std::unique_ptr<EllipticOperatorType> covered_operator_;
   BoundaryInfoType boundaryInfo_;
   DirichletConstraintsType dirichletConstraints_;
   DSG::BoundaryInfos::AllDirichlet<MsFEMTraits::LocalGridType::LeafGridView::Intersection> allLocalDirichletInfo_;
+  const bool use_dense_;
   const bool use_umfpack_;
+  const bool use_cholmod_;
+  const bool use_multigrid_;
 #if HAVE_UMFPACK
-  std::unique_ptr<LocalDirectInverseType> local_direct_inverse_;
+  std::unique_ptr<LocalDirectInverse> local_direct_inverse_;
+#endif
+#if HAVE_CHOLMOD
+  std::unique_ptr<LocalCholeskyInverse> local_cholesky_inverse_;
+#endif
+#if HAVE_LAPACK
+  std::unique_ptr<LocalDenseInverse> local_dense_inverse_;
 #endif
+  std::unique_ptr<LocalMultigridInverse> local_multigrid_inverse_;
   const DMP::ProblemContainer& problem_;
 };
 
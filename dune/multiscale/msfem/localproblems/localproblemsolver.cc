@@ -9,6 +9,8 @@
 #include <dune/multiscale/problems/selector.hh>
 #include <dune/multiscale/common/df_io.hh>
 #include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/msfem/localproblems/localdiffusioncache.hh>
+#include <dune/multiscale/msfem/offline_archive.hh>
 #include <dune/multiscale/tools/misc.hh>
 #include <dune/xt/common/logging.hh>
 #include <dune/xt/common/math.hh>
@@ -16,18 +18,24 @@
 #include <dune/xt/common/configuration.hh>
 #include <dune/xt/common/timings.hh>
 #include <dune/xt/common/ranges.hh>
-#include <dune/xt/common/parallel/partitioner.hh>
-#include <dune/grid/utility/partitioning/seedlist.hh>
+#include <dune/xt/common/parallel/threadmanager.hh>
+#include <dune/common/timer.hh>
 #include <dune/gdt/products/l2.hh>
 #include <dune/stuff/grid/walker.hh>
 #include <dune/stuff/grid/walker/functors.hh>
+#include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <limits>
 #include <memory>
 #include <sstream>
 #include <string>
 #include <tuple>
 #include <vector>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 #include <dune/multiscale/msfem/localproblems/localgridlist.hh>
 #include <dune/multiscale/tools/misc/outputparameter.hh>
 #include "localproblemsolver.hh"
@@ -54,29 +62,65 @@ LocalProblemSolver::LocalProblemSolver(const Problem::ProblemContainer& problem,
                                        LocalGridList& localgrid_list)
   : localgrid_list_(localgrid_list)
   , coarse_space_(coarse_space)
+  , coefficient_cache_mode_(LocalDiffusionCache::mode(problem))
+  , algebraic_coarse_assembly_(LocalProblemOperator::algebraic_coarse_assembly(problem))
+  , deduplication_(CorrectorDeduplication::enabled(problem)
+                       ? Dune::XT::Common::make_unique<CorrectorDeduplication>(problem, *coarse_space_, localgrid_list)
+                       : nullptr)
   , problem_(problem)
 {
+  // the coarse Dirichlet extension does not depend on the coarse cell, only its prolongation onto
+  // each local grid does
+  CommonTraits::DiscreteFunctionType coarse_dirichlet_extension(*coarse_space_, "Dirichlet Extension Coarse");
+  LocalProblemOperator::coarse_dirichlet_extension(problem_, coarse_dirichlet_extension);
+  coarse_dirichlet_vector_ = coarse_dirichlet_extension.vector();
+}
+
+void LocalProblemSolver::solve_for_cell(const MsFEMTraits::CoarseEntityType& coarseCell,
+                                        LocalproblemSolutionManager& localSolutionManager) const
+{
+  // the dof vector is shared, every thread wraps it with its own space copy
+  const CommonTraits::ConstDiscreteFunctionType coarse_dirichlet_extension(*coarse_space_, coarse_dirichlet_vector_);
+  if (!coefficient_cache_mode_.empty())
+    localSolutionManager.cache_diffusion(problem_.getDiffusion(), coefficient_cache_mode_);
+  const auto& diffusion = localSolutionManager.diffusion(problem_.getDiffusion());
+  const auto fingerprint = deduplication_
+                               ? deduplication_->fingerprint(coarseCell, localSolutionManager.grid_view(), diffusion)
+                               : CorrectorDeduplication::Fingerprint();
+  if (fingerprint && deduplication_->reuse(fingerprint, localSolutionManager))
+    return;
+  solve_all_on_single_cell(coarseCell, coarse_dirichlet_extension, diffusion, localSolutionManager);
+  if (fingerprint)
+    deduplication_->store(fingerprint, localSolutionManager);
 }
 
 void LocalProblemSolver::solve_all_on_single_cell(
     const MsFEMTraits::CoarseEntityType& coarseCell,
-    MsFEMTraits::LocalSolutionVectorType& all_localproblem_solutions) const
+    const CommonTraits::ConstDiscreteFunctionType& coarseDirichletExtension,
+    const DMP::DiffusionBase& diffusion,
+    LocalproblemSolutionManager& localSolutionManager,
+    const bool boundary_only) const
 {
+  auto& all_localproblem_solutions = localSolutionManager.getLocalSolutions();
   assert(all_localproblem_solutions.size() > 0);
 
   const bool hasBoundary = coarseCell.hasBoundaryIntersections();
   const auto numBoundaryCorrectors = DSG::is_simplex_grid(*coarse_space_) ? 1u : 2u;
   const auto numInnerCorrectors = all_localproblem_solutions.size() - numBoundaryCorrectors;
+  const auto firstSolve = boundary_only ? numInnerCorrectors : 0;
 
   // clear return argument
-  for (auto& localSol : all_localproblem_solutions)
-    localSol->vector() *= 0;
+  for (const auto i : Dune::XT::Common::value_range(firstSolve, all_localproblem_solutions.size()))
+    all_localproblem_solutions[i]->vector() *= 0;
+  if (boundary_only && !hasBoundary)
+    return;
 
   const auto& local_space = all_localproblem_solutions[0]->space();
 
   //! define the discrete (elliptic) local MsFEM problem operator
   // ( effect of the discretized differential operator on a certain discrete function )
-  LocalProblemOperator localProblemOperator(problem_, *coarse_space_, local_space);
+  auto& structure = structure_cache_.get(localgrid_list_.shape(coarseCell), local_space);
+  LocalProblemOperator localProblemOperator(problem_, diffusion, *coarse_space_, local_space, structure);
 
   // right hand side vector of the algebraic local MsFEM problem
   MsFEMTraits::LocalSolutionVectorType allLocalRHS(all_localproblem_solutions.size());
@@ -84,32 +128,19 @@ void LocalProblemSolver::solve_all_on_single_cell(
     it = Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(local_space,
                                                                                    "rhs of local MsFEM problem");
 
-  localProblemOperator.assemble_all_local_rhs(coarseCell, allLocalRHS);
-
-  for (auto i : Dune::XT::Common::value_range(all_localproblem_solutions.size())) {
-    auto& current_rhs = *allLocalRHS[i];
-    auto& current_solution = *all_localproblem_solutions[i];
-
-    // is the right hand side of the local MsFEM problem equal to zero or almost identical to zero?
-    // if yes, the solution of the local MsFEM problem is also identical to zero. The solver is getting a problem with
-    // this situation, which is why we do not solve local msfem problems for zero-right-hand-side, since we already know
-    // the result.
-    //! TODO calculating the norm has really bad performance impact, is the instability actually still there?
-    //    const auto norm = GDT::Products::L2<typename MsFEMTraits::LocalGridViewType>(current_rhs.space().grid_view())
-    //                          .induced_norm(current_rhs);
-    //    if (norm < 1e-12) {
-    //      current_solution.vector() *= 0;
-    //      MS_LOG_DEBUG << boost::format("Local MsFEM problem with solution zero. (corrector %d)") % i << std::endl;
-    //      continue;
-    //    }
-
-    // don't solve local problems for boundary correctors if coarse cell has no boundary intersections
-    if (i >= numInnerCorrectors && !hasBoundary) {
-      current_solution.vector() *= 0;
-      MS_LOG_DEBUG << "Zero-Boundary corrector." << std::endl;
-      continue;
-    }
-    localProblemOperator.apply_inverse(current_rhs, current_solution);
+  localProblemOperator.assemble_all_local_rhs(coarseCell, coarseDirichletExtension, allLocalRHS);
+
+  // don't solve local problems for boundary correctors if coarse cell has no boundary intersections
+  const auto numSolves = hasBoundary ? all_localproblem_solutions.size() : numInnerCorrectors;
+  if (!hasBoundary)
+    MS_LOG_DEBUG << "Zero-Boundary correctors." << std::endl;
+  localProblemOperator.apply_inverse(allLocalRHS, all_localproblem_solutions, numSolves, firstSolve);
+
+  if (algebraic_coarse_assembly_ && !boundary_only) {
+    LocalproblemSolutionManager::CoarseElementMatrixType coarse_matrix;
+    localProblemOperator.coarse_element_matrix(
+        coarseCell, all_localproblem_solutions, numInnerCorrectors, coarse_matrix);
+    localSolutionManager.set_coarse_matrix(std::move(coarse_matrix));
   }
 }
 
@@ -121,45 +152,149 @@ void LocalProblemSolver::solve_for_all_cells()
   MS_LOG_INFO << boost::format("Rank %d will solve local problems for %d coarse entities\n") % grid.comm().rank()
                      % coarseGridSize;
   DXTC_TIMINGS.start("msfem.local.solve_for_all_cells");
+  // correctors of an earlier solve are not kept around for the whole lifetime of the solver
+  if (deduplication_)
+    deduplication_->clear();
 
   // we want to determine minimum, average and maxiumum time for solving a local msfem problem in the current method
   Dune::XT::Common::MinMaxAvg<double> solveTime;
 
-  const auto interior = coarse_space_->grid_view().grid().template leafGridView<InteriorBorder_Partition>();
-  typedef std::remove_const<decltype(interior)>::type InteriorType;
-  GDT::SystemAssembler<CommonTraits::SpaceType, InteriorType> walker(*coarse_space_, interior);
-  Dune::XT::Common::IndexSetPartitioner<InteriorType> ip(interior.indexSet());
-  SeedListPartitioning<typename InteriorType::Grid, 0> partitioning(interior, ip);
-
-  const std::function<void(const CommonTraits::EntityType&)> func = [&](const CommonTraits::EntityType& coarseEntity) {
-    const int coarse_index = walker.ansatz_space().grid_view().indexSet().index(coarseEntity);
-    MS_LOG_DEBUG << "-------------------------" << std::endl << "Coarse index " << coarse_index << std::endl;
+  // Coarse cells are handed out dynamically, most expensive first. Oversampled cells at the domain
+  // boundary have larger local grids and also solve the boundary correctors, with a static partitioning
+  // the other threads idle while a few finish those.
+  const auto interior = grid.template leafGridView<InteriorBorder_Partition>();
+  typedef std::pair<std::size_t, CommonTraits::EntityType::EntitySeed> CostAndSeedType;
+  std::vector<CostAndSeedType> cells;
+  cells.reserve(coarseGridSize);
+  const auto numInnerCorrectors = coarse_space_->mapper().maxNumDofs();
+  const auto numBoundaryCorrectors = DSG::is_simplex_grid(*coarse_space_) ? 1u : 2u;
+  for (const auto& coarse_entity : Dune::elements(interior)) {
+    const auto local_dofs = localgrid_list_.getSubGrid(coarse_entity).size(CommonTraits::world_dim);
+    const auto correctors = numInnerCorrectors + (coarse_entity.hasBoundaryIntersections() ? numBoundaryCorrectors : 0);
+    cells.emplace_back(local_dofs * correctors, coarse_entity.seed());
+  }
+  std::stable_sort(cells.begin(), cells.end(), [](const CostAndSeedType& a, const CostAndSeedType& b) {
+    return a.first > b.first;
+  });
 
-    // take time
-    //    DXTC_TIMINGS.start("msfem.local.solve_all_on_single_cell");
-    LocalproblemSolutionManager localSolutionManager(*coarse_space_, coarseEntity, localgrid_list_);
-    // solve the problems
-    solve_all_on_single_cell(coarseEntity, localSolutionManager.getLocalSolutions());
-    //    solveTime(DXTC_TIMINGS.stop("msfem.local.solve_all_on_single_cell") / 1000.f);
+  struct ThreadLoad
+  {
+    std::size_t cost = 0;
+    double busy = 0;
+    std::vector<double> cell_times;
+  };
+  const std::size_t num_workers =
+      std::max(std::size_t(1), std::size_t(Dune::XT::Common::threadManager().max_threads()));
+  // TBB may run several worker tasks on one thread, the statistics are therefore kept per thread
+  Dune::XT::Common::PerThreadValue<ThreadLoad> loads;
+  std::atomic<std::size_t> next_cell(0);
 
-    // save the local solutions to disk/mem
-    localSolutionManager.save();
+  tbb::parallel_for(std::size_t(0), num_workers, [&](const std::size_t /*worker*/) {
+    auto& load = *loads;
+    Dune::Timer busy_timer;
+    for (auto cell = next_cell++; cell < cells.size(); cell = next_cell++) {
+      const auto coarseEntity = grid.entity(cells[cell].second);
+      MS_LOG_DEBUG << "-------------------------" << std::endl
+                   << "Coarse index " << grid.leafIndexSet().index(coarseEntity) << std::endl;
 
-    //    DXTC_TIMINGS.resetTiming("msfem.local.solve_all_on_single_cell");
-  };
+      Dune::Timer cell_timer;
+      LocalproblemSolutionManager localSolutionManager(*coarse_space_, coarseEntity, localgrid_list_);
+      // solve the problems
+      solve_for_cell(coarseEntity, localSolutionManager);
+      // save the local solutions to disk/mem
+      localSolutionManager.save();
+      load.cell_times.push_back(cell_timer.elapsed());
+      load.cost += cells[cell].first;
+    }
+    load.busy += busy_timer.elapsed();
+  });
 
-  walker.add(func);
-  walker.assemble(partitioning);
+  Dune::XT::Common::MinMaxAvg<double> busyTime;
+  std::size_t num_threads = 0;
+  for (const auto& load : loads) {
+    for (auto time : load.cell_times)
+      solveTime(time);
+    busyTime(load.busy);
+    MS_LOG_DEBUG << boost::format("Local problem thread %d: %d cells, estimated cost %d, busy %.3fs\n") % num_threads
+                        % load.cell_times.size() % load.cost % load.busy;
+    ++num_threads;
+  }
+  MS_LOG_INFO << boost::format("Local problem load balance on rank %d: busy time min %.3fs, avg %.3fs, max %.3fs "
+                               "(max/avg %.2f) over %d threads\n")
+                     % grid.comm().rank() % busyTime.min() % busyTime.average() % busyTime.max()
+                     % (busyTime.average() > 0 ? busyTime.max() / busyTime.average() : 1.) % num_threads;
 
   //! @todo The following debug-output is wrong (number of local problems may be different)
   const auto totalTime = DXTC_TIMINGS.stop("msfem.local.solve_for_all_cells") / 1000.f;
   MS_LOG_INFO << "Local problems solved for " << coarseGridSize << " coarse grid entities.\n"
-              //               << "Minimum time for solving a local problem = " << solveTime.min() << "s.\n"
-              //               << "Maximum time for solving a local problem = " << solveTime.max() << "s.\n"
-              //               << "Average time for solving a local problem = " << solveTime.average() << "s.\n"
+              << "Minimum time for solving a local problem = " << solveTime.min() << "s.\n"
+              << "Maximum time for solving a local problem = " << solveTime.max() << "s.\n"
+              << "Average time for solving a local problem = " << solveTime.average() << "s.\n"
               << "Total time for computing and saving the localproblems = " << totalTime << "s on rank"
               << coarse_space_->grid_view().grid().comm().rank() << std::endl;
+  MS_LOG_DEBUG << "Local problems shared " << structure_cache_.size() << " distinct local grid structures"
+               << std::endl;
+  if (deduplication_)
+    MS_LOG_INFO << "Local problems re-used the correctors of translated cells for " << deduplication_->hits()
+                << " coarse entities, " << deduplication_->size() << " distinct fingerprints" << std::endl;
 } // assemble_all
 
+void LocalProblemSolver::load_for_all_cells(const OfflineArchive& archive)
+{
+  Dune::XT::Common::ScopedTiming st("msfem.local.load_for_all_cells");
+  const auto& grid = coarse_space_->grid_view().grid();
+  std::vector<CommonTraits::EntityType::EntitySeed> coarse_seeds;
+  for (const auto& coarse_entity : Dune::elements(grid.template leafGridView<InteriorBorder_Partition>()))
+    coarse_seeds.push_back(coarse_entity.seed());
+
+  std::atomic<std::size_t> boundary_cells(0);
+  typedef tbb::blocked_range<std::size_t> CellRangeType;
+  tbb::parallel_for(CellRangeType(0, coarse_seeds.size()), [&](const CellRangeType& range) {
+    const CommonTraits::ConstDiscreteFunctionType coarse_dirichlet_extension(*coarse_space_, coarse_dirichlet_vector_);
+    for (auto cell = range.begin(); cell != range.end(); ++cell) {
+      const auto coarse_entity = grid.entity(coarse_seeds[cell]);
+      LocalproblemSolutionManager localSolutionManager(*coarse_space_, coarse_entity, localgrid_list_);
+      archive.read_correctors(grid.leafIndexSet().index(coarse_entity), localSolutionManager.getLocalSolutions());
+      if (coarse_entity.hasBoundaryIntersections()) {
+        if (!coefficient_cache_mode_.empty())
+          localSolutionManager.cache_diffusion(problem_.getDiffusion(), coefficient_cache_mode_);
+        solve_all_on_single_cell(coarse_entity,
+                                 coarse_dirichlet_extension,
+                                 localSolutionManager.diffusion(problem_.getDiffusion()),
+                                 localSolutionManager,
+                                 true);
+        ++boundary_cells;
+      }
+      localSolutionManager.save();
+    }
+  });
+  MS_LOG_INFO << "Loaded correctors of " << coarse_seeds.size() << " coarse entities from the MsFEM archive, solved "
+              << "boundary correctors on " << boundary_cells << " of them" << std::endl;
+}
+
+LocalSolutionStream::LocalSolutionStream(const DMP::ProblemContainer& problem,
+                                         const CommonTraits::SpaceType& coarse_space,
+                                         LocalGridList& localgrid_list)
+  : localgrid_list_(localgrid_list)
+  , solver_(problem, coarse_space, localgrid_list)
+  , current_(CurrentCell{std::numeric_limits<std::size_t>::max(), nullptr})
+{
+}
+
+LocalproblemSolutionManager& LocalSolutionStream::get(const CommonTraits::SpaceType& coarse_space,
+                                                      const MsFEMTraits::CoarseEntityType& coarse_cell)
+{
+  auto& current = *current_;
+  const std::size_t index = coarse_space.grid_view().grid().leafIndexSet().index(coarse_cell);
+  if (current.manager && current.index == index)
+    return *current.manager;
+  // drop the previous cell's correctors before allocating the next ones
+  current.manager.reset();
+  current.manager = std::make_shared<LocalproblemSolutionManager>(coarse_space, coarse_cell, localgrid_list_);
+  current.index = index;
+  solver_.solve_for_cell(coarse_cell, *current.manager);
+  return *current.manager;
+}
+
 } // namespace Multiscale {
 } // namespace Dune {
@@ -8,8 +8,15 @@
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/common/la_backend.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/msfem/localproblems/correctordeduplication.hh>
+#include <dune/multiscale/msfem/localproblems/localstructurecache.hh>
 #include <dune/xt/common/parallel/threadstorage.hh>
 
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+#include <string>
+
 namespace Dune {
 template <class K, int SIZE>
 class FieldVector;
@@ -20,9 +27,12 @@ namespace Multiscale {
 
 struct LocalFunctor;
 class LocalGridList;
+class OfflineArchive;
+class LocalproblemSolutionManager;
 
 namespace Problem {
 struct ProblemContainer;
+struct DiffusionBase;
 }
 
 //! the essential local msfem problem solver class
@@ -34,6 +44,15 @@ private:
 
   LocalGridList& localgrid_list_;
   const Dune::XT::Common::PerThreadValue<CommonTraits::SpaceType> coarse_space_;
+  //! patterns and symbolic factorizations, shared across threads and congruent local grids
+  mutable LocalStructureCache structure_cache_;
+  //! dofs of the coarse Dirichlet extension, computed once and read by all threads
+  CommonTraits::GdtVectorType coarse_dirichlet_vector_;
+  //! msfem.coefficient_cache, empty if disabled
+  const std::string coefficient_cache_mode_;
+  const bool algebraic_coarse_assembly_;
+  //! msfem.corrector_deduplication, nullptr if disabled
+  std::unique_ptr<CorrectorDeduplication> deduplication_;
 
 public:
   typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::LinearOperatorType LinearOperatorType;
@@ -53,13 +72,58 @@ public:
     * **/
   void solve_for_all_cells();
 
+  /** Solve all local MsFEM problems for one coarse entity at once into the manager's solutions, without saving them.
+   * If enabled, the manager also gets the coefficient cache that was filled while assembling and the algebraically
+   * computed coarse element matrix. Thread safe.
+   **/
+  void solve_for_cell(const MsFEMTraits::CoarseEntityType& coarseCell,
+                      LocalproblemSolutionManager& localSolutionManager) const;
+
+  /** Online stage of msfem.archive: the inner correctors of every coarse cell are read from archive, only the
+   * boundary correctors are solved for. The results are saved like in solve_for_all_cells.
+   **/
+  void load_for_all_cells(const OfflineArchive& archive);
+
 private:
-  //! Solve all local MsFEM problems for one coarse entity at once.
+  //! \param boundary_only only the boundary correctors are computed, the inner ones are left untouched
   void solve_all_on_single_cell(const MsFEMTraits::CoarseEntityType& coarseCell,
-                                MsFEMTraits::LocalSolutionVectorType& allLocalSolutions) const;
+                                const CommonTraits::ConstDiscreteFunctionType& coarseDirichletExtension,
+                                const DMP::DiffusionBase& diffusion,
+                                LocalproblemSolutionManager& localSolutionManager,
+                                const bool boundary_only = false) const;
   const DMP::ProblemContainer& problem_;
 }; // end class
 
+/** \brief Local solutions for the msfem.streaming mode
+ *
+ * Instead of solving all local problems up front and keeping every corrector in DiscreteFunctionIO,
+ * the local problems of a coarse cell are solved when the coarse assembly first asks for them.
+ * Matrix and right hand side kernels of the same cell then share the result, and it is freed as
+ * soon as the thread moves on to the next coarse cell. Each thread thus only holds one cell's correctors.
+ */
+class LocalSolutionStream : public boost::noncopyable
+{
+public:
+  LocalSolutionStream(const DMP::ProblemContainer& problem,
+                      const CommonTraits::SpaceType& coarse_space,
+                      LocalGridList& localgrid_list);
+
+  //! the solved local problems of coarse_cell, re-using the last call's result if it was for the same cell
+  LocalproblemSolutionManager& get(const CommonTraits::SpaceType& coarse_space,
+                                   const MsFEMTraits::CoarseEntityType& coarse_cell);
+
+private:
+  struct CurrentCell
+  {
+    std::size_t index;
+    std::shared_ptr<LocalproblemSolutionManager> manager;
+  };
+
+  LocalGridList& localgrid_list_;
+  const LocalProblemSolver solver_;
+  Dune::XT::Common::PerThreadValue<CurrentCell> current_;
+};
+
 } // namespace Multiscale {
 } // namespace Dune {
 
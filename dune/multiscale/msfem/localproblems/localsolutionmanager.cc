@@ -6,6 +6,7 @@
 #include <dune/multiscale/common/df_io.hh>
 #include <dune/multiscale/tools/misc.hh>
 #include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localdiffusioncache.hh>
 #include <dune/multiscale/common/df_io.hh>
 
 namespace Dune {
@@ -25,6 +26,8 @@ LocalproblemSolutionManager::LocalproblemSolutionManager(const CommonTraits::Spa
                             % coarse_space.grid_view().grid().leafIndexSet().index(coarseEntity))
                                .str())
   , memory_backend_(DiscreteFunctionIO::memory(localSolutionLocation_, grid_view_))
+  , diffusion_cache_(memory_backend_.diffusion_cache())
+  , coarse_matrix_(memory_backend_.coarse_matrix())
 {
   for (auto& it : localSolutions_)
     it = make_df_ptr<MsFEMTraits::LocalGridDiscreteFunctionType>("Local problem Solution", memory_backend_.space());
@@ -53,8 +56,11 @@ void LocalproblemSolutionManager::load()
 
 void LocalproblemSolutionManager::save() const
 {
+  memory_backend_.clear();
   for (auto& it : localSolutions_)
     memory_backend_.append(it);
+  memory_backend_.diffusion_cache() = diffusion_cache_;
+  memory_backend_.coarse_matrix() = coarse_matrix_;
 } // save
 
 std::size_t LocalproblemSolutionManager::numBoundaryCorrectors() const
@@ -62,5 +68,27 @@ std::size_t LocalproblemSolutionManager::numBoundaryCorrectors() const
   return numBoundaryCorrectors_;
 }
 
+void LocalproblemSolutionManager::cache_diffusion(const Problem::DiffusionBase& diffusion, const std::string& mode)
+{
+  diffusion_cache_ = std::make_shared<LocalDiffusionCache>(diffusion, grid_view_, mode);
+}
+
+const Problem::DiffusionBase& LocalproblemSolutionManager::diffusion(const Problem::DiffusionBase& uncached) const
+{
+  if (diffusion_cache_)
+    return *diffusion_cache_;
+  return uncached;
+}
+
+void LocalproblemSolutionManager::set_coarse_matrix(CoarseElementMatrixType&& matrix)
+{
+  coarse_matrix_ = std::make_shared<const CoarseElementMatrixType>(std::move(matrix));
+}
+
+const LocalproblemSolutionManager::CoarseElementMatrixType* LocalproblemSolutionManager::coarse_matrix() const
+{
+  return coarse_matrix_.get();
+}
+
 } // namespace Multiscale {
 } // namespace Dune {
@@ -5,10 +5,12 @@
 #ifndef LOCALSOLUTIONMANAGER_HEADERGUARD
 #define LOCALSOLUTIONMANAGER_HEADERGUARD
 
+#include <dune/common/dynmatrix.hh>
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 
 #include <cstddef>
+#include <memory>
 #include <string>
 
 namespace Dune {
@@ -16,12 +18,18 @@ namespace Multiscale {
 
 class MemoryBackend;
 class LocalGridList;
+class LocalDiffusionCache;
+namespace Problem {
+struct DiffusionBase;
+}
 /**
  * @brief One LocalSolutionManager instance per coarse cell
  */
 class LocalproblemSolutionManager
 {
 public:
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> CoarseElementMatrixType;
+
   LocalproblemSolutionManager(const CommonTraits::SpaceType& coarse_space,
                               const MsFEMTraits::CoarseEntityType& coarseEntity,
                               const LocalGridList& subgridList);
@@ -32,10 +40,22 @@ public:
   const MsFEMTraits::LocalGridViewType& grid_view() const;
 
   void load();
+  //! keeps the solutions, and the coefficient cache if there is one, in DiscreteFunctionIO. Replaces earlier saves.
   void save() const;
 
   std::size_t numBoundaryCorrectors() const;
 
+  //! sets up a LocalDiffusionCache of diffusion on this cell's local grid, see msfem.coefficient_cache
+  void cache_diffusion(const Problem::DiffusionBase& diffusion, const std::string& mode);
+  //! \return the cell's coefficient cache if one was set up for this or a saved manager of the cell, else uncached
+  const Problem::DiffusionBase& diffusion(const Problem::DiffusionBase& uncached) const;
+
+  void set_coarse_matrix(CoarseElementMatrixType&& matrix);
+  /** \return the MsFEM coarse element matrix computed from the local stiffness matrix, if msfem.coarse_assembly is
+   * "algebraic" and this or a saved manager of the cell solved the local problems. Else nullptr.
+   **/
+  const CoarseElementMatrixType* coarse_matrix() const;
+
 private:
   const LocalGridList& subgridList_;
   const MsFEMTraits::LocalGridType& subgrid_;
@@ -45,6 +65,8 @@ private:
   MsFEMTraits::LocalSolutionVectorType localSolutions_;
   const std::string localSolutionLocation_;
   MemoryBackend& memory_backend_;
+  std::shared_ptr<LocalDiffusionCache> diffusion_cache_;
+  std::shared_ptr<const CoarseElementMatrixType> coarse_matrix_;
 };
 }
 }
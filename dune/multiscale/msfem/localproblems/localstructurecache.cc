@@ -0,0 +1,393 @@
+#include <config.h>
+
+#include "localstructurecache.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/gdt/operators/elliptic-cg.hh>
+#include <dune/xt/common/memory.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/problems/base.hh>
+
+#include <algorithm>
+
+#if HAVE_LAPACK
+extern "C" {
+void dgetrf_(const int* m, const int* n, double* a, const int* lda, int* ipiv, int* info);
+void dgetrs_(const char* trans,
+             const int* n,
+             const int* nrhs,
+             const double* a,
+             const int* lda,
+             const int* ipiv,
+             double* b,
+             const int* ldb,
+             int* info);
+void dpotrf_(const char* uplo, const int* n, double* a, const int* lda, int* info);
+void dpotrs_(const char* uplo,
+             const int* n,
+             const int* nrhs,
+             const double* a,
+             const int* lda,
+             double* b,
+             const int* ldb,
+             int* info);
+}
+#endif
+
+namespace Dune {
+namespace Multiscale {
+
+typedef GDT::Operators::EllipticCG<Problem::LocalDiffusionType,
+                                   LocalStructure::LinearOperatorType,
+                                   MsFEMTraits::LocalSpaceType>
+    LocalEllipticOperatorType;
+
+#if HAVE_CHOLMOD
+//! a CHOLMOD view on a lower triangle in compressed column storage, pattern only if values is null
+static cholmod_sparse lower_triangle_view(const std::vector<SuiteSparse_long>& column_start,
+                                          const std::vector<SuiteSparse_long>& row_index,
+                                          double* values)
+{
+  cholmod_sparse view;
+  view.nrow = column_start.size() - 1;
+  view.ncol = column_start.size() - 1;
+  view.nzmax = row_index.size();
+  view.p = const_cast<SuiteSparse_long*>(column_start.data());
+  view.i = const_cast<SuiteSparse_long*>(row_index.data());
+  view.nz = nullptr;
+  view.x = values;
+  view.z = nullptr;
+  view.stype = -1;
+  view.itype = CHOLMOD_LONG;
+  view.xtype = values ? CHOLMOD_REAL : CHOLMOD_PATTERN;
+  view.dtype = CHOLMOD_DOUBLE;
+  view.sorted = true;
+  view.packed = true;
+  return view;
+}
+#endif
+
+LocalStructure::LocalStructure(const MsFEMTraits::LocalSpaceType& space)
+#if HAVE_UMFPACK
+  : symbolic_(nullptr)
+  , pattern_(LocalEllipticOperatorType::pattern(space))
+#else
+  : pattern_(LocalEllipticOperatorType::pattern(space))
+#endif
+{
+#if HAVE_CHOLMOD
+  cholesky_symbolic_ = nullptr;
+  cholmod_l_start(&cholesky_common_);
+#endif
+}
+
+LocalStructure::~LocalStructure()
+{
+#if HAVE_UMFPACK
+  if (symbolic_)
+    umfpack_dl_free_symbolic(&symbolic_);
+#endif
+#if HAVE_CHOLMOD
+  if (cholesky_symbolic_)
+    cholmod_l_free_factor(&cholesky_symbolic_, &cholesky_common_);
+  cholmod_l_finish(&cholesky_common_);
+#endif
+}
+
+const Stuff::LA::SparsityPatternDefault& LocalStructure::pattern() const
+{
+  return pattern_;
+}
+
+#if HAVE_UMFPACK
+void* LocalStructure::symbolic(const LinearOperatorType& matrix)
+{
+  std::call_once(symbolic_flag_, [&]() {
+    const auto& backend = matrix.backend();
+    const auto rows = backend.N();
+    row_start_.resize(rows + 1);
+    column_index_.reserve(backend.nonzeroes());
+    std::vector<double> values;
+    values.reserve(backend.nonzeroes());
+    row_start_[0] = 0;
+    for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it) {
+      for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it) {
+        column_index_.push_back(col_it.index());
+        values.push_back((*col_it)[0][0]);
+      }
+      row_start_[row_it.index() + 1] = column_index_.size();
+    }
+    const auto status = umfpack_dl_symbolic(
+        rows, rows, row_start_.data(), column_index_.data(), values.data(), &symbolic_, nullptr, nullptr);
+    if (status != UMFPACK_OK)
+      DUNE_THROW(InvalidStateException, "UMFPACK symbolic analysis of local problem failed with status " << status);
+  });
+  return symbolic_;
+}
+
+const std::vector<SuiteSparse_long>& LocalStructure::row_start() const
+{
+  return row_start_;
+}
+
+const std::vector<SuiteSparse_long>& LocalStructure::column_index() const
+{
+  return column_index_;
+}
+#endif
+
+#if HAVE_CHOLMOD
+cholmod_factor* LocalStructure::cholesky_symbolic(const LinearOperatorType& matrix)
+{
+  std::call_once(cholesky_flag_, [&]() {
+    const auto& backend = matrix.backend();
+    upper_row_start_.resize(backend.N() + 1);
+    upper_row_start_[0] = 0;
+    for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it) {
+      for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it)
+        if (col_it.index() >= row_it.index())
+          upper_column_index_.push_back(col_it.index());
+      upper_row_start_[row_it.index() + 1] = upper_column_index_.size();
+    }
+    auto pattern = lower_triangle_view(upper_row_start_, upper_column_index_, nullptr);
+    cholesky_common_.supernodal = CHOLMOD_SUPERNODAL;
+    cholesky_common_.nmethods = 1;
+    cholesky_common_.method[0].ordering = CHOLMOD_NESDIS;
+    cholesky_symbolic_ = cholmod_l_analyze(&pattern, &cholesky_common_);
+    if (!cholesky_symbolic_ && cholesky_common_.status == CHOLMOD_NOT_INSTALLED) {
+      // nested dissection needs CHOLMOD's partition module
+      cholesky_common_.method[0].ordering = CHOLMOD_AMD;
+      cholesky_common_.status = CHOLMOD_OK;
+      cholesky_symbolic_ = cholmod_l_analyze(&pattern, &cholesky_common_);
+    }
+    if (!cholesky_symbolic_)
+      DUNE_THROW(InvalidStateException,
+                 "CHOLMOD symbolic analysis of local problem failed with status " << cholesky_common_.status);
+  });
+  return cholesky_symbolic_;
+}
+
+const std::vector<SuiteSparse_long>& LocalStructure::upper_row_start() const
+{
+  return upper_row_start_;
+}
+
+const std::vector<SuiteSparse_long>& LocalStructure::upper_column_index() const
+{
+  return upper_column_index_;
+}
+#endif
+
+LocalStructure& LocalStructureCache::get(const LocalStructureCache::ShapeType& shape,
+                                         const MsFEMTraits::LocalSpaceType& space)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto& structure = structures_[shape];
+  if (!structure)
+    structure = Dune::XT::Common::make_unique<LocalStructure>(space);
+  return *structure;
+}
+
+std::size_t LocalStructureCache::size() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return structures_.size();
+}
+
+#if HAVE_UMFPACK
+LocalDirectInverse::LocalDirectInverse(LocalStructure& structure,
+                                       const LocalStructure::LinearOperatorType& matrix,
+                                       const int verbose)
+  : structure_(structure)
+  , numeric_(nullptr)
+{
+  umfpack_dl_defaults(control_.data());
+  control_[UMFPACK_PRL] = verbose;
+  void* symbolic = structure.symbolic(matrix);
+
+  // same traversal order as in LocalStructure::symbolic, ISTL keeps column indices sorted
+  const auto& backend = matrix.backend();
+  values_.reserve(structure_.column_index().size());
+  for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it)
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it)
+      values_.push_back((*col_it)[0][0]);
+  if (values_.size() != structure_.column_index().size())
+    DUNE_THROW(InvalidStateException, "local system matrix does not match the cached sparsity structure");
+
+  std::array<double, UMFPACK_INFO> info;
+  const auto status = umfpack_dl_numeric(structure_.row_start().data(),
+                                         structure_.column_index().data(),
+                                         values_.data(),
+                                         symbolic,
+                                         &numeric_,
+                                         control_.data(),
+                                         info.data());
+  if (verbose > 0)
+    umfpack_dl_report_info(control_.data(), info.data());
+  if (status != UMFPACK_OK)
+    DUNE_THROW(InvalidStateException, "UMFPACK numeric factorization of local problem failed with status " << status);
+}
+
+LocalDirectInverse::~LocalDirectInverse()
+{
+  if (numeric_)
+    umfpack_dl_free_numeric(&numeric_);
+}
+
+void LocalDirectInverse::apply(const VectorType& rhs, VectorType& solution) const
+{
+  const auto& b = rhs.backend();
+  auto& x = solution.backend();
+  assert(b.size() == x.size());
+  std::array<double, UMFPACK_INFO> info;
+  // the factorization is that of the transposed system matrix, see LocalStructure::symbolic
+  const auto status = umfpack_dl_solve(UMFPACK_At,
+                                       structure_.row_start().data(),
+                                       structure_.column_index().data(),
+                                       values_.data(),
+                                       &x[0][0],
+                                       &b[0][0],
+                                       numeric_,
+                                       control_.data(),
+                                       info.data());
+  if (status != UMFPACK_OK)
+    DUNE_THROW(InvalidStateException, "UMFPACK solve of local problem failed with status " << status);
+}
+#endif
+
+#if HAVE_CHOLMOD
+LocalCholeskyInverse::LocalCholeskyInverse(LocalStructure& structure,
+                                           const LocalStructure::LinearOperatorType& matrix,
+                                           const std::set<size_t>& constrained,
+                                           const int verbose)
+  : structure_(structure)
+  , factor_(nullptr)
+{
+  cholmod_l_start(&common_);
+  if (verbose > 0)
+    common_.print = 4;
+  auto symbolic = structure.cholesky_symbolic(matrix);
+
+  const auto& backend = matrix.backend();
+  std::vector<bool> is_constrained(backend.N(), false);
+  for (const auto dof : constrained)
+    is_constrained[dof] = true;
+  // same traversal order as in LocalStructure::cholesky_symbolic
+  values_.reserve(structure_.upper_column_index().size());
+  for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it) {
+    const auto row = row_it.index();
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it) {
+      const auto col = col_it.index();
+      if (col < row)
+        continue;
+      const bool eliminated = col != row && (is_constrained[row] || is_constrained[col]);
+      values_.push_back(eliminated ? 0. : (*col_it)[0][0]);
+    }
+  }
+  if (values_.size() != structure_.upper_column_index().size())
+    DUNE_THROW(InvalidStateException, "local system matrix does not match the cached sparsity structure");
+
+  factor_ = cholmod_l_copy_factor(symbolic, &common_);
+  auto lower = lower_triangle_view(structure_.upper_row_start(), structure_.upper_column_index(), values_.data());
+  cholmod_l_factorize(&lower, factor_, &common_);
+  if (verbose > 0)
+    cholmod_l_print_factor(factor_, "local Cholesky factor", &common_);
+  if (common_.status != CHOLMOD_OK)
+    DUNE_THROW(InvalidStateException,
+               "CHOLMOD numeric factorization of local problem failed with status " << common_.status);
+}
+
+LocalCholeskyInverse::~LocalCholeskyInverse()
+{
+  if (factor_)
+    cholmod_l_free_factor(&factor_, &common_);
+  cholmod_l_finish(&common_);
+}
+
+void LocalCholeskyInverse::apply(const VectorType& rhs, VectorType& solution) const
+{
+  const auto& b = rhs.backend();
+  auto& x = solution.backend();
+  assert(b.size() == x.size());
+  cholmod_dense rhs_view;
+  rhs_view.nrow = b.size();
+  rhs_view.ncol = 1;
+  rhs_view.nzmax = b.size();
+  rhs_view.d = b.size();
+  rhs_view.x = const_cast<double*>(&b[0][0]);
+  rhs_view.z = nullptr;
+  rhs_view.xtype = CHOLMOD_REAL;
+  rhs_view.dtype = CHOLMOD_DOUBLE;
+  auto result = cholmod_l_solve(CHOLMOD_A, factor_, &rhs_view, &common_);
+  if (!result)
+    DUNE_THROW(InvalidStateException, "CHOLMOD solve of local problem failed with status " << common_.status);
+  const auto values = static_cast<const double*>(result->x);
+  std::copy(values, values + b.size(), &x[0][0]);
+  cholmod_l_free_dense(&result, &common_);
+}
+#endif
+
+#if HAVE_LAPACK
+LocalDenseInverse::LocalDenseInverse(const LocalStructure::LinearOperatorType& matrix,
+                                     const std::set<size_t>& constrained,
+                                     const bool symmetric)
+  : size_(matrix.backend().N())
+  , symmetric_(symmetric)
+  , factor_(size_ * size_, 0.)
+{
+  const auto& backend = matrix.backend();
+  std::vector<bool> is_constrained(size_, false);
+  for (const auto dof : constrained)
+    is_constrained[dof] = true;
+  for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it) {
+    const auto row = row_it.index();
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it) {
+      const auto col = col_it.index();
+      if (symmetric_ && col != row && (is_constrained[row] || is_constrained[col]))
+        continue;
+      factor_[col * size_ + row] = (*col_it)[0][0];
+    }
+  }
+
+  int info = 0;
+  if (symmetric_) {
+    dpotrf_("L", &size_, factor_.data(), &size_, &info);
+  } else {
+    pivots_.resize(size_);
+    dgetrf_(&size_, &size_, factor_.data(), &size_, pivots_.data(), &info);
+  }
+  if (info != 0)
+    DUNE_THROW(InvalidStateException, "LAPACK factorization of local problem failed with info " << info);
+}
+
+void LocalDenseInverse::apply(const MsFEMTraits::LocalSolutionVectorType& allLocalRHS,
+                              MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+                              const std::size_t numSolves,
+                              const std::size_t firstSolve) const
+{
+  assert(firstSolve <= numSolves);
+  const int num = numSolves - firstSolve;
+  if (num == 0)
+    return;
+  block_.resize(size_ * num);
+  for (const auto i : Dune::XT::Common::value_range(num)) {
+    const auto& b = allLocalRHS[firstSolve + i]->vector().backend();
+    assert(int(b.size()) == size_);
+    std::copy(&b[0][0], &b[0][0] + size_, block_.begin() + i * size_);
+  }
+  int info = 0;
+  if (symmetric_)
+    dpotrs_("L", &size_, &num, factor_.data(), &size_, block_.data(), &size_, &info);
+  else
+    dgetrs_("N", &size_, &num, factor_.data(), &size_, pivots_.data(), block_.data(), &size_, &info);
+  if (info != 0)
+    DUNE_THROW(InvalidStateException, "LAPACK solve of local problem failed with info " << info);
+  for (const auto i : Dune::XT::Common::value_range(num)) {
+    auto& x = allLocalSolutions[firstSolve + i]->vector().backend();
+    std::copy(block_.begin() + i * size_, block_.begin() + (i + 1) * size_, &x[0][0]);
+  }
+}
+#endif
+
+} // namespace Multiscale {
+} // namespace Dune {
@@ -0,0 +1,190 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_LOCALSTRUCTURECACHE_HH
+#define DUNE_MULTISCALE_MSFEM_LOCALSTRUCTURECACHE_HH
+
+#include <dune/multiscale/common/traits.hh>
+#include <dune/multiscale/common/la_backend.hh>
+#include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/stuff/la/container/pattern.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#if HAVE_UMFPACK
+#include <umfpack.h>
+#endif
+#if HAVE_CHOLMOD
+#include <cholmod.h>
+#endif
+
+namespace Dune {
+namespace Multiscale {
+
+/**
+ * \brief Everything about a local problem that only depends on the local grid's topology
+ *
+ * LocalGridList creates the same structured cube for all interior coarse cells and only a few different
+ * shapes at the domain boundary (oversampling is cut there). Sparsity pattern and symbolic factorization
+ * are therefore computed once per shape and shared by all coarse cells of that shape.
+ */
+class LocalStructure : public boost::noncopyable
+{
+public:
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::LinearOperatorType LinearOperatorType;
+
+  explicit LocalStructure(const MsFEMTraits::LocalSpaceType& space);
+  ~LocalStructure();
+
+  const Stuff::LA::SparsityPatternDefault& pattern() const;
+
+#if HAVE_UMFPACK
+  /** symbolic analysis of the system matrix, computed from the first matrix passed in
+   * \note the matrix is interpreted as compressed column storage of its transpose, which
+   * saves the conversion from ISTL's row major format
+   **/
+  void* symbolic(const LinearOperatorType& matrix);
+
+  const std::vector<SuiteSparse_long>& row_start() const;
+  const std::vector<SuiteSparse_long>& column_index() const;
+
+private:
+  std::once_flag symbolic_flag_;
+  std::vector<SuiteSparse_long> row_start_;
+  std::vector<SuiteSparse_long> column_index_;
+  void* symbolic_;
+#endif
+
+#if HAVE_CHOLMOD
+public:
+  /** supernodal symbolic Cholesky factorization of the upper triangle of the system matrix, computed once
+   * Fill reducing ordering is nested dissection, AMD if CHOLMOD was built without METIS.
+   * \note the row major upper triangle is used as compressed column storage of the lower triangle. The returned
+   * factor is shared, only copies of it may be factorized.
+   **/
+  cholmod_factor* cholesky_symbolic(const LinearOperatorType& matrix);
+
+  const std::vector<SuiteSparse_long>& upper_row_start() const;
+  const std::vector<SuiteSparse_long>& upper_column_index() const;
+
+private:
+  std::once_flag cholesky_flag_;
+  std::vector<SuiteSparse_long> upper_row_start_;
+  std::vector<SuiteSparse_long> upper_column_index_;
+  cholmod_common cholesky_common_;
+  cholmod_factor* cholesky_symbolic_;
+#endif
+
+private:
+  const Stuff::LA::SparsityPatternDefault pattern_;
+};
+
+//! thread safe LocalStructure storage, keyed by the number of local grid elements per dimension
+class LocalStructureCache : public boost::noncopyable
+{
+public:
+  typedef std::array<unsigned int, CommonTraits::world_dim> ShapeType;
+
+  //! returns the cached structure for shape, computing it from space on first request
+  LocalStructure& get(const ShapeType& shape, const MsFEMTraits::LocalSpaceType& space);
+
+  std::size_t size() const;
+
+private:
+  std::map<ShapeType, std::unique_ptr<LocalStructure>> structures_;
+  mutable std::mutex mutex_;
+};
+
+#if HAVE_UMFPACK
+//! UMFPACK numeric factorization of one local system matrix, re-using the symbolic analysis of its LocalStructure
+class LocalDirectInverse : public boost::noncopyable
+{
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType VectorType;
+
+public:
+  LocalDirectInverse(LocalStructure& structure, const LocalStructure::LinearOperatorType& matrix, const int verbose);
+  ~LocalDirectInverse();
+
+  //! back-substitution for a single right hand side
+  void apply(const VectorType& rhs, VectorType& solution) const;
+
+private:
+  const LocalStructure& structure_;
+  std::vector<double> values_;
+  void* numeric_;
+  std::array<double, UMFPACK_CONTROL> control_;
+};
+#endif
+
+#if HAVE_CHOLMOD
+/**
+ * \brief CHOLMOD numeric Cholesky factorization of one symmetric local system matrix
+ *
+ * Needs about half the memory of the LU factorization in LocalDirectInverse. The Dirichlet constraints only clear the
+ * rows of the constrained DoFs, their columns are dropped here. This is exact as long as the right hand sides vanish
+ * on the constrained DoFs.
+ */
+class LocalCholeskyInverse : public boost::noncopyable
+{
+  typedef typename BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType VectorType;
+
+public:
+  LocalCholeskyInverse(LocalStructure& structure,
+                       const LocalStructure::LinearOperatorType& matrix,
+                       const std::set<size_t>& constrained,
+                       const int verbose);
+  ~LocalCholeskyInverse();
+
+  //! forward and back-substitution for a single right hand side
+  void apply(const VectorType& rhs, VectorType& solution) const;
+
+private:
+  const LocalStructure& structure_;
+  std::vector<double> values_;
+  mutable cholmod_common common_;
+  cholmod_factor* factor_;
+};
+#endif
+
+#if HAVE_LAPACK
+/**
+ * \brief Dense LAPACK factorization of a small local system matrix
+ *
+ * Below a few hundred DoFs the setup of a sparse direct solver costs more than the arithmetic. The matrix is
+ * copied into a column major dense block instead, factorized with dpotrf (symmetric, constrained columns dropped
+ * as in LocalCholeskyInverse) or dgetrf, and all right hand sides of the coarse cell are solved in one call.
+ */
+class LocalDenseInverse : public boost::noncopyable
+{
+public:
+  LocalDenseInverse(const LocalStructure::LinearOperatorType& matrix,
+                    const std::set<size_t>& constrained,
+                    const bool symmetric);
+
+  //! solves for the right hand sides firstSolve, ..., numSolves - 1 at once
+  void apply(const MsFEMTraits::LocalSolutionVectorType& allLocalRHS,
+             MsFEMTraits::LocalSolutionVectorType& allLocalSolutions,
+             const std::size_t numSolves,
+             const std::size_t firstSolve = 0) const;
+
+private:
+  const int size_;
+  const bool symmetric_;
+  std::vector<double> factor_;
+  std::vector<int> pivots_;
+  mutable std::vector<double> block_;
+};
+#endif
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_LOCALSTRUCTURECACHE_HH
@@ -15,6 +15,7 @@ Dune::Multiscale::LocalsolutionProxy::LocalsolutionProxy(CorrectionsMapType&& co
   , corrections_(std::move(corrections))
   , view_(coarseSpace.grid_view())
   , index_set_(view_.grid().leafIndexSet())
+  , gridlist_(gridlist)
   , search_(coarseSpace, gridlist)
 {
   assert(corrections_.size() == index_set_.size(0));
@@ -54,6 +55,22 @@ Dune::Multiscale::LocalGridSearch& Dune::Multiscale::LocalsolutionProxy::search(
   return *search_;
 }
 
+const Dune::Multiscale::LocalsolutionProxy::CorrectionsMapType&
+Dune::Multiscale::LocalsolutionProxy::corrections() const
+{
+  return corrections_;
+}
+
+const Dune::Multiscale::CommonTraits::GridViewType& Dune::Multiscale::LocalsolutionProxy::coarse_view() const
+{
+  return view_;
+}
+
+const Dune::Multiscale::LocalGridList& Dune::Multiscale::LocalsolutionProxy::localgrid_list() const
+{
+  return gridlist_;
+}
+
 void Dune::Multiscale::LocalsolutionProxy::visualize_parts(const Dune::XT::Common::Configuration& config) const
 {
   const auto rank = MPIHelper::getCollectiveCommunication().rank();
@@ -41,6 +41,10 @@ public:
   void add(const CommonTraits::DiscreteFunctionType& coarse_func);
 
   LocalGridSearch& search();
+
+  const CorrectionsMapType& corrections() const;
+  const CommonTraits::GridViewType& coarse_view() const;
+  const LocalGridList& localgrid_list() const;
   void visualize_parts(const XT::Common::Configuration& config) const;
 
   void visualize(const std::string&) const;
@@ -49,6 +53,7 @@ private:
   CorrectionsMapType corrections_;
   const CommonTraits::GridViewType view_;
   const LeafIndexSetType& index_set_;
+  const LocalGridList& gridlist_;
   Dune::XT::Common::PerThreadValue<LocalGridSearch> search_;
 };
 
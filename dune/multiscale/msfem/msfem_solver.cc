@@ -21,11 +21,14 @@
 #include <dune/multiscale/common/df_io.hh>
 #include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
 #include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/offline_archive.hh>
 
 #include <dune/xt/common/logging.hh>
 #include <dune/xt/common/configuration.hh>
 #include <dune/xt/common/timings.hh>
 #include <dune/xt/common/ranges.hh>
+#include <dune/xt/common/memory.hh>
+#include <dune/xt/common/parallel/threadstorage.hh>
 
 #include <dune/gdt/operators/prolongations.hh>
 #include <dune/gdt/spaces/cg.hh>
@@ -37,6 +40,9 @@
 
 #include <dune/multiscale/msfem/localsolution_proxy.hh>
 
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 namespace Dune {
 namespace Multiscale {
 
@@ -44,80 +50,135 @@ void Elliptic_MsFEM_Solver::identify_fine_scale_part(const Problem::ProblemConta
                                                      LocalGridList& localgrid_list,
                                                      const CommonTraits::DiscreteFunctionType& coarse_msfem_solution,
                                                      const CommonTraits::SpaceType& coarse_space,
-                                                     std::unique_ptr<LocalsolutionProxy>& msfem_solution) const
+                                                     std::unique_ptr<LocalsolutionProxy>& msfem_solution,
+                                                     const bool boundary_correctors) const
 {
   Dune::XT::Common::ScopedTiming st("msfem.idFine");
   const int rank = Dune::MPIHelper::getCollectiveCommunication().rank();
 
-  auto& coarse_indexset = coarse_space.grid_view().grid().leafIndexSet();
-  const bool is_simplex_grid = DSG::is_simplex_grid(coarse_space);
+  const auto& grid = coarse_space.grid_view().grid();
+  auto& coarse_indexset = grid.leafIndexSet();
+
+  // in streaming mode no correctors were kept, re-solve them cell by cell and keep only the combined correction
+  std::unique_ptr<LocalProblemSolver> local_solver(nullptr);
+  if (problem.config().get("msfem.streaming", false))
+    local_solver = Dune::XT::Common::make_unique<LocalProblemSolver>(problem, coarse_space, localgrid_list);
+  const auto cut_overlay = problem.config().get("msfem.oversampling_layers", 0) > 0;
+  const auto vtk_output = problem.config().get("msfem.local_corrections_vtk_output", false);
+  const std::string datadir = problem.config().get("global.datadir", "data");
 
+  // all keys are inserted up front, the threads below then only write to their own cells' entries
   LocalsolutionProxy::CorrectionsMapType local_corrections;
-  const auto interior = coarse_space.grid_view().grid().leafGridView<InteriorBorder_Partition>();
+  std::vector<CommonTraits::EntityType::EntitySeed> coarse_seeds;
+  const auto interior = grid.leafGridView<InteriorBorder_Partition>();
   for (const auto& coarse_entity : Dune::elements(interior)) {
-    LocalproblemSolutionManager localSolutionManager(coarse_space, coarse_entity, localgrid_list);
-    localSolutionManager.load();
-    auto& localproblem_solutions = localSolutionManager.getLocalSolutions();
-    const auto coarse_index = coarse_indexset.index(coarse_entity);
-    local_corrections[coarse_index] = Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(
-        localSolutionManager.space(), "correction");
-
-    auto& local_correction = *local_corrections[coarse_index];
-    local_correction.vector() *= 0;
-    const auto coarseSolutionLF = coarse_msfem_solution.local_discrete_function(coarse_entity);
-
-    //! @warning At this point, we assume to have the same types of elements in the coarse and fine grid!
-    //            BOOST_ASSERT_MSG(
-    //                static_cast<long long>(localSolutions.size() - localSolManager.numBoundaryCorrectors()) ==
-    //                    static_cast<long long>(coarseSolutionLF.size()),
-    //                "The current implementation relies on having thesame types of elements on coarse and fine
-    // level!");
-    for (std::size_t dof = 0; dof < coarseSolutionLF->vector().size(); ++dof) {
-      localproblem_solutions[dof]->vector() *= coarseSolutionLF->vector().get(dof);
-      local_correction.vector() += localproblem_solutions[dof]->vector();
-    }
+    coarse_seeds.push_back(coarse_entity.seed());
+    local_corrections[coarse_indexset.index(coarse_entity)] = nullptr;
+  }
 
-    // oversampling : restrict the local correctors to the element T
-    // ie set all dofs not "covered" by the coarse cell to 0
-    // also adds lg-prolongation of coarse_solution to local_correction
-    const auto cut_overlay = problem.config().get("msfem.oversampling_layers", 0) > 0;
-    const auto& reference_element = DSG::reference_element(coarse_entity);
-    const auto& coarse_geometry = coarse_entity.geometry();
-    for (const auto& local_entity : Dune::elements(localSolutionManager.space().grid_view())) {
-      const auto& lg_points = localSolutionManager.space().lagrange_points(local_entity);
-      auto entity_local_correction = local_correction.local_discrete_function(local_entity);
-
-      for (const auto lg_i : Dune::XT::Common::value_range(int(lg_points.size()))) {
-        const auto local_point = lg_points[lg_i];
-        const auto global_lg_point = local_entity.geometry().global(local_point);
-        const auto local_coarse_point = coarse_geometry.local(global_lg_point);
-        auto& vec = entity_local_correction->vector();
-        if (cut_overlay) {
-          const bool covered = reference_element.checkInside(local_coarse_point);
-          vec.set(lg_i, covered ? vec.get(lg_i) : 0);
+  // coarse spaces are not thread safe, the solution's dofs are shared
+  const Dune::XT::Common::PerThreadValue<CommonTraits::SpaceType> thread_coarse_space(coarse_space);
+  const auto& coarse_solution_vector = coarse_msfem_solution.vector();
+
+  typedef tbb::blocked_range<std::size_t> CellRangeType;
+  tbb::parallel_for(CellRangeType(0, coarse_seeds.size()), [&](const CellRangeType& range) {
+    const auto& space = *thread_coarse_space;
+    const CommonTraits::ConstDiscreteFunctionType coarse_solution(space, coarse_solution_vector);
+    for (auto cell = range.begin(); cell != range.end(); ++cell) {
+      const auto coarse_entity = grid.entity(coarse_seeds[cell]);
+      LocalproblemSolutionManager localSolutionManager(space, coarse_entity, localgrid_list);
+      if (local_solver)
+        local_solver->solve_for_cell(coarse_entity, localSolutionManager);
+      else
+        localSolutionManager.load();
+      auto& localproblem_solutions = localSolutionManager.getLocalSolutions();
+      const auto coarse_index = coarse_indexset.index(coarse_entity);
+      auto correction_ptr = Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(
+          localSolutionManager.space(), "correction");
+
+      auto& local_correction = *correction_ptr;
+      local_correction.vector() *= 0;
+      const auto coarseSolutionLF = coarse_solution.local_function(coarse_entity);
+      const auto& coarse_dofs = coarseSolutionLF->vector();
+
+      //! @warning At this point, we assume to have the same types of elements in the coarse and fine grid!
+      // the loaded solutions are shared with DiscreteFunctionIO and must not be modified, they may be needed again
+      for (std::size_t dof = 0; dof < coarse_dofs.size(); ++dof)
+        local_correction.vector().axpy(coarse_dofs.get(dof), localproblem_solutions[dof]->vector());
+
+      // oversampling : restrict the local correctors to the element T
+      // ie set all dofs not "covered" by the coarse cell to 0
+      if (cut_overlay) {
+        const auto& reference_element = DSG::reference_element(coarse_entity);
+        const auto& coarse_geometry = coarse_entity.geometry();
+        for (const auto& local_entity : Dune::elements(localSolutionManager.space().grid_view())) {
+          const auto& lg_points = localSolutionManager.space().lagrange_points(local_entity);
+          auto entity_local_correction = local_correction.local_discrete_function(local_entity);
+          auto& vec = entity_local_correction->vector();
+          for (const auto lg_i : Dune::XT::Common::value_range(int(lg_points.size()))) {
+            const auto global_lg_point = local_entity.geometry().global(lg_points[lg_i]);
+            if (!reference_element.checkInside(coarse_geometry.local(global_lg_point)))
+              vec.set(lg_i, 0);
+          }
         }
       }
-    }
 
-    // add dirichlet corrector
-    local_correction.vector() += localproblem_solutions[coarseSolutionLF->vector().size() + 1]->vector();
-    // substract neumann corrector
-    local_correction.vector() -= localproblem_solutions[coarseSolutionLF->vector().size()]->vector();
+      if (boundary_correctors) {
+        // add dirichlet corrector
+        local_correction.vector() += localproblem_solutions[coarse_dofs.size() + 1]->vector();
+        // substract neumann corrector
+        local_correction.vector() -= localproblem_solutions[coarse_dofs.size()]->vector();
+      }
 
-    if (problem.config().get("msfem.local_corrections_vtk_output", false)) {
-      const std::string name = (boost::format("local_%04d_correction_%03d_") % rank % coarse_index).str();
-      Dune::Multiscale::OutputParameters outputparam(problem.config().get("global.datadir", "data"));
-      outputparam.set_prefix(name);
-      local_correction.visualize(outputparam.fullpath(local_correction.name()));
+      if (vtk_output) {
+        const std::string name = (boost::format("local_%04d_correction_%03d_") % rank % coarse_index).str();
+        Dune::Multiscale::OutputParameters outputparam(datadir);
+        outputparam.set_prefix(name);
+        local_correction.visualize(outputparam.fullpath(local_correction.name()));
+      }
+      localproblem_solutions.clear();
+      local_corrections.find(coarse_index)->second = std::move(correction_ptr);
     }
-    localproblem_solutions.clear();
-  }
+  });
 
   MS_LOG_INFO_0 << "Dirichlet correctors are broken and disabled\n";
   msfem_solution =
       Dune::XT::Common::make_unique<LocalsolutionProxy>(std::move(local_corrections), coarse_space, localgrid_list);
 }
 
+std::unique_ptr<CoarseScaleOperator>
+Elliptic_MsFEM_Solver::coarse_operator(const DMP::ProblemContainer& problem,
+                                       const CommonTraits::SpaceType& coarse_space,
+                                       LocalGridList& localgrid_list) const
+{
+  //! Solutions are kept in-memory via DiscreteFunctionIO::MemoryBackend by LocalsolutionManagers,
+  //! unless msfem.streaming is set. Then they are solved during coarse assembly and only the
+  //! correctors of one coarse cell per thread are alive at any time.
+  //! With msfem.archive = offline the inner correctors and the coarse matrix are additionally archived, with online
+  //! they are read from the archive instead of being computed.
+  std::unique_ptr<OfflineArchive> archive(nullptr);
+  if (OfflineArchive::mode(problem) != OfflineArchive::Mode::none) {
+    if (problem.config().get("msfem.streaming", false))
+      DUNE_THROW(InvalidStateException, "msfem.archive needs all correctors to be kept, disable msfem.streaming");
+    archive = Dune::XT::Common::make_unique<OfflineArchive>(problem, coarse_space, localgrid_list);
+  }
+  std::unique_ptr<LocalSolutionStream> stream(nullptr);
+  if (problem.config().get("msfem.streaming", false))
+    stream = Dune::XT::Common::make_unique<LocalSolutionStream>(problem, coarse_space, localgrid_list);
+  else if (archive && archive->online())
+    LocalProblemSolver(problem, coarse_space, localgrid_list).load_for_all_cells(*archive);
+  else
+    LocalProblemSolver(problem, coarse_space, localgrid_list).solve_for_all_cells();
+  if (archive && !archive->online())
+    archive->write_correctors(coarse_space, localgrid_list);
+
+  auto op = Dune::XT::Common::make_unique<CoarseScaleOperator>(
+      problem, coarse_space, localgrid_list, stream.get(), archive.get());
+  if (archive && !archive->online())
+    archive->close();
+  return op;
+}
+
 void Elliptic_MsFEM_Solver::apply(DMP::ProblemContainer& problem,
                                   const CommonTraits::SpaceType& coarse_space,
                                   std::unique_ptr<LocalsolutionProxy>& solution,
@@ -129,11 +190,7 @@ void Elliptic_MsFEM_Solver::apply(DMP::ProblemContainer& problem,
   CommonTraits::DiscreteFunctionType coarse_msfem_solution(coarse_space, "Coarse Part MsFEM Solution");
   coarse_msfem_solution.vector() *= 0;
 
-  //! Solutions are kept in-memory via DiscreteFunctionIO::MemoryBackend by LocalsolutionManagers
-  LocalProblemSolver(problem, coarse_space, localgrid_list).solve_for_all_cells();
-
-  CoarseScaleOperator elliptic_msfem_op(problem, coarse_space, localgrid_list);
-  elliptic_msfem_op.apply_inverse(coarse_msfem_solution);
+  coarse_operator(problem, coarse_space, localgrid_list)->apply_inverse(coarse_msfem_solution);
 
   //! identify fine scale part of MsFEM solution (including the projection!)
   identify_fine_scale_part(problem, localgrid_list, coarse_msfem_solution, coarse_space, solution);
@@ -141,5 +198,36 @@ void Elliptic_MsFEM_Solver::apply(DMP::ProblemContainer& problem,
   solution->add(coarse_msfem_solution);
 }
 
+void Elliptic_MsFEM_Solver::apply(DMP::ProblemContainer& problem,
+                                  const CommonTraits::SpaceType& coarse_space,
+                                  const std::vector<CommonTraits::GdtVectorType>& load_vectors,
+                                  const std::set<std::size_t>& reconstruct,
+                                  std::vector<CommonTraits::GdtVectorType>& coarse_solutions,
+                                  std::map<std::size_t, std::unique_ptr<LocalsolutionProxy>>& solutions,
+                                  LocalGridList& localgrid_list) const
+{
+  Dune::XT::Common::ScopedTiming st("msfem.Elliptic_MsFEM_Solver.apply_batch");
+  const auto clearGuard = DiscreteFunctionIO::clear_guard();
+
+  const auto op = coarse_operator(problem, coarse_space, localgrid_list);
+  std::vector<CommonTraits::GdtVectorType> rhs;
+  rhs.reserve(load_vectors.size() + 1);
+  rhs.push_back(op->rhs());
+  rhs.insert(rhs.end(), load_vectors.begin(), load_vectors.end());
+  op->apply_inverse(rhs, coarse_solutions);
+  coarse_solutions[0] += op->dirichlet_projection();
+
+  solutions.clear();
+  for (const auto i : reconstruct) {
+    if (i >= coarse_solutions.size())
+      DUNE_THROW(InvalidStateException, "cannot reconstruct load case " << i << " of " << coarse_solutions.size());
+    CommonTraits::DiscreteFunctionType coarse_solution(coarse_space, "Coarse Part MsFEM Solution");
+    coarse_solution.vector() = coarse_solutions[i];
+    // the boundary correctors belong to the problem's boundary data, ie. to the first load case only
+    identify_fine_scale_part(problem, localgrid_list, coarse_solution, coarse_space, solutions[i], i == 0);
+    solutions[i]->add(coarse_solution);
+  }
+}
+
 } // namespace Multiscale {
 } // namespace Dune {
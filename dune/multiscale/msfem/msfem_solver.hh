@@ -8,6 +8,12 @@
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
 
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
 namespace Dune {
 namespace Multiscale {
 
@@ -17,17 +23,27 @@ struct ProblemContainer;
 
 class LocalGridList;
 class LocalsolutionProxy;
+class CoarseScaleOperator;
+class IncrementalMsFemSolver;
 
 //! \TODO needs a better name
 class Elliptic_MsFEM_Solver
 {
+  friend class IncrementalMsFemSolver;
+
 private:
   //! identify fine scale part of MsFEM solution (including the projection!)
   void identify_fine_scale_part(const DMP::ProblemContainer& problem,
                                 LocalGridList& localgrid_list,
                                 const CommonTraits::DiscreteFunctionType& coarse_msfem_solution,
                                 const CommonTraits::SpaceType& coarse_space,
-                                std::unique_ptr<LocalsolutionProxy>& msfem_solution) const;
+                                std::unique_ptr<LocalsolutionProxy>& msfem_solution,
+                                const bool boundary_correctors = true) const;
+
+  //! solves (or, see msfem.archive, loads) the local problems and assembles the coarse system
+  std::unique_ptr<CoarseScaleOperator> coarse_operator(const DMP::ProblemContainer& problem,
+                                                       const CommonTraits::SpaceType& coarse_space,
+                                                       LocalGridList& localgrid_list) const;
 
 public:
   /** - ∇ (A(x,∇u)) + b ∇u + c u = f - divG
@@ -42,6 +58,25 @@ public:
              const CommonTraits::SpaceType& coarse_space,
              std::unique_ptr<LocalsolutionProxy>& msfem_solution,
              LocalGridList& localgrid_list) const;
+
+  /** Solves for several load cases sharing the local problems, the coarse matrix and the coarse solver setup (see
+   * CoarseScaleOperator::apply_inverse).
+   *
+   * Load case 0 is the problem's own data, the others are given as coarse load vectors for zero Dirichlet values,
+   * eg. MsFEM source integrals assembled on coarse_space.
+   * \param reconstruct the load cases whose fine scale part is reconstructed. The boundary correctors belong to the
+   * problem's Dirichlet and Neumann data, they are only added for load case 0. The other load cases are
+   * reconstructed from their coarse parts alone, a Neumann flux passed as a load vector gets no Neumann corrector.
+   * \param[out] coarse_solutions the coarse parts of all load cases
+   * \param[out] solutions the full MsFEM solutions of the load cases in reconstruct
+   */
+  void apply(Problem::ProblemContainer& problem,
+             const CommonTraits::SpaceType& coarse_space,
+             const std::vector<CommonTraits::GdtVectorType>& load_vectors,
+             const std::set<std::size_t>& reconstruct,
+             std::vector<CommonTraits::GdtVectorType>& coarse_solutions,
+             std::map<std::size_t, std::unique_ptr<LocalsolutionProxy>>& solutions,
+             LocalGridList& localgrid_list) const;
 };
 
 } // namespace Multiscale {
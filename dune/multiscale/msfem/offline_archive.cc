@@ -0,0 +1,350 @@
+#include <config.h>
+
+#include "offline_archive.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/problems/selector.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/filesystem.hh>
+#include <dune/xt/common/logging.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/xt/common/timings.hh>
+
+#include <boost/format.hpp>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Dune {
+namespace Multiscale {
+
+//! bump whenever the layout changes, archives of other versions are rejected
+static const std::uint64_t archive_version = 2;
+static const char archive_magic[8] = {'D', 'M', 'S', 'A', 'R', 'C', 'H', '\0'};
+
+constexpr std::uint64_t OfflineArchive::matrix_key_;
+
+static boost::filesystem::path archive_path(const DMP::ProblemContainer& problem)
+{
+  const std::string default_path = problem.config().get("global.datadir", "data") + std::string("/msfem_archive");
+  const std::string path = problem.config().get("msfem.archive.path", default_path);
+  return (boost::format("%s_rank%d.bin") % path % MPIHelper::getCollectiveCommunication().rank()).str();
+}
+
+OfflineArchive::Mode OfflineArchive::mode(const DMP::ProblemContainer& problem)
+{
+  const std::string mode = problem.config().get("msfem.archive", "none");
+  if (mode == "none")
+    return Mode::none;
+  if (mode == "offline")
+    return Mode::offline;
+  if (mode == "online")
+    return Mode::online;
+  DUNE_THROW(InvalidStateException, "msfem.archive must be none, offline or online, not " << mode);
+}
+
+//! the top level values of the problem and grids subtrees, and the oversampling
+static std::string corrector_config(const DMP::ProblemContainer& problem)
+{
+  std::ostringstream config;
+  for (const std::string prefix : {"problem", "grids"}) {
+    if (!problem.config().has_sub(prefix))
+      continue;
+    const auto sub = problem.config().sub(prefix);
+    auto keys = sub.getValueKeys();
+    std::sort(keys.begin(), keys.end());
+    for (const auto& key : keys)
+      config << prefix << "." << key << " = " << sub.get<std::string>(key) << "\n";
+  }
+  config << "msfem.oversampling_layers = " << problem.config().get("msfem.oversampling_layers", 0) << "\n";
+  return config.str();
+}
+
+OfflineArchive::OfflineArchive(const DMP::ProblemContainer& problem,
+                               const CommonTraits::SpaceType& coarse_space,
+                               const LocalGridList& localgrid_list)
+  : mode_(mode(problem))
+  , path_(archive_path(problem))
+  , fd_(-1)
+  , end_(0)
+{
+  if (mode_ == Mode::none)
+    DUNE_THROW(InvalidStateException, "msfem.archive is not set");
+  const auto expected = metadata(problem, coarse_space, localgrid_list);
+  if (mode_ == Mode::online) {
+    open(expected);
+    return;
+  }
+
+  Dune::XT::Common::test_create_directory(path_.string());
+  fd_ = ::open(path_.string().c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+  if (fd_ < 0)
+    DUNE_THROW(IOError, "cannot create MsFEM archive " << path_.string() << ": " << std::strerror(errno));
+  write(archive_magic, sizeof(archive_magic));
+  write(expected.sizes.data(), sizeof(expected.sizes));
+  write(expected.corners.data(), sizeof(expected.corners));
+  for (const auto& text : {expected.problem_name, expected.config}) {
+    const std::uint64_t length = text.size();
+    write(&length, sizeof(length));
+    write(text.data(), length);
+  }
+}
+
+OfflineArchive::~OfflineArchive()
+{
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool OfflineArchive::online() const
+{
+  return mode_ == Mode::online;
+}
+
+std::uint64_t OfflineArchive::checksum(const DMP::DiffusionBase& diffusion,
+                                       const CommonTraits::SpaceType& coarse_space,
+                                       const LocalGridList& localgrid_list)
+{
+  std::size_t seed = 0;
+  CommonTraits::DiffusionFunctionBaseType::RangeType tensor;
+  const auto combine = [&](const CommonTraits::DomainType& point) {
+    diffusion.evaluate(point, tensor);
+    for (const auto& row : tensor)
+      for (const auto& value : row)
+        seed ^= std::hash<double>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  };
+  const auto& grid = coarse_space.grid_view().grid();
+  for (const auto& coarse_entity : Dune::elements(grid.leafGridView<InteriorBorder_Partition>())) {
+    const auto local_view = localgrid_list.getSubGrid(coarse_entity).leafGridView();
+    for (const auto& vertex : Dune::vertices(local_view))
+      combine(vertex.geometry().center());
+    for (const auto& entity : Dune::elements(local_view))
+      combine(entity.geometry().center());
+  }
+  return seed;
+}
+
+OfflineArchive::Metadata OfflineArchive::metadata(const DMP::ProblemContainer& problem,
+                                                  const CommonTraits::SpaceType& coarse_space,
+                                                  const LocalGridList& localgrid_list)
+{
+  const auto& grid = coarse_space.grid_view().grid();
+  const auto interior = grid.leafGridView<InteriorBorder_Partition>();
+  const auto num_cells = std::distance(interior.begin<0>(), interior.end<0>());
+
+  Metadata ret;
+  ret.sizes = {{archive_version,
+                std::uint64_t(CommonTraits::world_dim),
+                std::uint64_t(grid.comm().size()),
+                std::uint64_t(grid.comm().rank()),
+                std::uint64_t(coarse_space.mapper().size()),
+                std::uint64_t(num_cells),
+                checksum(problem.getDiffusion(), coarse_space, localgrid_list)}};
+  const auto corners = problem.getModelData().gridCorners();
+  for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+    ret.corners[i] = corners.first[i];
+    ret.corners[CommonTraits::world_dim + i] = corners.second[i];
+  }
+  ret.problem_name = problem.config().get("problem.name", "Synthetic");
+  ret.config = corrector_config(problem);
+  return ret;
+}
+
+void OfflineArchive::write_matrix(const CommonTraits::LinearOperatorType& matrix)
+{
+  assert(mode_ == Mode::offline);
+  std::vector<double> values;
+  const auto& backend = matrix.backend();
+  for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it)
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it)
+      values.push_back((*col_it)[0][0]);
+  const RecordHeaderType header{{matrix_tag, 0, 1, values.size()}};
+  write(header.data(), sizeof(header));
+  write(values.data(), values.size() * sizeof(double));
+}
+
+void OfflineArchive::write_correctors(const CommonTraits::SpaceType& coarse_space,
+                                      const LocalGridList& localgrid_list)
+{
+  assert(mode_ == Mode::offline);
+  Dune::XT::Common::ScopedTiming st("msfem.archive.write_correctors");
+  const auto& grid = coarse_space.grid_view().grid();
+  std::vector<double> values;
+  for (const auto& coarse_entity : Dune::elements(grid.leafGridView<InteriorBorder_Partition>())) {
+    LocalproblemSolutionManager manager(coarse_space, coarse_entity, localgrid_list);
+    manager.load();
+    const auto& solutions = manager.getLocalSolutions();
+    const std::size_t num_inner = solutions.size() - manager.numBoundaryCorrectors();
+    const std::size_t size = solutions[0]->vector().size();
+    values.resize(num_inner * size);
+    for (const auto i : Dune::XT::Common::value_range(num_inner)) {
+      const auto& b = solutions[i]->vector().backend();
+      std::copy(&b[0][0], &b[0][0] + size, values.begin() + i * size);
+    }
+    const RecordHeaderType header{{correctors_tag, grid.leafIndexSet().index(coarse_entity), num_inner, size}};
+    write(header.data(), sizeof(header));
+    write(values.data(), values.size() * sizeof(double));
+  }
+  MS_LOG_INFO << "Wrote " << end_ / (1024 * 1024) << " MiB to MsFEM archive " << path_.string() << std::endl;
+}
+
+void OfflineArchive::close()
+{
+  assert(mode_ == Mode::offline);
+  const RecordHeaderType header{{end_tag, 0, 0, 0}};
+  write(header.data(), sizeof(header));
+  if (::fsync(fd_) != 0 || ::close(fd_) != 0)
+    DUNE_THROW(IOError, "closing MsFEM archive " << path_.string() << " failed: " << std::strerror(errno));
+  fd_ = -1;
+}
+
+void OfflineArchive::read_matrix(CommonTraits::LinearOperatorType& matrix) const
+{
+  assert(mode_ == Mode::online);
+  const auto it = records_.find(matrix_key_);
+  if (it == records_.end())
+    DUNE_THROW(IOError, "MsFEM archive " << path_.string() << " has no coarse matrix");
+  RecordHeaderType header;
+  read(it->second, header.data(), sizeof(header));
+  std::vector<double> values(header[3]);
+  read(it->second + sizeof(header), values.data(), values.size() * sizeof(double));
+
+  auto& backend = matrix.backend();
+  std::size_t entry = 0;
+  for (auto row_it = backend.begin(); row_it != backend.end(); ++row_it)
+    for (auto col_it = row_it->begin(); col_it != row_it->end(); ++col_it, ++entry)
+      if (entry < values.size())
+        *col_it = values[entry];
+  if (entry != values.size())
+    DUNE_THROW(IOError, "coarse matrix in MsFEM archive has " << values.size() << " entries, pattern " << entry);
+}
+
+void OfflineArchive::read_correctors(const std::size_t coarse_index,
+                                     MsFEMTraits::LocalSolutionVectorType& solutions) const
+{
+  assert(mode_ == Mode::online);
+  const auto it = records_.find(coarse_index);
+  if (it == records_.end())
+    DUNE_THROW(IOError, "MsFEM archive " << path_.string() << " has no correctors for coarse cell " << coarse_index);
+  RecordHeaderType header;
+  read(it->second, header.data(), sizeof(header));
+  const auto num = header[2];
+  const auto size = header[3];
+  if (num > solutions.size() || size != solutions[0]->vector().size())
+    DUNE_THROW(IOError,
+               "MsFEM archive has " << num << " correctors with " << size << " DoFs for coarse cell " << coarse_index
+                                    << ", the local grid has " << solutions[0]->vector().size());
+  auto offset = it->second + sizeof(header);
+  for (const auto i : Dune::XT::Common::value_range(std::size_t(num))) {
+    auto& b = solutions[i]->vector().backend();
+    read(offset, &b[0][0], size * sizeof(double));
+    offset += size * sizeof(double);
+  }
+}
+
+void OfflineArchive::write(const void* data, const std::size_t bytes)
+{
+  const auto buffer = static_cast<const char*>(data);
+  std::size_t written = 0;
+  while (written < bytes) {
+    const auto ret = ::write(fd_, buffer + written, bytes - written);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      DUNE_THROW(IOError, "writing to MsFEM archive " << path_.string() << " failed: " << std::strerror(errno));
+    written += ret;
+  }
+  end_ += bytes;
+}
+
+void OfflineArchive::read(const std::uint64_t offset, void* data, const std::size_t bytes) const
+{
+  const auto buffer = static_cast<char*>(data);
+  std::size_t done = 0;
+  while (done < bytes) {
+    const auto ret = ::pread(fd_, buffer + done, bytes - done, offset + done);
+    if (ret < 0 && errno == EINTR)
+      continue;
+    if (ret <= 0)
+      DUNE_THROW(IOError, "MsFEM archive " << path_.string() << " is truncated or unreadable");
+    done += ret;
+  }
+}
+
+void OfflineArchive::open(const Metadata& expected)
+{
+  fd_ = ::open(path_.string().c_str(), O_RDONLY);
+  if (fd_ < 0)
+    DUNE_THROW(IOError, "cannot open MsFEM archive " << path_.string() << ": " << std::strerror(errno));
+
+  char magic[sizeof(archive_magic)];
+  Metadata stored;
+  read(0, magic, sizeof(magic));
+  if (!std::equal(magic, magic + sizeof(magic), archive_magic))
+    DUNE_THROW(IOError, path_.string() << " is not an MsFEM archive");
+  std::uint64_t offset = sizeof(magic);
+  read(offset, stored.sizes.data(), sizeof(stored.sizes));
+  offset += sizeof(stored.sizes);
+  if (stored.sizes[0] != archive_version)
+    DUNE_THROW(IOError,
+               "MsFEM archive " << path_.string() << " has version " << stored.sizes[0] << ", expected "
+                                << archive_version);
+  read(offset, stored.corners.data(), sizeof(stored.corners));
+  offset += sizeof(stored.corners);
+  for (auto text : {&stored.problem_name, &stored.config}) {
+    std::uint64_t length = 0;
+    read(offset, &length, sizeof(length));
+    offset += sizeof(length);
+    text->resize(length);
+    read(offset, &(*text)[0], length);
+    offset += length;
+  }
+
+  static const std::array<std::string, 7> size_names = {{"version",
+                                                         "dimension",
+                                                         "number of ranks",
+                                                         "rank",
+                                                         "number of coarse DoFs",
+                                                         "number of coarse cells",
+                                                         "diffusion checksum"}};
+  for (const auto i : Dune::XT::Common::value_range(stored.sizes.size()))
+    if (stored.sizes[i] != expected.sizes[i])
+      DUNE_THROW(IOError,
+                 "MsFEM archive " << path_.string() << " was written for a different " << size_names[i] << " ("
+                                  << stored.sizes[i] << " instead of " << expected.sizes[i] << ")");
+  if (stored.corners != expected.corners || stored.problem_name != expected.problem_name)
+    DUNE_THROW(IOError, "MsFEM archive " << path_.string() << " was written for a different problem or domain");
+  if (stored.config != expected.config)
+    DUNE_THROW(IOError,
+               "MsFEM archive " << path_.string() << " was written for a different configuration:\n"
+                                << stored.config << "instead of\n"
+                                << expected.config);
+
+  // index all records, only an archive with end mark is complete
+  for (;;) {
+    RecordHeaderType header;
+    read(offset, header.data(), sizeof(header));
+    if (header[0] == end_tag)
+      break;
+    if (header[0] != matrix_tag && header[0] != correctors_tag)
+      DUNE_THROW(IOError, "corrupt record in MsFEM archive " << path_.string());
+    records_[header[0] == matrix_tag ? matrix_key_ : header[1]] = offset;
+    offset += sizeof(header) + header[2] * header[3] * sizeof(double);
+  }
+  MS_LOG_INFO << "Opened MsFEM archive " << path_.string() << " with correctors for "
+              << records_.size() - records_.count(matrix_key_) << " coarse cells" << std::endl;
+}
+
+} // namespace Multiscale {
+} // namespace Dune {
@@ -0,0 +1,124 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_MSFEM_OFFLINE_ARCHIVE_HH
+#define DUNE_MULTISCALE_MSFEM_OFFLINE_ARCHIVE_HH
+
+#include <dune/multiscale/common/traits.hh>
+#include <dune/multiscale/msfem/msfem_traits.hh>
+
+#include <boost/filesystem/path.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace Dune {
+namespace Multiscale {
+
+class LocalGridList;
+
+namespace Problem {
+struct ProblemContainer;
+}
+
+/**
+ * \brief per-rank binary archive of the data-independent part of an MsFEM discretization
+ *
+ * The inner correctors and the coarse stiffness matrix (before the Dirichlet constraints are applied) only depend on
+ * the grids and the diffusion. With msfem.archive = offline they are written to
+ * msfem.archive.path_rank<rank>.bin (default path global.datadir/msfem_archive) while solving normally. A later run
+ * with msfem.archive = online reads them back: no inner local problems are solved and the coarse matrix is not
+ * assembled, only the boundary correctors and the coarse right hand side are computed for the current source,
+ * Dirichlet and Neumann data. The grids are still created, the correctors live on them.
+ *
+ * The archive starts with a format version and metadata that an online run has to match: problem name, domain,
+ * dimension, number of ranks, coarse cells and DoFs, the problem.* and grids.* values and the oversampling, and a
+ * checksum of the diffusion in the vertices and element centers of all local grids. Subtrees like
+ * problem.boundaryInfo only enter the right hand side and may change. The metadata is followed by one record per
+ * coarse cell and one for the matrix. Data is stored in native byte order.
+ */
+class OfflineArchive : public boost::noncopyable
+{
+public:
+  enum class Mode
+  {
+    none,
+    offline,
+    online
+  };
+
+  //! msfem.archive: none (default), offline or online
+  static Mode mode(const DMP::ProblemContainer& problem);
+
+  /** Creates the archive for Mode::offline, opens and validates it for Mode::online.
+   * \throws Dune::IOError if the file cannot be created or read, or does not match the problem
+   */
+  OfflineArchive(const DMP::ProblemContainer& problem,
+                 const CommonTraits::SpaceType& coarse_space,
+                 const LocalGridList& localgrid_list);
+  ~OfflineArchive();
+
+  //! hash of diffusion in the vertices and element centers of the local grids of all interior coarse cells
+  static std::uint64_t checksum(const DMP::DiffusionBase& diffusion,
+                                const CommonTraits::SpaceType& coarse_space,
+                                const LocalGridList& localgrid_list);
+
+  bool online() const;
+
+  //! offline: appends the unconstrained coarse stiffness matrix
+  void write_matrix(const CommonTraits::LinearOperatorType& matrix);
+  //! offline: appends the inner correctors of all interior coarse cells, as stored in DiscreteFunctionIO
+  void write_correctors(const CommonTraits::SpaceType& coarse_space, const LocalGridList& localgrid_list);
+  //! offline: marks the archive complete, an online run rejects archives without the mark
+  void close();
+
+  //! online: the values of matrix, which has to have the coarse operator's pattern. Thread safe.
+  void read_matrix(CommonTraits::LinearOperatorType& matrix) const;
+  //! online: the inner correctors of coarse_index into the leading entries of solutions. Thread safe.
+  void read_correctors(const std::size_t coarse_index, MsFEMTraits::LocalSolutionVectorType& solutions) const;
+
+private:
+  //! tag, coarse index (correctors only), number of vectors, entries per vector
+  typedef std::array<std::uint64_t, 4> RecordHeaderType;
+  enum RecordTag : std::uint64_t
+  {
+    end_tag = 1,
+    matrix_tag = 2,
+    correctors_tag = 3
+  };
+
+  struct Metadata
+  {
+    std::array<std::uint64_t, 7> sizes;
+    std::array<double, 2 * CommonTraits::world_dim> corners;
+    std::string problem_name;
+    //! the configuration values the correctors depend on, one "key = value" line each
+    std::string config;
+  };
+
+  static Metadata metadata(const DMP::ProblemContainer& problem,
+                           const CommonTraits::SpaceType& coarse_space,
+                           const LocalGridList& localgrid_list);
+
+  void write(const void* data, const std::size_t bytes);
+  void read(const std::uint64_t offset, void* data, const std::size_t bytes) const;
+  //! reads and checks the metadata, indexes all records
+  void open(const Metadata& expected);
+
+  const Mode mode_;
+  const boost::filesystem::path path_;
+  int fd_;
+  std::uint64_t end_;
+  //! offset of each record's header, by coarse index. The matrix record is keyed with matrix_key_
+  std::map<std::uint64_t, std::uint64_t> records_;
+  static constexpr std::uint64_t matrix_key_ = std::uint64_t(-1);
+};
+
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_MSFEM_OFFLINE_ARCHIVE_HH
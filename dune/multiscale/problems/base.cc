@@ -1,2 +1,42 @@
 #include <config.h>
 #include "base.hh"
+
+#include <cassert>
+
+namespace Dune {
+namespace Multiscale {
+namespace Problem {
+
+void DiffusionBase::evaluate_batch(const std::vector<DomainType>& x,
+                                   std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType>& y) const
+{
+  y.resize(x.size());
+  for (std::size_t i = 0; i < x.size(); ++i)
+    evaluate(x[i], y[i]);
+}
+
+void DiffusionBase::diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                        const std::vector<Problem::JacobianRangeType>& directions,
+                                        std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  assert(directions.size() == x.size());
+  fluxes.resize(x.size());
+  for (std::size_t i = 0; i < x.size(); ++i)
+    diffusiveFlux(x[i], directions[i], fluxes[i]);
+}
+
+void DiffusionBase::linear_diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                               const std::vector<Problem::JacobianRangeType>& directions,
+                                               std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  assert(directions.size() == x.size());
+  std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType> tensors;
+  evaluate_batch(x, tensors);
+  fluxes.resize(x.size());
+  for (std::size_t i = 0; i < x.size(); ++i)
+    tensors[i].mv(directions[i][0], fluxes[i][0]);
+}
+
+} // namespace Problem
+} // namespace Multiscale {
+} // namespace Dune {
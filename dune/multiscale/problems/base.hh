@@ -8,6 +8,7 @@
 #include <dune/common/parallel/mpihelper.hh>
 #include <dune/multiscale/common/traits.hh>
 #include <dune/multiscale/msfem/msfem_traits.hh>
+#include <dune/multiscale/problems/tensor_structure.hh>
 #include <dune/stuff/functions/constant.hh>
 #include <dune/stuff/functions/interfaces.hh>
 #include <dune/stuff/grid/boundaryinfo.hh>
@@ -15,6 +16,7 @@
 #include <dune/xt/common/memory.hh>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace Dune {
 namespace Multiscale {
@@ -36,6 +38,13 @@ typedef CommonTraits::FunctionBaseType ExactSolutionType;
 
 struct DiffusionBase : public CommonTraits::DiffusionFunctionBaseType
 {
+  /** which entries of the tensors from evaluate can be non-zero. Coefficients with diagonal or isotropic tensors
+   * override this, kernels switch on it once per entity and keep CompactTensor instances instead of full matrices.
+   **/
+  virtual TensorStructure structure() const
+  {
+    return TensorStructure::full;
+  }
 
   //! currently used in gdt assembler
   virtual void evaluate(const DomainType& x, CommonTraits::DiffusionFunctionBaseType::RangeType& y) const = 0;
@@ -52,6 +61,18 @@ struct DiffusionBase : public CommonTraits::DiffusionFunctionBaseType
                              const Problem::JacobianRangeType& direction,
                              Problem::JacobianRangeType& flux) const = 0;
 
+  /** Tensors in all points x at once, y is resized to x.size(). Quadrature loops should prefer this to evaluate:
+   * it is one virtual call per entity instead of per point, and coefficients override it with loops that the
+   * compiler can vectorize. The default calls evaluate for each point.
+   **/
+  virtual void evaluate_batch(const std::vector<DomainType>& x,
+                              std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType>& y) const;
+
+  //! diffusiveFlux for the pairs (x[i], directions[i]), fluxes is resized to x.size(). Defaults to diffusiveFlux
+  virtual void diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                   const std::vector<Problem::JacobianRangeType>& directions,
+                                   std::vector<Problem::JacobianRangeType>& fluxes) const;
+
   virtual size_t order() const
   {
     return 2;
@@ -66,6 +87,14 @@ struct DiffusionBase : public CommonTraits::DiffusionFunctionBaseType
   virtual void prepare_new_evaluation()
   {
   }
+
+protected:
+  /** diffusiveFlux_batch for linear coefficients, flux = A(x) * direction with A from one evaluate_batch call.
+   * Each tensor is used once, kernels that apply it to several directions should call evaluate_batch themselves.
+   **/
+  void linear_diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                  const std::vector<Problem::JacobianRangeType>& directions,
+                                  std::vector<Problem::JacobianRangeType>& fluxes) const;
 };
 
 typedef DiffusionBase::Transfer<MsFEMTraits::LocalEntityType>::Type LocalDiffusionType;
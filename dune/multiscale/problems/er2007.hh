@@ -83,6 +83,11 @@ public:
                      const Problem::JacobianRangeType& direction,
                      Problem::JacobianRangeType& flux) const final override;
   void evaluate(const DomainType& x, RangeType& y) const final override;
+
+  TensorStructure structure() const final override
+  {
+    return TensorStructure::isotropic;
+  }
 };
 
 MSEXPRESSIONFUNCTION(Source, "64*pi*pi*(cos(8.0*pi*x[0])+cos(8.0*pi*x[1]))", 3, exact_deriv)
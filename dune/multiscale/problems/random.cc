@@ -154,6 +154,30 @@ PURE HOT void Diffusion::diffusiveFlux(const DomainType& x,
 
 } // diffusiveFlux
 
+void Diffusion::evaluate_batch(const std::vector<DomainType>& x, std::vector<Diffusion::RangeType>& y) const
+{
+#if HAVE_FFTW
+  assert(field_);
+  std::vector<double> scalars;
+  field_->evaluate(x, scalars);
+  y.resize(x.size());
+  for (std::size_t n = 0; n < x.size(); ++n) {
+    y[n] = 0;
+    for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+      y[n][i][i] = scalars[n];
+  }
+#else
+  DUNE_THROW(InvalidStateException, "random problem needs additional libs to be configured properly");
+#endif
+}
+
+void Diffusion::diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                    const std::vector<Problem::JacobianRangeType>& directions,
+                                    std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  linear_diffusiveFlux_batch(x, directions, fluxes);
+}
+
 size_t Diffusion::order() const
 {
   return 1;
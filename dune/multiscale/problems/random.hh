@@ -9,6 +9,7 @@
 #include <dune/stuff/grid/boundaryinfo.hh>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "dune/multiscale/common/traits.hh"
 
@@ -121,6 +122,16 @@ public:
   PURE HOT void diffusiveFlux(const DomainType& x,
                               const Problem::JacobianRangeType& direction,
                               Problem::JacobianRangeType& flux) const final override;
+  void evaluate_batch(const std::vector<DomainType>& x,
+                      std::vector<DiffusionBase::RangeType>& y) const final override;
+  void diffusiveFlux_batch(const std::vector<DomainType>& x,
+                           const std::vector<Problem::JacobianRangeType>& directions,
+                           std::vector<Problem::JacobianRangeType>& fluxes) const final override;
+
+  TensorStructure structure() const final override
+  {
+    return TensorStructure::isotropic;
+  }
 
   virtual size_t order() const final override;
 
@@ -326,49 +326,77 @@ public:
   /// \return permeability at x
   R operator()(const X& x) const
   {
-    int cell = 0;
     double t[DIM];
-    double k;
+    const int cell = locate(x, t);
+    return interpolate(cell, t);
+  }
+
+  /// Evaluate permeability field in several positions, same values as operator().
+  /// Cell lookup and interpolation are done in separate loops over all positions.
+  /// \param x positions
+  /// \param k permeability at each position, resized to x.size()
+  void evaluate(const std::vector<X>& x, std::vector<R>& k) const
+  {
+    const std::size_t count = x.size();
+    std::vector<int> cells(count);
+    std::vector<double> t(DIM * count);
+    for (std::size_t n = 0; n < count; ++n)
+      cells[n] = locate(x[n], &t[DIM * n]);
+    k.resize(count);
+    for (std::size_t n = 0; n < count; ++n)
+      k[n] = interpolate(cells[n], &t[DIM * n]);
+  }
+
+private:
+  /// Find the subgrid cell containing x.
+  /// \param x position
+  /// \param t local coordinates of x in the cell, DIM values
+  /// \return lexicographic index of the cell's lowest node
+  int locate(const X& x, double* t) const
+  {
+    int cell = 0;
     for (int i = 0; i < DIM; ++i) {
       double p = x[i] * _N;
       if (p < _iMin[i] || p > _iMax[i])
         DUNE_THROW(Dune::RangeError, "Coordinate p " << p << " OOB: min " << _iMin[i] << " max " << _iMax[i] << "\n");
       p -= _iMin[i];
-      int j = floor(p);
+      const int j = floor(p);
       t[i] = p - j;
       cell = _size[i] * cell + j;
     }
+    return cell;
+  }
+
+  /// Multilinear interpolation of the permeability in a cell.
+  /// \param cell index as returned by locate
+  /// \param t local coordinates as returned by locate
+  /// \return permeability, at least the minimal one
+  inline R interpolate(const int cell, const double* t) const
+  {
+    double k;
     if (DIM == 2) {
-      int c00 = cell;
-      int c01 = c00 + 1;
-      int c10 = c00 + _size[1];
-      int c11 = c10 + 1;
-      k = ((1 - t[1]) * _perm[c00][_part] + t[1] * _perm[c01][_part]) * (1 - t[0])
-          + ((1 - t[1]) * _perm[c10][_part] + t[1] * _perm[c11][_part]) * t[0];
+      const int c00 = cell;
+      const int c10 = c00 + _size[1];
+      const double k0 = (1 - t[1]) * _perm[c00][_part] + t[1] * _perm[c00 + 1][_part];
+      const double k1 = (1 - t[1]) * _perm[c10][_part] + t[1] * _perm[c10 + 1][_part];
+      k = k0 * (1 - t[0]) + k1 * t[0];
     } else if (DIM == 3) {
-      int c000 = cell;
-      int c001 = c000 + 1;
-      int c010 = c000 + _size[2];
-      int c011 = c010 + 1;
-      int c100 = c000 + _size[1] * _size[2];
-      int c101 = c100 + 1;
-      int c110 = c100 + _size[2];
-      int c111 = c110 + 1;
-      k = (((1 - t[2]) * _perm[c000][_part] + t[2] * _perm[c001][_part]) * (1 - t[1])
-           + ((1 - t[2]) * _perm[c010][_part] + t[2] * _perm[c011][_part]) * t[1])
-              * (1 - t[0])
-          + (((1 - t[2]) * _perm[c100][_part] + t[2] * _perm[c101][_part]) * (1 - t[1])
-             + ((1 - t[2]) * _perm[c110][_part] + t[2] * _perm[c111][_part]) * t[1])
-                * t[0];
+      const int c000 = cell;
+      const int c010 = c000 + _size[2];
+      const int c100 = c000 + _size[1] * _size[2];
+      const int c110 = c100 + _size[2];
+      const double k00 = (1 - t[2]) * _perm[c000][_part] + t[2] * _perm[c000 + 1][_part];
+      const double k01 = (1 - t[2]) * _perm[c010][_part] + t[2] * _perm[c010 + 1][_part];
+      const double k10 = (1 - t[2]) * _perm[c100][_part] + t[2] * _perm[c100 + 1][_part];
+      const double k11 = (1 - t[2]) * _perm[c110][_part] + t[2] * _perm[c110 + 1][_part];
+      k = (k00 * (1 - t[1]) + k01 * t[1]) * (1 - t[0]) + (k10 * (1 - t[1]) + k11 * t[1]) * t[0];
     } else {
-      std::cerr << "Not implemented, yet.\n";
-      exit(1);
+      DUNE_THROW(Dune::NotImplemented, "Only dimensions 2 and 3 are implemented.");
     }
     return std::max(k, _minimal);
   }
 
   //--- Members ------------------------------------------------------------
-private:
   int _iProc; ///< index of processor
   int _nProc; ///< total number of processors
   int _overlap; ///< overlap of subgrids
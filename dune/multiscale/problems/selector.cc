@@ -4,9 +4,11 @@
 #include <dune/xt/common/misc.hh>
 #include <dune/xt/common/parallel/threadstorage.hh>
 
+#include <cassert>
 #include <functional>
 #include <map>
 #include <unordered_map>
+#include <utility>
 
 #include "dune/multiscale/problems/base.hh"
 // for i in $(ls *hh) ; do echo \#include \"${i}\" ; done
@@ -148,6 +150,14 @@ Problem::DiffusionBase& DMP::ProblemContainer::getMutableDiffusion()
   return const_cast<Problem::DiffusionBase&>(diffusion);
 }
 
+std::unique_ptr<Problem::DiffusionBase>
+DMP::ProblemContainer::exchangeDiffusion(std::unique_ptr<Problem::DiffusionBase> diffusion)
+{
+  assert(diffusion);
+  std::swap(diffusion, diffusion_);
+  return diffusion;
+}
+
 const Problem::DirichletDataBase& DMP::ProblemContainer::getDirichletData() const
 {
   return *dirichlet_;
@@ -21,6 +21,13 @@ class Intersection;
 namespace Multiscale {
 namespace Problem {
 
+/** \brief the data of the problem named by problem.name
+ *
+ * With problem.permeability_shared the SPE10 and Tarbert diffusions evaluate from an MPI shared memory window (see
+ * VoxelPermeability::read). Creating and destroying the container is then collective on the global communicator: all
+ * ranks have to destroy it at the same point, a rank that keeps its container while the others wait elsewhere
+ * deadlocks them.
+ */
 struct ProblemContainer
 {
   ProblemContainer(MPIHelper::MPICommunicator global,
@@ -32,6 +39,8 @@ struct ProblemContainer
   const CommonTraits::FunctionBaseType& getExactSolution() const;
   const DiffusionBase& getDiffusion() const;
   DiffusionBase& getMutableDiffusion();
+  //! replaces the diffusion, eg. by one with local changes for IncrementalMsFemSolver::update. \return the previous one
+  std::unique_ptr<DiffusionBase> exchangeDiffusion(std::unique_ptr<DiffusionBase> diffusion);
   const IModelProblemData& getModelData() const;
   IModelProblemData& getMutableModelData();
   const DirichletDataBase& getDirichletData() const;
@@ -48,7 +57,7 @@ private:
   const std::unique_ptr<Problem::IModelProblemData> data_;
   const std::unique_ptr<const CommonTraits::FunctionBaseType> source_;
   const std::unique_ptr<const CommonTraits::FunctionBaseType> exact_solution_;
-  const std::unique_ptr<Problem::DiffusionBase> diffusion_;
+  std::unique_ptr<Problem::DiffusionBase> diffusion_;
   const std::unique_ptr<const Problem::DirichletDataBase> dirichlet_;
   const std::unique_ptr<const Problem::NeumannDataBase> neumann_;
 }; // struct ProblemContainer {
@@ -4,10 +4,14 @@
 #include <dune/xt/common/logging.hh>
 #include <dune/xt/common/validation.hh>
 #include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/memory.hh>
+#include <array>
+#include <cmath>
 #include <sstream>
 
 #include "dune/multiscale/problems/base.hh"
 #include "spe10.hh"
+#include "voxel_field.hh"
 
 namespace Dune {
 namespace Multiscale {
@@ -119,12 +123,12 @@ void __attribute__((hot)) Source::evaluate(const DomainType& /*x*/, RangeType& y
   y = typename CommonTraits::RangeType(0.0);
 } // evaluate
 
-Diffusion::Diffusion(MPIHelper::MPICommunicator /*global*/,
+Diffusion::Diffusion(MPIHelper::MPICommunicator global,
                      MPIHelper::MPICommunicator /*local*/,
-                     Dune::XT::Common::Configuration /*config_in*/)
-  : permeability_(nullptr)
+                     Dune::XT::Common::Configuration config_in)
+  : field_(nullptr)
 {
-  readPermeability();
+  readPermeability(config_in, global);
 }
 
 Diffusion::~Diffusion()
@@ -135,7 +139,7 @@ void Diffusion::evaluate(const DomainType& x, Diffusion::RangeType& y) const
 {
   BOOST_ASSERT_MSG(x.size() == 3, "SPE 10 model is only defined for three dimensions!");
   // TODO this class does not seem to work in 2D, when changing 'spe10.dgf' to a 2D grid?
-  if (!permeability_) {
+  if (!field_) {
     MS_LOG_ERROR_0 << "The SPE10-permeability data file could not be opened. This file does\n"
                    << "not come with the dune-multiscale repository due to file size. To download it\n"
                    << "execute\n"
@@ -144,35 +148,7 @@ void Diffusion::evaluate(const DomainType& x, Diffusion::RangeType& y) const
                    << "dune-multiscale/dune/multiscale/problems/spe10_permeability.dat!\n";
     DUNE_THROW(IOError, "Data file for Groundwaterflow permeability could not be opened!");
   }
-  // 3 is the maximum space dimension
-
-  const auto center = x;
-  std::vector<size_t> whichPartition(dimDomain, 0);
-  const Dune::XT::Common::FieldVector<CommonTraits::DomainFieldType, CommonTraits::world_dim> ll =
-      default_config().get<CommonTraits::DomainType>("lower_left");
-  const Dune::XT::Common::FieldVector<CommonTraits::DomainFieldType, CommonTraits::world_dim> ur =
-      default_config().get<CommonTraits::DomainType>("upper_right");
-  // code need to compile, not run, for dim 2, therefore hardcode to 3 elements
-  std::array<size_t, 3> ne{{model2_x_elements, model2_y_elements, model2_z_elements}};
-
-  for (size_t dd = 0; dd < dimDomain; ++dd) {
-    // for points that are on upperRight_[d], this selects one partition too much
-    // so we need to cap this
-    whichPartition[dd] = std::min(size_t(std::floor(ne[dd] * ((center[dd] - ll[dd]) / (ur[dd] - ll[dd])))), ne[dd] - 1);
-  }
-  size_t subdomain = 0;
-  if (dimDomain == 1)
-    subdomain = whichPartition[0];
-  else if (dimDomain == 2)
-    subdomain = whichPartition[0] + whichPartition[1] * ne[0];
-  else
-    subdomain = whichPartition[0] + whichPartition[1] * ne[0] + whichPartition[2] * ne[1] * ne[0];
-  const auto ii = subdomain;
-  const size_t entries_per_dim = model2_x_elements * model2_y_elements * model2_z_elements;
-  const bool anisotropic = true;
-  y[0][0] = permeability_[ii];
-  y[1][1] = permeability_[anisotropic ? entries_per_dim + ii : ii];
-  y[2][2] = permeability_[anisotropic ? 2 * entries_per_dim + ii : ii];
+  field_->evaluate(x, y);
 }
 
 void Diffusion::diffusiveFlux(const DomainType& x,
@@ -184,33 +160,45 @@ void Diffusion::diffusiveFlux(const DomainType& x,
   eval_tmp.mv(direction[0], flux[0]);
 } // diffusiveFlux
 
-void Diffusion::readPermeability()
+void Diffusion::evaluate_batch(const std::vector<DomainType>& x, std::vector<Diffusion::RangeType>& y) const
 {
-  auto min = default_config().get<RangeFieldType>("min");
-  auto max = default_config().get<RangeFieldType>("max");
-  std::ifstream datafile(model2_filename);
-  if (!datafile.is_open())
-    DUNE_THROW(spe10_model2_data_file_missing, "could not open '" << model2_filename << "'!");
+  if (!field_)
+    DUNE_THROW(IOError, "Data file for Groundwaterflow permeability could not be opened!");
+  field_->evaluate_batch(x, y);
+}
+
+void Diffusion::diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                    const std::vector<Problem::JacobianRangeType>& directions,
+                                    std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  linear_diffusiveFlux_batch(x, directions, fluxes);
+}
+
+void Diffusion::readPermeability(const Dune::XT::Common::Configuration& config_in,
+                                 MPIHelper::MPICommunicator global)
+{
+  const auto config = default_config();
+  auto min = config.get<RangeFieldType>("min");
+  auto max = config.get<RangeFieldType>("max");
   if (!(max > min))
     DUNE_THROW(Dune::RangeError, "max (is " << max << ") has to be larger than min (is " << min << ")!");
   const RangeFieldType scale = (max - min) / (model_2_max_value - model_2_min_value);
   const RangeFieldType shift = min - scale * model_2_min_value;
-  // read all the data from the file
-  const size_t entries_per_dim = model2_x_elements * model2_y_elements * model2_z_elements;
-  //  std::vector< double > data(3*entries_per_dim);
-  const size_t data_size = 3 * entries_per_dim;
-  permeability_ = std::unique_ptr<double[]>(new double[data_size]());
-  double tmp = 0;
-  size_t counter = 0;
-  while (datafile >> tmp) {
-    permeability_[counter++] = (tmp * scale) + shift;
+
+  // the data is scaled to the domain of default_config
+  const std::array<std::size_t, 3> cells{{model2_x_elements, model2_y_elements, model2_z_elements}};
+  const auto ll = config.get<CommonTraits::DomainType>("lower_left");
+  const auto ur = config.get<CommonTraits::DomainType>("upper_right");
+  std::array<double, 3> lower_left{{0, 0, 0}};
+  std::array<double, 3> widths{{1, 1, 1}};
+  for (size_t dd = 0; dd < dimDomain && dd < 3; ++dd) {
+    lower_left[dd] = ll[dd];
+    widths[dd] = (ur[dd] - ll[dd]) / cells[dd];
   }
-  datafile.close();
-  if (counter != data_size)
-    DUNE_THROW(Dune::IOError,
-               "wrong number of entries in '" << model2_filename << "' (are " << counter << ", should be " << data_size
-                                              << ")!");
-  return;
+  // parses the text file only if there is no binary image of it yet
+  field_ = VoxelPermeability::read(model2_filename, cells, lower_left, widths, scale, shift, config_in, global);
+  if (!field_)
+    DUNE_THROW(spe10_model2_data_file_missing, "could not open '" << model2_filename << "'!");
 } /* readPermeability */
 
 } // namespace SPE10
@@ -7,6 +7,7 @@
 
 #include <dune/multiscale/problems/base.hh>
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -15,6 +16,9 @@
 namespace Dune {
 namespace Multiscale {
 namespace Problem {
+
+class VoxelPermeability;
+
 /** \addtogroup problem_spe10 Problem::SPE10
  * @{ **/
 //! ------------ SPE10 Problem -------------------
@@ -65,7 +69,7 @@ class Diffusion : public DiffusionBase
 public:
   Diffusion(MPIHelper::MPICommunicator /*global*/,
             MPIHelper::MPICommunicator /*local*/,
-            Dune::XT::Common::Configuration /*config_in*/);
+            Dune::XT::Common::Configuration config_in);
   ~Diffusion();
 
   //! currently used in gdt assembler
@@ -74,10 +78,21 @@ public:
   void diffusiveFlux(const DomainType& x,
                      const Problem::JacobianRangeType& direction,
                      Problem::JacobianRangeType& flux) const final override;
+  void evaluate_batch(const std::vector<DomainType>& x,
+                      std::vector<DiffusionBase::RangeType>& y) const final override;
+  void diffusiveFlux_batch(const std::vector<DomainType>& x,
+                           const std::vector<Problem::JacobianRangeType>& directions,
+                           std::vector<Problem::JacobianRangeType>& fluxes) const final override;
+
+  TensorStructure structure() const final override
+  {
+    return TensorStructure::diagonal;
+  }
 
 private:
-  void readPermeability();
-  std::unique_ptr<double[]> permeability_;
+  //! collective on global with problem.permeability_shared
+  void readPermeability(const Dune::XT::Common::Configuration& config_in, MPIHelper::MPICommunicator global);
+  std::unique_ptr<const VoxelPermeability> field_;
 };
 
 class DirichletData : public DirichletDataBase
@@ -139,6 +139,32 @@ PURE HOT void Diffusion::diffusiveFlux(const DomainType& x,
   flux[0][1] = eval[1][1] * direction[0][1];
 } // diffusiveFlux
 
+void Diffusion::evaluate_batch(const std::vector<DomainType>& x, std::vector<Diffusion::RangeType>& y) const
+{
+  const auto count = x.size();
+  // plain arrays and branch free loops, so the cosine can use the vectorized libm variants
+  // same operations as evaluate, results are identical
+  std::vector<double> cos_eval(count);
+  for (std::size_t i = 0; i < count; ++i)
+    cos_eval[i] = x[i][0] / epsilon_;
+  for (std::size_t i = 0; i < count; ++i)
+    cos_eval[i] = cos(M_TWOPI * cos_eval[i]);
+  constexpr double inv_pi8pi = 1. / (8.0 * M_PI * M_PI);
+  y.resize(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    y[i] = 0;
+    y[i][0][0] = 2.0 * inv_pi8pi * (1.0 / (2.0 + cos_eval[i]));
+    y[i][1][1] = inv_pi8pi * (1.0 + (0.5 * cos_eval[i]));
+  }
+}
+
+void Diffusion::diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                    const std::vector<Problem::JacobianRangeType>& directions,
+                                    std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  linear_diffusiveFlux_batch(x, directions, fluxes);
+}
+
 size_t Diffusion::order() const
 {
   return 2;
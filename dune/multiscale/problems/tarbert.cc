@@ -4,10 +4,14 @@
 #include <dune/xt/common/logging.hh>
 #include <dune/xt/common/validation.hh>
 #include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/memory.hh>
+#include <array>
+#include <cmath>
 #include <sstream>
 
 #include "dune/multiscale/problems/base.hh"
 #include "tarbert.hh"
+#include "voxel_field.hh"
 
 namespace Dune {
 namespace Multiscale {
@@ -103,27 +107,23 @@ void __attribute__((hot)) Source::evaluate(const DomainType& /*x*/, RangeType& y
   y = typename CommonTraits::RangeType(0.0);
 } // evaluate
 
-Diffusion::Diffusion(MPIHelper::MPICommunicator /*global*/,
+Diffusion::Diffusion(MPIHelper::MPICommunicator global,
                      MPIHelper::MPICommunicator /*local*/,
-                     Dune::XT::Common::Configuration /*config_in*/)
-  : deltas_{6.096, 3.048, 0.6096}
-  , permeability_(nullptr)
-  , permMatrix_(0.0)
+                     Dune::XT::Common::Configuration config_in)
+  : field_(nullptr)
 {
-  readPermeability();
+  readPermeability(config_in, global);
 }
 
 Diffusion::~Diffusion()
 {
-  delete permeability_;
-  permeability_ = nullptr;
 }
 
 void Diffusion::evaluate(const DomainType& x, Diffusion::RangeType& y) const
 {
   BOOST_ASSERT_MSG(x.size() <= 3, "SPE 10 model is only defined for up to three dimensions!");
   // TODO this class does not seem to work in 2D, when changing 'spe10.dgf' to a 2D grid?
-  if (!permeability_) {
+  if (!field_) {
     MS_LOG_ERROR_0 << "The SPE10-permeability data file could not be opened. This file does\n"
                    << "not come with the dune-multiscale repository due to file size. To download it\n"
                    << "execute\n"
@@ -132,28 +132,9 @@ void Diffusion::evaluate(const DomainType& x, Diffusion::RangeType& y) const
                    << "dune-multiscale/dune/multiscale/problems/elliptic/spe10_permeability.dat!\n";
     DUNE_THROW(IOError, "Data file for Groundwaterflow permeability could not be opened!");
   }
-  // 3 is the maximum space dimension
-  for (int dim = 0; dim < DomainType::dimension; ++dim)
-    permIntervalls_[dim] = std::floor(x[dim] / deltas_[dim]);
-
-  int offset = 0;
-  switch (DomainType::dimension) {
-    case 1:
-      DUNE_THROW(NotImplemented, "SPE10 is not implemented for 1D!");
-    case 2:
-      offset = permIntervalls_[0] + permIntervalls_[1] * 60;
-      permMatrix_[0][0] = permeability_[offset];
-      permMatrix_[1][1] = permeability_[offset + 1122000];
-      break;
-    case 3:
-      offset = permIntervalls_[0] + permIntervalls_[1] * 60 + permIntervalls_[2] * 220 * 60;
-      permMatrix_[0][0] = permeability_[offset];
-      permMatrix_[1][1] = permeability_[offset + 1122000];
-      permMatrix_[2][2] = permeability_[offset + 2244000];
-      break;
-  }
-
-  y = permMatrix_;
+  if (DomainType::dimension == 1)
+    DUNE_THROW(NotImplemented, "SPE10 is not implemented for 1D!");
+  field_->evaluate(x, y);
 }
 
 void Diffusion::diffusiveFlux(const DomainType& x,
@@ -165,24 +146,35 @@ void Diffusion::diffusiveFlux(const DomainType& x,
   eval_tmp.mv(direction[0], flux[0]);
 } // diffusiveFlux
 
-void Diffusion::readPermeability()
+void Diffusion::evaluate_batch(const std::vector<DomainType>& x, std::vector<Diffusion::RangeType>& y) const
 {
-  std::string filename = "../dune/multiscale/problems/elliptic/spe10_permeability.dat";
-  std::ifstream file(filename.c_str());
-  double val;
-  if (!file) { // file couldn't be opened
-    return;
-  }
-  file >> val;
-  int counter = 0;
-  permeability_ = new double[3366000];
-  while (!file.eof()) {
-    // keep reading until end-of-file
-    permeability_[counter++] = val;
-    file >> val; // sets EOF flag if no value found
-  }
-  file.close();
-  return;
+  if (!field_)
+    DUNE_THROW(IOError, "Data file for Groundwaterflow permeability could not be opened!");
+  if (DomainType::dimension == 1)
+    DUNE_THROW(NotImplemented, "SPE10 is not implemented for 1D!");
+  field_->evaluate_batch(x, y);
+}
+
+void Diffusion::diffusiveFlux_batch(const std::vector<DomainType>& x,
+                                    const std::vector<Problem::JacobianRangeType>& directions,
+                                    std::vector<Problem::JacobianRangeType>& fluxes) const
+{
+  linear_diffusiveFlux_batch(x, directions, fluxes);
+}
+
+void Diffusion::readPermeability(const Dune::XT::Common::Configuration& config_in,
+                                 MPIHelper::MPICommunicator global)
+{
+  const std::string filename = "../dune/multiscale/problems/elliptic/spe10_permeability.dat";
+  // the SPE10 model 2 voxels, with the origin in 0. field_ stays empty if the file is missing
+  field_ = VoxelPermeability::read(filename,
+                                   std::array<std::size_t, 3>{{60, 220, 85}},
+                                   std::array<double, 3>{{0, 0, 0}},
+                                   std::array<double, 3>{{6.096, 3.048, 0.6096}},
+                                   1.,
+                                   0.,
+                                   config_in,
+                                   global);
 } /* readPermeability */
 
 //  void Diffusion::visualizePermeability(const CommonTraits::GridType& grid) const
@@ -0,0 +1,81 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_PROBLEMS_TENSOR_STRUCTURE_HH
+#define DUNE_MULTISCALE_PROBLEMS_TENSOR_STRUCTURE_HH
+
+#include <dune/common/fmatrix.hh>
+#include <dune/common/fvector.hh>
+
+#include <array>
+#include <cstddef>
+
+namespace Dune {
+namespace Multiscale {
+namespace Problem {
+
+//! which entries of a diffusion tensor can be non-zero, see DiffusionBase::structure
+enum class TensorStructure
+{
+  full,
+  //! only the diagonal
+  diagonal,
+  //! a multiple of the identity
+  isotropic
+};
+
+/**
+ * \brief the non-zero entries of a dim x dim diffusion tensor with the given structure
+ *
+ * Stores dim * dim, dim or 1 values, the product with a vector is a dense matrix-vector product, an element-wise
+ * product or a scaling. Quadrature kernels specialize on the structure and keep these instead of full matrices.
+ */
+template <TensorStructure structure, int dim>
+class CompactTensor
+{
+public:
+  static constexpr std::size_t size =
+      structure == TensorStructure::full ? dim * dim : (structure == TensorStructure::diagonal ? dim : 1);
+
+  CompactTensor() = default;
+
+  //! takes the entries of tensor that the structure allows to be non-zero, the others are ignored
+  explicit CompactTensor(const FieldMatrix<double, dim, dim>& tensor)
+  {
+    for (int i = 0; i < dim; ++i) {
+      if (structure == TensorStructure::full)
+        for (int j = 0; j < dim; ++j)
+          values_[i * dim + j] = tensor[i][j];
+      else if (structure == TensorStructure::diagonal)
+        values_[i] = tensor[i][i];
+    }
+    if (structure == TensorStructure::isotropic)
+      values_[0] = tensor[0][0];
+  }
+
+  //! y = A x
+  void mv(const FieldVector<double, dim>& x, FieldVector<double, dim>& y) const
+  {
+    for (int i = 0; i < dim; ++i) {
+      if (structure == TensorStructure::full) {
+        y[i] = 0;
+        for (int j = 0; j < dim; ++j)
+          y[i] += values_[i * dim + j] * x[j];
+      } else if (structure == TensorStructure::diagonal) {
+        y[i] = values_[i] * x[i];
+      } else {
+        y[i] = values_[0] * x[i];
+      }
+    }
+  }
+
+private:
+  std::array<double, size> values_;
+};
+
+} // namespace Problem
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_PROBLEMS_TENSOR_STRUCTURE_HH
@@ -0,0 +1,368 @@
+#include <config.h>
+
+#include "voxel_field.hh"
+
+#include <dune/common/exceptions.hh>
+#include <dune/xt/common/filesystem.hh>
+#include <dune/xt/common/logging.hh>
+#include <dune/xt/common/timings.hh>
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Dune {
+namespace Multiscale {
+namespace Problem {
+
+//! bump whenever the image layout changes, images of other versions are rebuilt
+static const std::uint64_t image_version = 2;
+static const char image_magic[8] = {'D', 'M', 'S', 'V', 'O', 'X', 'L', '\0'};
+//! magic, version and sizes (see read), scale and shift
+static const std::size_t image_header_bytes = sizeof(image_magic) + 8 * sizeof(std::uint64_t) + 2 * sizeof(double);
+
+VoxelPermeability::VoxelPermeability(const std::array<std::size_t, 3>& cells,
+                                     const std::array<double, 3>& lower_left,
+                                     const std::array<double, 3>& widths)
+  : cells_(cells)
+  , lower_left_(lower_left)
+  , strides_{{1, cells[0], cells[0] * cells[1]}}
+  , values_(nullptr)
+  , value_bytes_(0)
+  , fill_(nullptr)
+{
+  for (const auto i : {0, 1, 2}) {
+    if (!(widths[i] > 0))
+      DUNE_THROW(InvalidStateException, "voxel width " << widths[i] << " in direction " << i << " is not positive");
+    inverse_widths_[i] = 1. / widths[i];
+  }
+}
+
+template <class ValueType>
+void VoxelPermeability::set_values(const ValueType* values)
+{
+  values_ = values;
+  value_bytes_ = sizeof(ValueType);
+  fill_ = &VoxelPermeability::fill<ValueType>;
+}
+
+VoxelPermeability::VoxelPermeability(const std::array<std::size_t, 3>& cells,
+                                     const std::array<double, 3>& lower_left,
+                                     const std::array<double, 3>& widths,
+                                     const std::vector<double>& component_major)
+  : VoxelPermeability(cells, lower_left, widths)
+{
+  const auto voxels = size();
+  if (component_major.size() != components * voxels)
+    DUNE_THROW(InvalidStateException,
+               "voxel data has " << component_major.size() << " entries instead of " << components * voxels);
+  auto values = std::make_shared<std::vector<double>>(component_major.size());
+  for (std::size_t c = 0; c < components; ++c)
+    for (std::size_t v = 0; v < voxels; ++v)
+      (*values)[components * v + c] = component_major[c * voxels + v];
+  set_values(values->data());
+  storage_ = values;
+}
+
+//! the cache image of filename below global.datadir, by default
+static std::string image_path(const std::string& filename, const Dune::XT::Common::Configuration& config)
+{
+  const auto slash = filename.find_last_of('/');
+  const auto name = slash == std::string::npos ? filename : filename.substr(slash + 1);
+  const std::string default_path =
+      config.get("global.datadir", "data") + std::string("/permeability_cache/") + name + ".bin";
+  return config.get("problem.permeability_cache.path", default_path);
+}
+
+std::unique_ptr<const VoxelPermeability> VoxelPermeability::read(const std::string& filename,
+                                                                 const std::array<std::size_t, 3>& cells,
+                                                                 const std::array<double, 3>& lower_left,
+                                                                 const std::array<double, 3>& widths,
+                                                                 const double scale,
+                                                                 const double shift,
+                                                                 const Dune::XT::Common::Configuration& config)
+{
+  Dune::XT::Common::ScopedTiming st("problem.permeability.read");
+  const bool cache = config.get("problem.permeability_cache", true);
+  const std::string path = image_path(filename, config);
+  const bool float32 = config.get("problem.permeability_cache.float32", false);
+
+  struct stat source;
+  const bool have_source = ::stat(filename.c_str(), &source) == 0;
+  // in nanoseconds, whole seconds miss a file that is rewritten within the second its image was built
+  const std::uint64_t modified =
+      have_source ? std::uint64_t(source.st_mtim.tv_sec) * 1000000000u + std::uint64_t(source.st_mtim.tv_nsec) : 0;
+  // version, bytes per value, cells, size and modification time of the text file, number of values
+  const std::array<std::uint64_t, 8> header{{image_version,
+                                             float32 ? sizeof(float) : sizeof(double),
+                                             cells[0],
+                                             cells[1],
+                                             cells[2],
+                                             have_source ? std::uint64_t(source.st_size) : 0,
+                                             modified,
+                                             components * cells[0] * cells[1] * cells[2]}};
+  const std::array<double, 2> transform{{scale, shift}};
+  if (cache) {
+    auto mapped = map(path, header, transform, have_source, cells, lower_left, widths);
+    if (mapped)
+      return mapped;
+  }
+  if (!have_source)
+    return nullptr;
+
+  std::ifstream datafile(filename);
+  if (!datafile.is_open())
+    return nullptr;
+  const std::size_t expected = header[7];
+  std::vector<double> component_major;
+  component_major.reserve(expected);
+  double value = 0;
+  while (datafile >> value)
+    component_major.push_back(value * scale + shift);
+  if (component_major.size() != expected)
+    DUNE_THROW(Dune::IOError,
+               "wrong number of entries in '" << filename << "' (are " << component_major.size() << ", should be "
+                                              << expected << ")!");
+  std::unique_ptr<const VoxelPermeability> field(new VoxelPermeability(cells, lower_left, widths, component_major));
+  if (!cache)
+    return field;
+
+  try {
+    Dune::XT::Common::test_create_directory(path);
+    field->write(path, header, transform);
+  } catch (Dune::IOError& e) {
+    MS_LOG_INFO << "not caching the permeability: " << e.what() << std::endl;
+    return field;
+  }
+  // the image might be single precision, all runs use the same values
+  auto mapped = map(path, header, transform, have_source, cells, lower_left, widths);
+  return mapped ? std::move(mapped) : std::move(field);
+}
+
+std::unique_ptr<const VoxelPermeability> VoxelPermeability::read(const std::string& filename,
+                                                                 const std::array<std::size_t, 3>& cells,
+                                                                 const std::array<double, 3>& lower_left,
+                                                                 const std::array<double, 3>& widths,
+                                                                 const double scale,
+                                                                 const double shift,
+                                                                 const Dune::XT::Common::Configuration& config,
+                                                                 MPIHelper::MPICommunicator comm)
+{
+  const bool shared = config.get("problem.permeability_shared", false);
+#if HAVE_MPI && MPI_VERSION >= 3
+  if (!shared)
+    return read(filename, cells, lower_left, widths, scale, shift, config);
+  Dune::XT::Common::ScopedTiming st("problem.permeability.share");
+  MPI_Comm node;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+  int node_rank = 0;
+  MPI_Comm_rank(node, &node_rank);
+
+  // 0: no data, 1: read, 2: failed. The other ranks must not wait for a window that is never allocated
+  int state = 0;
+  std::unique_ptr<const VoxelPermeability> local(nullptr);
+  std::string error;
+  if (node_rank == 0) {
+    try {
+      local = read(filename, cells, lower_left, widths, scale, shift, config);
+      state = local ? 1 : 0;
+    } catch (Dune::Exception& e) {
+      state = 2;
+      error = e.what();
+    } catch (std::exception& e) {
+      state = 2;
+      error = e.what();
+    } catch (...) {
+      // anything escaping here would leave the other ranks waiting in the broadcast
+      state = 2;
+      error = "unknown exception while reading the permeability";
+    }
+  }
+  MPI_Bcast(&state, 1, MPI_INT, 0, node);
+  if (state != 1) {
+    MPI_Comm_free(&node);
+    if (state == 2)
+      DUNE_THROW(IOError, (node_rank == 0 ? error : "reading the permeability failed on the first rank of this node"));
+    return nullptr;
+  }
+
+  // the image may hold single precision values, the window keeps the precision
+  int value_bytes = node_rank == 0 ? local->value_bytes_ : 0;
+  MPI_Bcast(&value_bytes, 1, MPI_INT, 0, node);
+  const auto values = components * cells[0] * cells[1] * cells[2];
+  const MPI_Aint bytes = node_rank == 0 ? values * value_bytes : 0;
+  void* base = nullptr;
+  MPI_Win window;
+  MPI_Win_allocate_shared(bytes, value_bytes, MPI_INFO_NULL, node, &base, &window);
+  if (node_rank == 0) {
+    std::memcpy(base, local->values_, bytes);
+    local.reset();
+  }
+  // completes the copy and makes it visible to all ranks of the node
+  MPI_Win_fence(0, window);
+  MPI_Aint size = 0;
+  int displacement = 0;
+  MPI_Win_shared_query(window, 0, &size, &displacement, &base);
+  assert(std::size_t(size) == values * value_bytes);
+
+  std::unique_ptr<VoxelPermeability> field(new VoxelPermeability(cells, lower_left, widths));
+  if (std::size_t(value_bytes) == sizeof(float))
+    field->set_values(static_cast<const float*>(base));
+  else
+    field->set_values(static_cast<const double*>(base));
+  field->storage_ = std::shared_ptr<const void>(base, [window, node](const void*) mutable {
+    int finalized = 0;
+    MPI_Finalized(&finalized);
+    // while an exception unwinds, the other ranks of the node may never get here. The window is then left to
+    // MPI_Finalize instead of deadlocking in the collective free
+    if (!finalized && !std::uncaught_exception()) {
+      MPI_Win_free(&window);
+      MPI_Comm_free(&node);
+    }
+  });
+  MS_LOG_DEBUG << "sharing the permeability with the ranks of this node" << std::endl;
+  return std::unique_ptr<const VoxelPermeability>(field.release());
+#else
+  (void)comm;
+  if (shared)
+    MS_LOG_INFO << "problem.permeability_shared needs MPI-3, every rank reads the permeability" << std::endl;
+  return read(filename, cells, lower_left, widths, scale, shift, config);
+#endif
+}
+
+std::unique_ptr<const VoxelPermeability> VoxelPermeability::map(const std::string& path,
+                                                                const std::array<std::uint64_t, 8>& header,
+                                                                const std::array<double, 2>& transform,
+                                                                const bool check_source,
+                                                                const std::array<std::size_t, 3>& cells,
+                                                                const std::array<double, 3>& lower_left,
+                                                                const std::array<double, 3>& widths)
+{
+  const int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat image;
+  const auto values = components * cells[0] * cells[1] * cells[2];
+  const auto length = image_header_bytes + values * header[1];
+  if (::fstat(fd, &image) != 0 || std::uint64_t(image.st_size) != length) {
+    ::close(fd);
+    return nullptr;
+  }
+  void* mapping = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping stays valid without the descriptor
+  ::close(fd);
+  if (mapping == MAP_FAILED)
+    return nullptr;
+  std::shared_ptr<const void> storage(mapping, [length](const void* p) { ::munmap(const_cast<void*>(p), length); });
+
+  const auto data = static_cast<const char*>(mapping);
+  std::array<std::uint64_t, 8> stored;
+  std::array<double, 2> stored_transform;
+  std::memcpy(stored.data(), data + sizeof(image_magic), sizeof(stored));
+  std::memcpy(stored_transform.data(), data + sizeof(image_magic) + sizeof(stored), sizeof(stored_transform));
+  bool valid = std::equal(image_magic, image_magic + sizeof(image_magic), data) && stored_transform == transform;
+  // the source's size and time are only compared if it still exists
+  for (const auto i : {0, 1, 2, 3, 4, 7})
+    valid = valid && stored[i] == header[i];
+  if (check_source)
+    valid = valid && stored[5] == header[5] && stored[6] == header[6];
+  if (!valid)
+    return nullptr;
+
+  std::unique_ptr<VoxelPermeability> field(new VoxelPermeability(cells, lower_left, widths));
+  // the header is a multiple of 8 bytes long, so the values are properly aligned
+  if (header[1] == sizeof(float))
+    field->set_values(reinterpret_cast<const float*>(data + image_header_bytes));
+  else
+    field->set_values(reinterpret_cast<const double*>(data + image_header_bytes));
+  field->storage_ = storage;
+  MS_LOG_DEBUG << "mapped permeability image " << path << std::endl;
+  return std::unique_ptr<const VoxelPermeability>(field.release());
+}
+
+void VoxelPermeability::write(const std::string& path,
+                              const std::array<std::uint64_t, 8>& header,
+                              const std::array<double, 2>& transform) const
+{
+  assert(values_ && value_bytes_ == sizeof(double));
+  const auto doubles = static_cast<const double*>(values_);
+  // several processes may build the image at once, each writes its own file and renames it into place
+  const std::string temporary = path + ".tmp" + std::to_string(::getpid());
+  std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+  if (!file.is_open())
+    DUNE_THROW(IOError, "cannot create " << temporary << ": " << std::strerror(errno));
+  file.write(image_magic, sizeof(image_magic));
+  file.write(reinterpret_cast<const char*>(header.data()), sizeof(header));
+  file.write(reinterpret_cast<const char*>(transform.data()), sizeof(transform));
+  const auto values = components * size();
+  if (header[1] == sizeof(float)) {
+    const std::vector<float> floats(doubles, doubles + values);
+    file.write(reinterpret_cast<const char*>(floats.data()), values * sizeof(float));
+  } else {
+    file.write(reinterpret_cast<const char*>(doubles), values * sizeof(double));
+  }
+  file.close();
+  if (!file || std::rename(temporary.c_str(), path.c_str()) != 0) {
+    std::remove(temporary.c_str());
+    DUNE_THROW(IOError, "writing " << path << " failed: " << std::strerror(errno));
+  }
+}
+
+std::size_t VoxelPermeability::voxel(const DomainType& x) const
+{
+  std::size_t index = 0;
+  for (int d = 0; d < CommonTraits::world_dim && d < 3; ++d) {
+    const auto position = std::floor((x[d] - lower_left_[d]) * inverse_widths_[d]);
+    // points on the upper boundary would select one voxel too much, round-off may leave the data on either side
+    const auto clamped = std::min(std::max(position, 0.), double(cells_[d] - 1));
+    index += strides_[d] * std::size_t(clamped);
+  }
+  return index;
+}
+
+template <class ValueType>
+void VoxelPermeability::fill(const void* values, const std::size_t voxel, RangeType& y)
+{
+  const auto voxel_values = static_cast<const ValueType*>(values) + components * voxel;
+  y = 0;
+  for (int d = 0; d < CommonTraits::world_dim && d < 3; ++d)
+    y[d][d] = voxel_values[d];
+}
+
+void VoxelPermeability::evaluate(const DomainType& x, RangeType& y) const
+{
+  fill_(values_, voxel(x), y);
+}
+
+void VoxelPermeability::evaluate_batch(const std::vector<DomainType>& x, std::vector<RangeType>& y) const
+{
+  y.resize(x.size());
+  std::size_t previous = size();
+  for (std::size_t n = 0; n < x.size(); ++n) {
+    const auto current = voxel(x[n]);
+    if (current == previous)
+      y[n] = y[n - 1];
+    else
+      fill_(values_, current, y[n]);
+    previous = current;
+  }
+}
+
+std::size_t VoxelPermeability::size() const
+{
+  return cells_[0] * cells_[1] * cells_[2];
+}
+
+} // namespace Problem
+} // namespace Multiscale {
+} // namespace Dune {
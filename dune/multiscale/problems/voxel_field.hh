@@ -0,0 +1,147 @@
+// dune-multiscale
+// Copyright Holders: Patrick Henning, Rene Milk
+// License: BSD 2-Clause License (http://opensource.org/licenses/BSD-2-Clause)
+
+#ifndef DUNE_MULTISCALE_PROBLEMS_VOXEL_FIELD_HH
+#define DUNE_MULTISCALE_PROBLEMS_VOXEL_FIELD_HH
+
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/multiscale/problems/base.hh>
+#include <dune/xt/common/configuration.hh>
+
+#include <boost/noncopyable.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Dune {
+namespace Multiscale {
+namespace Problem {
+
+/**
+ * \brief diagonal permeability tensor that is constant on the voxels of a structured 3D data set (SPE10, Tarbert)
+ *
+ * The data is given component-major, like in the SPE10 files: all x-permeabilities, then all y, then all z, each
+ * in x-fastest voxel order. It is stored interleaved, the three diagonal entries of a voxel are adjacent. Voxel
+ * widths and their inverses are computed once, evaluation is const and does not write to shared state, so
+ * instances can be used by all assembly threads at once.
+ *
+ * In world_dim < 3 the first world_dim coordinates and components are used, the remaining voxel indices are 0.
+ * Points outside the data are mapped to the nearest voxel.
+ */
+class VoxelPermeability : public boost::noncopyable
+{
+public:
+  typedef DiffusionBase::RangeType RangeType;
+  static constexpr std::size_t components = 3;
+
+  /**
+   * \param cells number of voxels per direction
+   * \param lower_left lower left corner of voxel (0, 0, 0)
+   * \param widths voxel extent per direction
+   * \param component_major cells[0] * cells[1] * cells[2] values per component, see above
+   * \throws Dune::InvalidStateException if the amount of data does not match cells
+   */
+  VoxelPermeability(const std::array<std::size_t, 3>& cells,
+                    const std::array<double, 3>& lower_left,
+                    const std::array<double, 3>& widths,
+                    const std::vector<double>& component_major);
+
+  /**
+   * \brief reads component-major ASCII data from filename, each value v is stored as scale * v + shift
+   *
+   * Parsing the text takes seconds for the SPE10 sets. With problem.permeability_cache (default true) a binary image
+   * of the interleaved field is written to problem.permeability_cache.path (default
+   * global.datadir/permeability_cache/<file name of filename>.bin) the first time, later calls map that image
+   * read-only instead. It is versioned and rebuilt when the size or the modification time (in nanoseconds) of
+   * filename, the cells, scale or shift change. problem.permeability_cache.float32 stores single precision values.
+   * A valid image is also used when filename does not exist.
+   * \return nullptr if neither filename nor an image can be read
+   * \throws Dune::IOError if filename does not contain 3 * cells[0] * cells[1] * cells[2] values
+   */
+  static std::unique_ptr<const VoxelPermeability> read(const std::string& filename,
+                                                       const std::array<std::size_t, 3>& cells,
+                                                       const std::array<double, 3>& lower_left,
+                                                       const std::array<double, 3>& widths,
+                                                       const double scale,
+                                                       const double shift,
+                                                       const Dune::XT::Common::Configuration& config);
+
+  /**
+   * \brief read, but with problem.permeability_shared (default false) the field is kept once per node
+   *
+   * With one rank per core every rank would hold its own copy. Instead, the first rank of each shared memory node of
+   * comm reads the field as above and copies it into an MPI-3 shared memory window, all ranks of the node evaluate
+   * from that window. Collective on comm, and so is the destruction of the returned field: all ranks of the node
+   * have to destroy it at the same point, see ProblemContainer. Only during exception unwinding the window is not
+   * freed but left to MPI_Finalize. Without MPI-3 or with the option unset this is the plain read.
+   * \return nullptr if neither filename nor an image can be read on the node's first rank
+   * \throws Dune::IOError on all ranks of a node if reading failed on its first rank, whatever it threw there
+   */
+  static std::unique_ptr<const VoxelPermeability> read(const std::string& filename,
+                                                       const std::array<std::size_t, 3>& cells,
+                                                       const std::array<double, 3>& lower_left,
+                                                       const std::array<double, 3>& widths,
+                                                       const double scale,
+                                                       const double shift,
+                                                       const Dune::XT::Common::Configuration& config,
+                                                       MPIHelper::MPICommunicator comm);
+
+  //! index of the voxel containing x
+  std::size_t voxel(const DomainType& x) const;
+
+  void evaluate(const DomainType& x, RangeType& y) const;
+
+  /** Tensors for all points. Consecutive points in the same voxel, like the quadrature points of one micro cell
+   * on a grid that resolves the voxels, share a single lookup.
+   */
+  void evaluate_batch(const std::vector<DomainType>& x, std::vector<RangeType>& y) const;
+
+  //! total number of voxels
+  std::size_t size() const;
+
+private:
+  //! set_values has to be called by the caller
+  VoxelPermeability(const std::array<std::size_t, 3>& cells,
+                    const std::array<double, 3>& lower_left,
+                    const std::array<double, 3>& widths);
+
+  //! maps the image at path if it is valid for header, nullptr otherwise
+  static std::unique_ptr<const VoxelPermeability> map(const std::string& path,
+                                                      const std::array<std::uint64_t, 8>& header,
+                                                      const std::array<double, 2>& transform,
+                                                      const bool check_source,
+                                                      const std::array<std::size_t, 3>& cells,
+                                                      const std::array<double, 3>& lower_left,
+                                                      const std::array<double, 3>& widths);
+  void write(const std::string& path,
+             const std::array<std::uint64_t, 8>& header,
+             const std::array<double, 2>& transform) const;
+  //! points values_ at values and selects the matching fill_
+  template <class ValueType>
+  void set_values(const ValueType* values);
+  template <class ValueType>
+  static void fill(const void* values, const std::size_t voxel, RangeType& y);
+
+  const std::array<std::size_t, 3> cells_;
+  const std::array<double, 3> lower_left_;
+  std::array<double, 3> inverse_widths_;
+  std::array<std::size_t, 3> strides_;
+  //! components values per voxel, adjacent, of value_bytes_ each: double or float precision
+  const void* values_;
+  std::size_t value_bytes_;
+  //! fill for the precision of values_, chosen once when the values are set
+  void (*fill_)(const void*, const std::size_t, RangeType&);
+  //! owns the memory behind values_, a vector, a file mapping or a shared memory window
+  std::shared_ptr<const void> storage_;
+};
+
+} // namespace Problem
+} // namespace Multiscale {
+} // namespace Dune {
+
+#endif // DUNE_MULTISCALE_PROBLEMS_VOXEL_FIELD_HH
@@ -0,0 +1,78 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/geometry/quadraturerules.hh>
+#include <dune/xt/common/ranges.hh>
+
+#include <algorithm>
+#include <cmath>
+
+struct CoarseElementMatrix : public GridAndSpaces
+{
+  typedef LocalproblemSolutionManager::CoarseElementMatrixType MatrixType;
+
+  /** \int_T A \nabla(\phi_j + Q_j) \cdot \nabla(\phi_i + Q_i) by quadrature on the covered micro cells, with the
+   * coarse base functions evaluated in the coarse cell's coordinates of each quadrature point
+   */
+  MatrixType quadrature_matrix(const MsFEMTraits::CoarseEntityType& coarse_cell, LocalproblemSolutionManager& manager)
+  {
+    const auto& diffusion = problem_->getDiffusion();
+    const auto& solutions = manager.getLocalSolutions();
+    const auto base = coarseSpace.base_function_set(coarse_cell);
+    const auto size = base.size();
+    const auto& coarse_geometry = coarse_cell.geometry();
+    MatrixType matrix(size, size, 0.);
+    typedef CommonTraits::SpaceType::BaseFunctionSetType::JacobianRangeType JacobianRangeType;
+    std::vector<JacobianRangeType> gradients(size);
+    for (const auto& local_entity : Dune::elements(manager.space().grid_view())) {
+      if (!LocalGridList::covers(coarse_cell, local_entity))
+        continue;
+      const auto& geometry = local_entity.geometry();
+      std::vector<decltype(solutions[0]->local_function(local_entity))> correctors;
+      for (const auto i : Dune::XT::Common::value_range(size))
+        correctors.push_back(solutions[i]->local_function(local_entity));
+      const auto& rule = Dune::QuadratureRules<double, CommonTraits::world_dim>::rule(local_entity.type(), 6);
+      for (const auto& point : rule) {
+        const auto global = geometry.global(point.position());
+        const auto base_jacobians = base.jacobian(coarse_geometry.local(global));
+        for (const auto i : Dune::XT::Common::value_range(size)) {
+          gradients[i] = base_jacobians[i];
+          gradients[i] += correctors[i]->jacobian(point.position());
+        }
+        CommonTraits::DiffusionFunctionBaseType::RangeType tensor;
+        diffusion.evaluate(global, tensor);
+        const auto factor = point.weight() * geometry.integrationElement(point.position());
+        CommonTraits::DiffusionFunctionBaseType::RangeType::row_type flux;
+        for (const auto j : Dune::XT::Common::value_range(size)) {
+          tensor.mv(gradients[j][0], flux);
+          for (const auto i : Dune::XT::Common::value_range(size))
+            matrix[i][j] += factor * (flux * gradients[i][0]);
+        }
+      }
+    }
+    return matrix;
+  }
+
+  void compare()
+  {
+    for_each_solved_cell([&](const MsFEMTraits::CoarseEntityType& coarse_cell, LocalproblemSolutionManager& manager) {
+      const auto algebraic = manager.coarse_matrix();
+      ASSERT_NE(algebraic, nullptr);
+      const auto expected = quadrature_matrix(coarse_cell, manager);
+      ASSERT_EQ(expected.rows(), algebraic->rows());
+      ASSERT_EQ(expected.cols(), algebraic->cols());
+      double scale = 0;
+      for (const auto i : Dune::XT::Common::value_range(expected.rows()))
+        for (const auto j : Dune::XT::Common::value_range(expected.cols()))
+          scale = std::max(scale, std::abs(expected[i][j]));
+      // the smooth coefficient is integrated almost exactly by both, only round-off and quadrature errors remain
+      for (const auto i : Dune::XT::Common::value_range(expected.rows()))
+        for (const auto j : Dune::XT::Common::value_range(expected.cols()))
+          EXPECT_NEAR(expected[i][j], (*algebraic)[i][j], 1e-4 * scale) << "entry " << i << ", " << j;
+    });
+  }
+};
+
+TEST_F(CoarseElementMatrix, AlgebraicEqualsQuadrature)
+{
+  this->compare();
+}
@@ -0,0 +1,88 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/msfem/coarse_rhs_functional.hh>
+#include <dune/multiscale/msfem/coarse_scatter.hh>
+
+#include <tbb/parallel_for.h>
+
+#include <vector>
+
+//! g(x) = 1 + x_0, its integral over the boundary of the unit cube is 3 * dim
+struct LinearNeumannData : public DMP::NeumannDataBase
+{
+  void evaluate(const DomainType& x, RangeType& y) const final override
+  {
+    y = 1 + x[0];
+  }
+
+  size_t order() const final override
+  {
+    return 1;
+  }
+};
+
+struct CoarseScatter : public GridAndSpaces
+{
+  //! values whose sum depends on the order they are added in
+  static double value(const std::size_t coarse_index)
+  {
+    return coarse_index % 3 == 0 ? 1e16 : (coarse_index % 3 == 1 ? 1. : -1e16 + 3.);
+  }
+
+  void deterministic_order()
+  {
+    const std::size_t cells = 1000;
+    CommonTraits::GdtVectorType target(1, 0.);
+    CoarseElementScatter scatter(true);
+    const CoarseElementScatter::IndicesType rows(1, 0);
+    // added concurrently and in reverse order
+    tbb::parallel_for(std::size_t(0), cells, [&](const std::size_t i) {
+      const auto coarse_index = cells - 1 - i;
+      scatter.add(coarse_index, rows, 1, CoarseElementScatter::ElementVectorType(1, value(coarse_index)), target);
+    });
+    scatter.flush();
+    double expected = 0;
+    for (const auto coarse_index : Dune::XT::Common::value_range(cells))
+      expected += value(coarse_index);
+    EXPECT_EQ(expected, target.get_entry(0));
+  }
+
+  //! all Neumann face vectors go through the scatter and integrate g over the whole boundary
+  void neumann_faces()
+  {
+    const LinearNeumannData neumann;
+    CommonTraits::GdtVectorType rhs(coarseSpace.mapper().size(), 0.);
+    CoarseElementScatter scatter(true, true);
+    NeumannFaceVector faces(neumann, coarseSpace, rhs, scatter);
+    const auto interior = coarseSpace.grid_view().grid().leafGridView<CommonTraits::InteriorBorderPartition>();
+    for (const auto& entity : Dune::elements(interior))
+      for (const auto& intersection : Dune::intersections(interior, entity))
+        if (intersection.boundary())
+          faces.apply_local(intersection, entity, entity);
+    // nothing is added before the flush
+    EXPECT_EQ(0., rhs.sup_norm());
+    scatter.flush();
+    double integral = 0;
+    for (const auto i : Dune::XT::Common::value_range(rhs.size()))
+      integral += rhs.get_entry(i);
+    EXPECT_NEAR(3. * CommonTraits::world_dim, integral, 1e-10);
+
+    // face vectors are not retracted with the contributions of their cell
+    CommonTraits::LinearOperatorType matrix(rhs.size(), rhs.size());
+    CommonTraits::GdtVectorType retracted(rhs.size(), 0.);
+    for (const auto& entity : Dune::elements(interior))
+      scatter.retract(interior.indexSet().index(entity), matrix, retracted);
+    EXPECT_EQ(0., retracted.sup_norm());
+  }
+};
+
+TEST_F(CoarseScatter, DeterministicOrder)
+{
+  this->deterministic_order();
+}
+
+TEST_F(CoarseScatter, NeumannFaces)
+{
+  this->neumann_faces();
+}
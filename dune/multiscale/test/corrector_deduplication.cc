@@ -0,0 +1,104 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/common/df_io.hh>
+#include <dune/multiscale/msfem/localproblems/correctordeduplication.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+//! 1 + x_0 + 2 x_1 + 4 x_2, the coefficient scaled by it is not invariant under any coarse cell translation
+static double skew(const DMP::DiffusionBase::DomainType& x)
+{
+  double factor = 1;
+  for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+    factor += std::ldexp(x[i], int(i));
+  return factor;
+}
+
+struct Deduplication : public GridAndSpaces
+{
+  //! interior cells of the periodic Synthetic coefficient share correctors, which equal their own solutions
+  void periodic()
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    CorrectorDeduplication deduplication(*problem_, coarseSpace, localgrid_list);
+    std::size_t fingerprinted = 0;
+    // msfem.corrector_deduplication is off, the solver computes every cell's own correctors
+    for_each_solved_cell(localgrid_list, [&](const MsFEMTraits::CoarseEntityType& coarse_cell,
+                                             LocalproblemSolutionManager& manager) {
+      const auto fingerprint = deduplication.fingerprint(coarse_cell, manager.grid_view(), problem_->getDiffusion());
+      if (!fingerprint)
+        return;
+      ++fingerprinted;
+      LocalproblemSolutionManager reused(coarseSpace, coarse_cell, localgrid_list);
+      if (!deduplication.reuse(fingerprint, reused)) {
+        deduplication.store(fingerprint, manager);
+        return;
+      }
+      const auto& expected = manager.getLocalSolutions();
+      const auto& actual = reused.getLocalSolutions();
+      ASSERT_EQ(expected.size(), actual.size());
+      for (const auto i : Dune::XT::Common::value_range(expected.size())) {
+        auto difference = actual[i]->vector();
+        difference -= expected[i]->vector();
+        // the coefficients agree up to the rounding of the fingerprint
+        EXPECT_LE(difference.sup_norm(), 1e-6 * std::max(1., expected[i]->vector().sup_norm())) << "corrector " << i;
+      }
+      ASSERT_EQ(manager.coarse_matrix() == nullptr, reused.coarse_matrix() == nullptr);
+      if (manager.coarse_matrix()) {
+        const auto& expected_matrix = *manager.coarse_matrix();
+        const auto& actual_matrix = *reused.coarse_matrix();
+        const auto scale = std::max(1., expected_matrix.infinity_norm());
+        for (const auto i : Dune::XT::Common::value_range(expected_matrix.rows()))
+          for (const auto j : Dune::XT::Common::value_range(expected_matrix.cols()))
+            EXPECT_NEAR(expected_matrix[i][j], actual_matrix[i][j], 1e-6 * scale) << "entry " << i << ", " << j;
+      }
+    });
+    ASSERT_GT(fingerprinted, 1u);
+    EXPECT_GT(deduplication.hits(), 0u);
+    EXPECT_LT(deduplication.size(), fingerprinted);
+  }
+
+  //! no two interior cells of the scaled coefficient share correctors, not even if their hashes collide
+  void not_periodic()
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    const ModifiedDiffusion diffusion(problem_->getDiffusion(), skew, 1);
+    CorrectorDeduplication deduplication(*problem_, coarseSpace, localgrid_list);
+    std::vector<CorrectorDeduplication::Fingerprint> stored;
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      LocalproblemSolutionManager manager(coarseSpace, coarse_cell, localgrid_list);
+      const auto fingerprint = deduplication.fingerprint(coarse_cell, manager.grid_view(), diffusion);
+      if (!fingerprint)
+        continue;
+      // the earlier cells' fingerprints with this cell's hash
+      for (auto collision : stored) {
+        EXPECT_FALSE(collision == fingerprint);
+        collision.hash = fingerprint.hash;
+        deduplication.store(collision, manager);
+      }
+      EXPECT_FALSE(deduplication.reuse(fingerprint, manager));
+      deduplication.store(fingerprint, manager);
+      stored.push_back(fingerprint);
+    }
+    ASSERT_GT(stored.size(), 1u);
+    EXPECT_EQ(deduplication.hits(), 0u);
+  }
+};
+
+TEST_F(Deduplication, PeriodicCoefficientShares)
+{
+  this->periodic();
+}
+
+TEST_F(Deduplication, OtherCoefficientRefused)
+{
+  this->not_periodic();
+}
@@ -0,0 +1,57 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/geometry/quadraturerules.hh>
+#include <dune/xt/common/ranges.hh>
+
+#include <algorithm>
+#include <vector>
+
+struct DiffusionBatch : public GridAndSpaces
+{
+  //! evaluate_batch and diffusiveFlux_batch in the quadrature points of the fine grid give the pointwise values
+  void matches_pointwise()
+  {
+    problem_->getMutableModelData().prepare_new_evaluation(*problem_);
+    const auto& diffusion = problem_->getDiffusion();
+    std::vector<DMP::DomainType> points;
+    std::vector<DMP::JacobianRangeType> directions;
+    for (const auto& entity : Dune::elements(fineSpace.grid_view())) {
+      const auto& geometry = entity.geometry();
+      const auto order = int(diffusion.order());
+      for (const auto& point : Dune::QuadratureRules<double, CommonTraits::world_dim>::rule(entity.type(), order)) {
+        points.push_back(geometry.global(point.position()));
+        DMP::JacobianRangeType direction;
+        for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+          direction[0][i] = 1. + i + points.size() % 3;
+        directions.push_back(direction);
+      }
+    }
+
+    std::vector<CommonTraits::DiffusionFunctionBaseType::RangeType> tensors;
+    std::vector<DMP::JacobianRangeType> fluxes;
+    diffusion.evaluate_batch(points, tensors);
+    diffusion.diffusiveFlux_batch(points, directions, fluxes);
+    ASSERT_EQ(points.size(), tensors.size());
+    ASSERT_EQ(points.size(), fluxes.size());
+    for (const auto n : Dune::XT::Common::value_range(points.size())) {
+      CommonTraits::DiffusionFunctionBaseType::RangeType expected;
+      diffusion.evaluate(points[n], expected);
+      const auto scale = std::max(1., expected.infinity_norm());
+      auto difference = tensors[n];
+      difference -= expected;
+      EXPECT_LE(difference.infinity_norm(), 1e-14 * scale) << "point " << points[n];
+
+      DMP::JacobianRangeType expected_flux;
+      diffusion.diffusiveFlux(points[n], directions[n], expected_flux);
+      auto flux_difference = fluxes[n][0];
+      flux_difference -= expected_flux[0];
+      EXPECT_LE(flux_difference.infinity_norm(), 1e-14 * scale * directions[n][0].infinity_norm())
+          << "point " << points[n];
+    }
+  }
+};
+
+TEST_F(DiffusionBatch, MatchesPointwise)
+{
+  this->matches_pointwise();
+}
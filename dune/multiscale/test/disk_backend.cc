@@ -0,0 +1,62 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/common/df_io.hh>
+
+typedef DiskBackend::VectorType VectorType;
+
+static void expect_record(const DiskBackend& disk,
+                          const std::size_t coarse_index,
+                          const std::size_t size,
+                          const double value)
+{
+  VectorType read(size, 0.);
+  disk.read(coarse_index, 0, read);
+  for (const auto i : Dune::XT::Common::value_range(size))
+    EXPECT_EQ(value, read.get_entry(i)) << "coarse cell " << coarse_index << ", entry " << i;
+}
+
+TEST(DiskBackend, ReusesReplacedRecords)
+{
+  DiskBackend disk(DXTC_CONFIG, "disk_backend_test");
+  disk.append(0, 0, VectorType(100, 1.));
+  const auto first = disk.bytes();
+
+  // same size, overwritten in place
+  disk.append(0, 0, VectorType(100, 2.));
+  EXPECT_EQ(first, disk.bytes());
+  expect_record(disk, 0, 100, 2.);
+
+  // does not fit, the old record becomes free
+  disk.append(0, 0, VectorType(200, 3.));
+  const auto second = disk.bytes();
+  EXPECT_GT(second, first);
+  expect_record(disk, 0, 200, 3.);
+
+  // fits into the free record of the first write
+  disk.append(1, 0, VectorType(50, 4.));
+  EXPECT_EQ(second, disk.bytes());
+  expect_record(disk, 1, 50, 4.);
+  expect_record(disk, 0, 200, 3.);
+}
+
+TEST(DiscreteFunctionIO, BudgetFollowsConfig)
+{
+  const std::size_t mebibyte = 1024 * 1024;
+  DXTC_CONFIG.set("msfem.corrector_memory_budget", 1, true);
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+  }
+  EXPECT_FALSE(DiscreteFunctionIO::reserve(2 * mebibyte));
+  // a later run with another budget
+  DXTC_CONFIG.set("msfem.corrector_memory_budget", 4, true);
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+  }
+  EXPECT_TRUE(DiscreteFunctionIO::reserve(2 * mebibyte));
+  DXTC_CONFIG.set("msfem.corrector_memory_budget", 0, true);
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+  }
+}
@@ -0,0 +1,119 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/geometry/quadraturerules.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/msfem/coarse_rhs_functional.hh>
+#include <dune/multiscale/msfem/coarse_scale_assembler.hh>
+
+#include <algorithm>
+#include <cmath>
+
+struct FusedElementKernel : public GridAndSpaces
+{
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> MatrixType;
+  typedef Dune::DynamicVector<CommonTraits::RangeFieldType> VectorType;
+  typedef CommonTraits::SpaceType::BaseFunctionSetType::JacobianRangeType JacobianRangeType;
+
+  //! calls check for every covered local grid element, after the coarse cell's local problems are solved
+  template <class CheckType>
+  void for_all_local_elements(CheckType check)
+  {
+    for_each_solved_cell([&](const MsFEMTraits::CoarseEntityType& coarse_cell, LocalproblemSolutionManager& manager) {
+      const auto base = coarseSpace.base_function_set(coarse_cell);
+      for (const auto& local_entity : Dune::elements(manager.space().grid_view())) {
+        if (LocalGridList::covers(coarse_cell, local_entity))
+          check(manager, local_entity, base);
+      }
+    });
+  }
+
+  static double largest_entry(const MatrixType& matrix)
+  {
+    double scale = 0;
+    for (const auto i : Dune::XT::Common::value_range(matrix.rows()))
+      for (const auto j : Dune::XT::Common::value_range(matrix.cols()))
+        scale = std::max(scale, std::abs(matrix[i][j]));
+    return scale;
+  }
+
+  //! the fused kernel must give the element matrix of the matrix-only kernel and the vector of RhsCodim0Integral
+  void separate_kernels()
+  {
+    const MsFEMCodim0Integral local_operator(problem_->getDiffusion(), problem_->getModelData().linear());
+    const RhsCodim0Integral rhs_integral(*problem_);
+    for_all_local_elements([&](LocalproblemSolutionManager& manager,
+                               const MsFEMTraits::LocalEntityType& local_entity,
+                               const CommonTraits::SpaceType::BaseFunctionSetType& base) {
+      const auto size = base.size();
+      const MsFEMTraits::LocalGridDiscreteFunctionType dirichlet_extension(manager.space(), "Dirichlet Extension");
+      MatrixType matrix(size, size, 0.), fused_matrix(size, size, 0.);
+      VectorType vector(size, 0.), fused_vector(size, 0.);
+      std::vector<MatrixType> tmp_matrices;
+      std::vector<VectorType> tmp_vectors;
+      local_operator.apply(manager, local_entity, base, base, matrix, tmp_matrices);
+      rhs_integral.apply(dirichlet_extension, manager, local_entity, base, vector, tmp_vectors);
+      local_operator.apply(
+          rhs_integral, dirichlet_extension, manager, local_entity, base, base, fused_matrix, fused_vector);
+
+      const auto scale = std::max(largest_entry(matrix), 1e-14);
+      double vector_scale = 1e-14;
+      for (const auto i : Dune::XT::Common::value_range(size))
+        vector_scale = std::max(vector_scale, std::abs(vector[i]));
+      for (const auto i : Dune::XT::Common::value_range(size)) {
+        EXPECT_NEAR(vector[i], fused_vector[i], 1e-12 * vector_scale) << "entry " << i;
+        for (const auto j : Dune::XT::Common::value_range(size))
+          EXPECT_NEAR(matrix[i][j], fused_matrix[i][j], 1e-12 * scale) << "entry " << i << ", " << j;
+      }
+    });
+  }
+
+  //! the element matrix of a nonlinear flux, against diffusiveFlux called in each quadrature point
+  void nonlinear_flux()
+  {
+    // only diffusiveFlux gives the flux of the cubic term
+    const ModifiedDiffusion diffusion(problem_->getDiffusion(), nullptr, 0, 1.);
+    const MsFEMCodim0Integral local_operator(diffusion, false);
+    for_all_local_elements([&](LocalproblemSolutionManager& manager,
+                               const MsFEMTraits::LocalEntityType& local_entity,
+                               const CommonTraits::SpaceType::BaseFunctionSetType& base) {
+      const auto size = base.size();
+      MatrixType matrix(size, size, 0.), expected(size, size, 0.);
+      std::vector<MatrixType> tmp_matrices;
+      local_operator.apply(manager, local_entity, base, base, matrix, tmp_matrices);
+
+      const auto& solutions = manager.getLocalSolutions();
+      const auto& geometry = local_entity.geometry();
+      const auto order = int(diffusion.order() + 2 * base.order());
+      const auto& rule = Dune::QuadratureRules<double, CommonTraits::world_dim>::rule(local_entity.type(), order);
+      std::vector<JacobianRangeType> gradients(size);
+      JacobianRangeType flux;
+      for (const auto& point : rule) {
+        const auto base_jacobians = base.jacobian(point.position());
+        for (const auto i : Dune::XT::Common::value_range(size)) {
+          gradients[i] = base_jacobians[i];
+          gradients[i] += solutions[i]->local_function(local_entity)->jacobian(point.position());
+        }
+        const auto factor = point.weight() * geometry.integrationElement(point.position());
+        for (const auto i : Dune::XT::Common::value_range(size)) {
+          diffusion.diffusiveFlux(geometry.global(point.position()), gradients[i], flux);
+          for (const auto j : Dune::XT::Common::value_range(size))
+            expected[j][i] += factor * (flux[0] * gradients[j][0]);
+        }
+      }
+      const auto scale = std::max(largest_entry(expected), 1e-14);
+      for (const auto i : Dune::XT::Common::value_range(size))
+        for (const auto j : Dune::XT::Common::value_range(size))
+          EXPECT_NEAR(expected[i][j], matrix[i][j], 1e-12 * scale) << "entry " << i << ", " << j;
+    });
+  }
+};
+
+TEST_F(FusedElementKernel, SeparateKernels)
+{
+  this->separate_kernels();
+}
+
+TEST_F(FusedElementKernel, NonlinearFlux)
+{
+  this->nonlinear_flux();
+}
@@ -80,6 +80,12 @@ struct PointsAndStuff : public GridAndSpaces
       const auto lg_points = global_evaluation_points(fineSpace, ent);
       const auto evaluation_entity_ptrs = search(lg_points);
       EXPECT_GE(evaluation_entity_ptrs.size(), lg_points.size());
+      EXPECT_TRUE(search.covers_strict(search.current_coarse_pointer(), lg_points.begin(), lg_points.end()));
+      for (auto i : Dune::XT::Common::value_range(lg_points.size())) {
+        ASSERT_NE(evaluation_entity_ptrs[i], nullptr);
+        const auto& local_entity = *evaluation_entity_ptrs[i];
+        EXPECT_TRUE(DSG::reference_element(local_entity).checkInside(local_entity.geometry().local(lg_points[i])));
+      }
     }
   }
 
@@ -161,8 +167,27 @@ struct GridMatch : public GridTestBase
       }
     }
   }
+
+  //! ids are unique and not passed on to grids created after one is destroyed
+  void check_ids()
+  {
+    const auto coarse_id = grid_id(*grids_.first);
+    const auto fine_id = grid_id(*grids_.second);
+    EXPECT_NE(coarse_id, 0u);
+    EXPECT_NE(fine_id, 0u);
+    EXPECT_NE(coarse_id, fine_id);
+    grids_.second.reset();
+    grids_.second = make_fine_grid(*problem_, grids_.first);
+    EXPECT_NE(grid_id(*grids_.second), 0u);
+    EXPECT_NE(grid_id(*grids_.second), fine_id);
+  }
 };
 
+TEST_F(GridMatch, Ids)
+{
+  this->check_ids();
+}
+
 TEST_F(GridMatch, Match)
 {
   this->check_dimensions();
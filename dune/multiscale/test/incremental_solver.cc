@@ -0,0 +1,65 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/memory.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/common/df_io.hh>
+#include <dune/multiscale/msfem/incremental_solver.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localsolution_proxy.hh>
+#include <dune/multiscale/msfem/msfem_solver.hh>
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <vector>
+
+struct Incremental : public GridAndSpaces
+{
+  //! changing the coefficient on one coarse cell and updating gives the solution of a full re-solve
+  void update_one_cell()
+  {
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+
+    // an interior cell, its neighbours' local problems change as well with oversampling
+    const auto& view = coarseSpace.grid_view();
+    const auto changed_cell = *std::find_if(view.begin<0>(), view.end<0>(), [](const CommonTraits::EntityType& cell) {
+      return !cell.hasBoundaryIntersections();
+    });
+    const auto& geometry = changed_cell.geometry();
+    const auto lower = geometry.corner(0);
+    const auto upper = geometry.corner(geometry.corners() - 1);
+    // the coefficient times 10 inside the changed cell
+    const auto box_scale = [lower, upper](const DMP::DiffusionBase::DomainType& x) {
+      for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+        if (x[i] < lower[i] || x[i] > upper[i])
+          return 1.;
+      return 10.;
+    };
+
+    std::unique_ptr<LocalsolutionProxy> updated(nullptr);
+    std::unique_ptr<DMP::DiffusionBase> original(nullptr);
+    {
+      IncrementalMsFemSolver solver(*problem_, coarseSpace, localgrid_list);
+      std::unique_ptr<LocalsolutionProxy> initial(nullptr);
+      solver.apply(initial);
+      // a new diffusion object, the solver must not keep using the one it was set up with
+      const auto& current = problem_->getDiffusion();
+      original = problem_->exchangeDiffusion(Dune::XT::Common::make_unique<ModifiedDiffusion>(current, box_scale));
+      const auto changed = solver.cells_in(lower, upper);
+      ASSERT_EQ(changed, std::set<std::size_t>{view.indexSet().index(changed_cell)});
+      const auto resolved = solver.update(changed, updated);
+      EXPECT_GE(resolved, 1u);
+      EXPECT_LT(resolved, std::size_t(view.size(0)));
+    }
+
+    std::unique_ptr<LocalsolutionProxy> expected(nullptr);
+    Elliptic_MsFEM_Solver().apply(*problem_, coarseSpace, expected, localgrid_list);
+    expect_equal(*expected, *updated);
+    problem_->exchangeDiffusion(std::move(original));
+  }
+};
+
+TEST_F(Incremental, UpdateMatchesFullSolve)
+{
+  this->update_one_cell();
+}
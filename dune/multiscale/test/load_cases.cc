@@ -0,0 +1,48 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localsolution_proxy.hh>
+#include <dune/multiscale/msfem/msfem_solver.hh>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+struct LoadCases : public GridAndSpaces
+{
+  typedef std::map<std::size_t, std::unique_ptr<LocalsolutionProxy>> SolutionsType;
+
+  //! reconstructing two load cases in one call gives each the solution of a call for it alone
+  void reconstruct_two()
+  {
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    const Elliptic_MsFEM_Solver solver{};
+    const std::vector<CommonTraits::GdtVectorType> load_vectors(
+        1, CommonTraits::GdtVectorType(coarseSpace.mapper().size(), 1.));
+    std::vector<CommonTraits::GdtVectorType> coarse_solutions;
+
+    std::unique_ptr<LocalsolutionProxy> problem_alone(nullptr);
+    solver.apply(*problem_, coarseSpace, problem_alone, localgrid_list);
+    SolutionsType load_alone;
+    solver.apply(*problem_, coarseSpace, load_vectors, {1}, coarse_solutions, load_alone, localgrid_list);
+    SolutionsType both;
+    solver.apply(*problem_, coarseSpace, load_vectors, {0, 1}, coarse_solutions, both, localgrid_list);
+
+    ASSERT_EQ(both.size(), 2u);
+    {
+      SCOPED_TRACE("load case 0");
+      expect_equal(*problem_alone, *both[0]);
+    }
+    {
+      SCOPED_TRACE("load case 1");
+      expect_equal(*load_alone[1], *both[1]);
+    }
+  }
+};
+
+TEST_F(LoadCases, ReconstructTwo)
+{
+  this->reconstruct_two();
+}
@@ -0,0 +1,61 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/configuration.hh>
+#include <dune/multiscale/common/df_io.hh>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+struct LocalMultigrid : public GridAndSpaces
+{
+  //! all local solutions of coarse_cell with msfem.local_solver = solver
+  std::vector<LocalVectorType> solve(const MsFEMTraits::CoarseEntityType& coarse_cell,
+                                     LocalproblemSolutionManager& manager,
+                                     const CommonTraits::ConstDiscreteFunctionType& dirichlet_extension,
+                                     const std::string& solver)
+  {
+    problem_->config().set("msfem.local_solver", solver, true);
+    LocalStructure structure(manager.space());
+    return solve_local_problems(coarse_cell, manager, structure, dirichlet_extension);
+  }
+
+  void matches_direct_solver()
+  {
+    const std::string direct = HAVE_UMFPACK ? "umfpack" : (HAVE_CHOLMOD ? "cholmod" : "");
+    if (direct.empty())
+      return;
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    CommonTraits::DiscreteFunctionType coarse_extension(coarseSpace, "Dirichlet Extension Coarse");
+    LocalProblemOperator::coarse_dirichlet_extension(*problem_, coarse_extension);
+    const CommonTraits::ConstDiscreteFunctionType dirichlet_extension(coarseSpace, coarse_extension.vector());
+    // without oversampling the local grids have the micro cells of one coarse cell
+    const auto cells = problem_->config().get<std::vector<std::size_t>>("grids.micro_cells_per_macrocell_dim");
+    const bool coarsenable =
+        std::all_of(cells.begin(), cells.end(), [](const std::size_t cell_count) { return cell_count % 2 == 0; });
+
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      LocalproblemSolutionManager multigrid_manager(coarseSpace, coarse_cell, localgrid_list);
+      LocalproblemSolutionManager direct_manager(coarseSpace, coarse_cell, localgrid_list);
+      problem_->config().set("msfem.local_solver", "multigrid", true);
+      EXPECT_EQ(coarsenable, LocalMultigridInverse::coarsenable(multigrid_manager.space()));
+      const auto fallback = HAVE_CHOLMOD ? "cholmod" : "umfpack";
+      EXPECT_EQ(coarsenable ? "multigrid" : fallback,
+                LocalProblemOperator::local_solver(*problem_, multigrid_manager.space()));
+      const auto multigrid = solve(coarse_cell, multigrid_manager, dirichlet_extension, "multigrid");
+      const auto expected = solve(coarse_cell, direct_manager, dirichlet_extension, direct);
+      ASSERT_EQ(expected.size(), multigrid.size());
+      for (const auto i : Dune::XT::Common::value_range(expected.size())) {
+        auto difference = multigrid[i];
+        difference -= expected[i];
+        EXPECT_LE(difference.sup_norm(), 1e-8 * std::max(1., expected[i].sup_norm())) << "corrector " << i;
+      }
+    }
+  }
+};
+
+TEST_F(LocalMultigrid, MatchesDirectSolver)
+{
+  this->matches_direct_solver();
+}
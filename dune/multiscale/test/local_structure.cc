@@ -0,0 +1,48 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/configuration.hh>
+#include <dune/multiscale/common/df_io.hh>
+
+#include <algorithm>
+#include <vector>
+
+struct LocalStructureReuse : public GridAndSpaces
+{
+  void shared_factorization()
+  {
+    const auto solver = DXTC_CONFIG_GET("msfem.local_solver", std::string("umfpack"));
+    if ((solver == "umfpack" && !HAVE_UMFPACK) || (solver == "cholmod" && !HAVE_CHOLMOD))
+      return;
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    CommonTraits::DiscreteFunctionType coarse_extension(coarseSpace, "Dirichlet Extension Coarse");
+    LocalProblemOperator::coarse_dirichlet_extension(*problem_, coarse_extension);
+    const CommonTraits::ConstDiscreteFunctionType dirichlet_extension(coarseSpace, coarse_extension.vector());
+
+    LocalStructureCache cache;
+    std::size_t cells = 0;
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      ++cells;
+      LocalproblemSolutionManager shared_manager(coarseSpace, coarse_cell, localgrid_list);
+      LocalproblemSolutionManager fresh_manager(coarseSpace, coarse_cell, localgrid_list);
+      // all but the first cell of a shape factorize with another cell's symbolic analysis
+      auto& shared = cache.get(localgrid_list.shape(coarse_cell), shared_manager.space());
+      LocalStructure fresh(fresh_manager.space());
+      const auto reused = solve_local_problems(coarse_cell, shared_manager, shared, dirichlet_extension);
+      const auto expected = solve_local_problems(coarse_cell, fresh_manager, fresh, dirichlet_extension);
+      ASSERT_EQ(expected.size(), reused.size());
+      for (const auto i : Dune::XT::Common::value_range(expected.size())) {
+        auto difference = reused[i];
+        difference -= expected[i];
+        EXPECT_LE(difference.sup_norm(), 1e-10 * std::max(1., expected[i].sup_norm())) << "corrector " << i;
+      }
+    }
+    if (cells > 1)
+      EXPECT_LT(cache.size(), cells);
+  }
+};
+
+TEST_F(LocalStructureReuse, SharedFactorization)
+{
+  this->shared_factorization();
+}
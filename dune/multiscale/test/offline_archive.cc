@@ -0,0 +1,119 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/common/exceptions.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/common/df_io.hh>
+#include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/msfem/offline_archive.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+struct Archive : public GridAndSpaces
+{
+  void set_mode(const std::string& mode)
+  {
+    problem_->config().set("msfem.archive", mode, true);
+  }
+
+  //! solves all local problems and archives their inner correctors
+  void write_archive(LocalGridList& localgrid_list)
+  {
+    set_mode("offline");
+    OfflineArchive archive(*problem_, coarseSpace, localgrid_list);
+    LocalProblemSolver(*problem_, coarseSpace, localgrid_list).solve_for_all_cells();
+    archive.write_correctors(coarseSpace, localgrid_list);
+    archive.close();
+  }
+
+  void round_trip()
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    write_archive(localgrid_list);
+    set_mode("online");
+    const OfflineArchive archive(*problem_, coarseSpace, localgrid_list);
+    EXPECT_TRUE(archive.online());
+    const auto& index_set = coarseSpace.grid_view().grid().leafIndexSet();
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      LocalproblemSolutionManager expected(coarseSpace, coarse_cell, localgrid_list);
+      expected.load();
+      LocalproblemSolutionManager read(coarseSpace, coarse_cell, localgrid_list);
+      archive.read_correctors(index_set.index(coarse_cell), read.getLocalSolutions());
+      const auto& expected_solutions = expected.getLocalSolutions();
+      const auto& read_solutions = read.getLocalSolutions();
+      const auto num_inner = expected_solutions.size() - expected.numBoundaryCorrectors();
+      for (const auto i : Dune::XT::Common::value_range(num_inner)) {
+        auto difference = read_solutions[i]->vector();
+        difference -= expected_solutions[i]->vector();
+        EXPECT_EQ(difference.sup_norm(), 0.) << "corrector " << i;
+      }
+    }
+    set_mode("none");
+  }
+
+  //! an online run with another coefficient parameter must not use the archive
+  void changed_config()
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    write_archive(localgrid_list);
+    set_mode("online");
+    const auto epsilon = problem_->config().get("problem.epsilon", 0.05);
+    problem_->config().set("problem.epsilon", 2 * epsilon, true);
+    EXPECT_THROW(OfflineArchive archive(*problem_, coarseSpace, localgrid_list), Dune::IOError);
+    problem_->config().set("problem.epsilon", epsilon, true);
+    EXPECT_NO_THROW(OfflineArchive archive(*problem_, coarseSpace, localgrid_list));
+    set_mode("none");
+  }
+
+  //! the checksum sees coefficients that only differ away from the coarse cell centers
+  void checksum()
+  {
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    const auto first_cell = *coarseSpace.grid_view().begin<0>();
+    const auto& geometry = first_cell.geometry();
+    auto width = geometry.corner(geometry.corners() - 1);
+    width -= geometry.corner(0);
+    const auto lower = problem_->getModelData().gridCorners().first;
+    // 1 + cos^2 of pi times the coarse cell coordinates, equal to 1 in the coarse cell centers
+    const auto perturbation = [lower, width](const DMP::DiffusionBase::DomainType& x) {
+      double factor = 1;
+      for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+        factor += std::pow(std::cos(M_PI * (x[i] - lower[i]) / width[i]), 2);
+      return factor;
+    };
+    const ModifiedDiffusion perturbed(problem_->getDiffusion(), perturbation, 2);
+    const auto& diffusion = problem_->getDiffusion();
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      CommonTraits::DiffusionFunctionBaseType::RangeType expected, actual;
+      diffusion.evaluate(coarse_cell.geometry().center(), expected);
+      perturbed.evaluate(coarse_cell.geometry().center(), actual);
+      actual -= expected;
+      ASSERT_LT(actual.infinity_norm(), 1e-12 * std::max(1., expected.infinity_norm()));
+    }
+    EXPECT_EQ(OfflineArchive::checksum(diffusion, coarseSpace, localgrid_list),
+              OfflineArchive::checksum(diffusion, coarseSpace, localgrid_list));
+    EXPECT_NE(OfflineArchive::checksum(diffusion, coarseSpace, localgrid_list),
+              OfflineArchive::checksum(perturbed, coarseSpace, localgrid_list));
+  }
+};
+
+TEST_F(Archive, RoundTrip)
+{
+  this->round_trip();
+}
+
+TEST_F(Archive, RejectsChangedConfig)
+{
+  this->changed_config();
+}
+
+TEST_F(Archive, ChecksumSamplesLocalGrids)
+{
+  this->checksum();
+}
@@ -50,6 +50,48 @@ struct Projection : public GridAndSpaces
   }
 };
 
+//! exposes both projection paths
+struct ProjectionPaths : public MsFEMProjection
+{
+  using MsFEMProjection::project_generic;
+  using MsFEMProjection::project_nested;
+};
+
+struct NestedProjection : public Projection
+{
+  void compare()
+  {
+    const auto clearGuard = Dune::Multiscale::DiscreteFunctionIO::clear_guard();
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    // a different offset per coarse cell makes the corrections discontinuous across coarse faces, dofs on them
+    // are averaged over the adjacent cells
+    const auto& coarse_grid = coarseSpace.grid_view().grid();
+    LocalsolutionProxy::CorrectionsMapType local_corrections;
+    for (const auto& coarse_entity : Dune::elements(coarseSpace.grid_view())) {
+      const double offset = coarse_grid.leafIndexSet().index(coarse_entity);
+      Lambda lambda([&](CommonTraits::DomainType x) { return x[0] * x[0] - x[1] + offset; }, 2);
+      LocalproblemSolutionManager localSolManager(coarseSpace, coarse_entity, localgrid_list);
+      auto& correction = local_corrections[coarse_grid.leafIndexSet().index(coarse_entity)];
+      correction =
+          Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(localSolManager.space(), " ");
+      Dune::GDT::project(lambda, *correction);
+    }
+    LocalsolutionProxy proxy(std::move(local_corrections), coarseSpace, localgrid_list);
+
+    CommonTraits::DiscreteFunctionType generic(fineSpace);
+    ProjectionPaths::project_generic(proxy, generic);
+    // twice, the second call uses the cached map
+    for (auto run : {0, 1}) {
+      CommonTraits::DiscreteFunctionType nested(fineSpace);
+      ASSERT_TRUE(ProjectionPaths::project_nested(proxy, nested)) << "run " << run;
+      for (const auto i : Dune::XT::Common::value_range(generic.vector().size()))
+        EXPECT_TRUE(Dune::XT::Common::FloatCmp::eq(nested.vector().get_entry(i), generic.vector().get_entry(i)))
+            << "dof " << i << ": " << nested.vector().get_entry(i) << " != " << generic.vector().get_entry(i);
+    }
+    ASSERT_TRUE(localgrid_list.nested_projection(fineSpace.grid_view().grid()));
+  }
+};
+
 struct Search : public GridAndSpaces
 {
 
@@ -75,6 +117,11 @@ TEST_F(Projection, Project)
 {
   this->project();
 }
+
+TEST_F(NestedProjection, EqualsGeneric)
+{
+  this->compare();
+}
 // TEST_P(Search, Project) {
 //  this->lg_search();
 //}
@@ -0,0 +1,111 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/geometry/quadraturerules.hh>
+#include <dune/xt/common/ranges.hh>
+#include <dune/multiscale/msfem/coarse_scale_assembler.hh>
+#include <dune/multiscale/problems/tensor_structure.hh>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+struct TensorStructures : public GridAndSpaces
+{
+  typedef CommonTraits::DiffusionFunctionBaseType::RangeType TensorType;
+  typedef Dune::FieldVector<double, CommonTraits::world_dim> VectorType;
+  typedef Dune::DynamicMatrix<CommonTraits::RangeFieldType> MatrixType;
+
+  //! the diffusion in the quadrature points of the fine grid
+  std::vector<TensorType> tensors()
+  {
+    problem_->getMutableModelData().prepare_new_evaluation(*problem_);
+    const auto& diffusion = problem_->getDiffusion();
+    std::vector<DMP::DomainType> points;
+    for (const auto& entity : Dune::elements(fineSpace.grid_view())) {
+      const auto& geometry = entity.geometry();
+      const auto order = int(diffusion.order());
+      for (const auto& point : Dune::QuadratureRules<double, CommonTraits::world_dim>::rule(entity.type(), order))
+        points.push_back(geometry.global(point.position()));
+    }
+    std::vector<TensorType> ret;
+    diffusion.evaluate_batch(points, ret);
+    return ret;
+  }
+
+  //! the product of the compact tensor equals the full one's for each direction
+  template <DMP::TensorStructure structure>
+  static void expect_same_product(const TensorType& tensor)
+  {
+    const DMP::CompactTensor<structure, CommonTraits::world_dim> compact(tensor);
+    for (const auto d : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+      VectorType direction(1.);
+      direction[d] = -2. - d;
+      VectorType expected, actual;
+      tensor.mv(direction, expected);
+      compact.mv(direction, actual);
+      actual -= expected;
+      EXPECT_LE(actual.infinity_norm(), 1e-14 * std::max(1., tensor.infinity_norm()));
+    }
+  }
+
+  //! every tensor has the structure the diffusion claims, the compact tensors of all structures multiply like the
+  //! full tensors they are taken from
+  void compact_products()
+  {
+    const auto structure = problem_->getDiffusion().structure();
+    const auto all = tensors();
+    ASSERT_FALSE(all.empty());
+    for (const auto& tensor : all) {
+      TensorType diagonal(0.), isotropic(0.);
+      for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim)) {
+        diagonal[i][i] = tensor[i][i];
+        isotropic[i][i] = tensor[0][0];
+      }
+      if (structure != DMP::TensorStructure::full) {
+        auto off_structure = tensor;
+        off_structure -= structure == DMP::TensorStructure::diagonal ? diagonal : isotropic;
+        EXPECT_EQ(off_structure.infinity_norm(), 0.) << "tensor " << tensor;
+      }
+      expect_same_product<DMP::TensorStructure::full>(tensor);
+      expect_same_product<DMP::TensorStructure::diagonal>(diagonal);
+      expect_same_product<DMP::TensorStructure::isotropic>(isotropic);
+    }
+  }
+
+  //! the coarse element matrices with the structured loop equal the ones from diffusiveFlux in each point
+  void element_matrices()
+  {
+    const auto& diffusion = problem_->getDiffusion();
+    const MsFEMCodim0Integral structured(diffusion, true);
+    const MsFEMCodim0Integral pointwise(diffusion, false);
+    for_each_solved_cell([&](const MsFEMTraits::CoarseEntityType& coarse_cell, LocalproblemSolutionManager& manager) {
+      const auto base = coarseSpace.base_function_set(coarse_cell);
+      const auto size = base.size();
+      for (const auto& local_entity : Dune::elements(manager.space().grid_view())) {
+        if (!LocalGridList::covers(coarse_cell, local_entity))
+          continue;
+        MatrixType expected(size, size, 0.), actual(size, size, 0.);
+        std::vector<MatrixType> tmp_matrices;
+        pointwise.apply(manager, local_entity, base, base, expected, tmp_matrices);
+        structured.apply(manager, local_entity, base, base, actual, tmp_matrices);
+        double scale = 1e-14;
+        for (const auto i : Dune::XT::Common::value_range(size))
+          for (const auto j : Dune::XT::Common::value_range(size))
+            scale = std::max(scale, std::abs(expected[i][j]));
+        for (const auto i : Dune::XT::Common::value_range(size))
+          for (const auto j : Dune::XT::Common::value_range(size))
+            EXPECT_NEAR(expected[i][j], actual[i][j], 1e-12 * scale) << "entry " << i << ", " << j;
+      }
+    });
+  }
+};
+
+TEST_F(TensorStructures, CompactProducts)
+{
+  this->compact_products();
+}
+
+TEST_F(TensorStructures, ElementMatrices)
+{
+  this->element_matrices();
+}
@@ -7,7 +7,9 @@
 #include <dune/xt/common/test/gtest/gtest.h>
 
 #include <string>
+#include <algorithm>
 #include <array>
+#include <functional>
 #include <initializer_list>
 #include <vector>
 
@@ -20,10 +22,16 @@
 #include <dune/multiscale/msfem/localproblems/localgridsearch.hh>
 #include <dune/multiscale/msfem/localsolution_proxy.hh>
 #include <dune/multiscale/msfem/localproblems/localgridlist.hh>
+#include <dune/multiscale/msfem/localproblems/localoperator.hh>
+#include <dune/multiscale/msfem/localproblems/localproblemsolver.hh>
+#include <dune/multiscale/msfem/localproblems/localsolutionmanager.hh>
+#include <dune/multiscale/msfem/localproblems/localstructurecache.hh>
+#include <dune/multiscale/common/df_io.hh>
 #include <dune/multiscale/common/grid_creation.hh>
 #include <dune/multiscale/problems/selector.hh>
 #include <dune/stuff/common/float_cmp.hh>
 #include <dune/stuff/common/configuration.hh>
+#include <dune/xt/common/memory.hh>
 
 #include <boost/filesystem.hpp>
 
@@ -47,6 +55,79 @@ void set_param(map<string, string> params)
   }
 }
 
+/** \brief the wrapped coefficient times scale(x), with cubic * |direction|^2 direction added to the flux
+ * An empty scale is 1, a nonzero cubic makes the flux nonlinear while evaluate still gives the scaled tensor.
+ */
+struct ModifiedDiffusion : public DMP::DiffusionBase
+{
+  typedef std::function<double(const DomainType&)> ScaleType;
+
+  ModifiedDiffusion(const DMP::DiffusionBase& diffusion,
+                    ScaleType scale,
+                    const std::size_t extra_order = 0,
+                    const double cubic = 0)
+    : diffusion_(diffusion)
+    , scale_(scale)
+    , extra_order_(extra_order)
+    , cubic_(cubic)
+  {
+  }
+
+  DMP::TensorStructure structure() const final override
+  {
+    return diffusion_.structure();
+  }
+
+  void evaluate(const DomainType& x, DMP::DiffusionBase::RangeType& y) const final override
+  {
+    diffusion_.evaluate(x, y);
+    y *= factor(x);
+  }
+
+  void diffusiveFlux(const DomainType& x,
+                     const DMP::JacobianRangeType& direction,
+                     DMP::JacobianRangeType& flux) const final override
+  {
+    diffusion_.diffusiveFlux(x, direction, flux);
+    flux *= factor(x);
+    const auto norm = direction[0].two_norm2();
+    for (const auto i : Dune::XT::Common::value_range(CommonTraits::world_dim))
+      flux[0][i] += cubic_ * norm * direction[0][i];
+  }
+
+  size_t order() const final override
+  {
+    return diffusion_.order() + extra_order_;
+  }
+
+private:
+  double factor(const DomainType& x) const
+  {
+    return scale_ ? scale_(x) : 1.;
+  }
+
+  const DMP::DiffusionBase& diffusion_;
+  const ScaleType scale_;
+  const std::size_t extra_order_;
+  const double cubic_;
+};
+
+/** \brief the same coarse cells, with the same corrections on them
+ * The coarse solves that produced them only have to stop at the solver's tolerance, not at the same iterate.
+ */
+void expect_equal(const LocalsolutionProxy& expected, const LocalsolutionProxy& actual)
+{
+  ASSERT_EQ(expected.corrections().size(), actual.corrections().size());
+  for (const auto& correction : expected.corrections()) {
+    const auto it = actual.corrections().find(correction.first);
+    ASSERT_NE(it, actual.corrections().end());
+    auto difference = it->second->vector();
+    difference -= correction.second->vector();
+    EXPECT_LE(difference.sup_norm(), 1e-6 * std::max(1., correction.second->vector().sup_norm()))
+        << "coarse cell " << correction.first;
+  }
+}
+
 class GridTestBase : public ::testing::Test
 {
 
@@ -84,6 +165,48 @@ public:
   {
   }
 
+  typedef BackendChooser<MsFEMTraits::LocalSpaceType>::DiscreteFunctionDataType LocalVectorType;
+
+  //! all local solutions of coarse_cell, factorized with structure by the msfem.local_solver
+  std::vector<LocalVectorType> solve_local_problems(const MsFEMTraits::CoarseEntityType& coarse_cell,
+                                                    LocalproblemSolutionManager& manager,
+                                                    LocalStructure& structure,
+                                                    const CommonTraits::ConstDiscreteFunctionType& dirichlet_extension)
+  {
+    auto& solutions = manager.getLocalSolutions();
+    LocalProblemOperator local_operator(*problem_, problem_->getDiffusion(), coarseSpace, manager.space(), structure);
+    MsFEMTraits::LocalSolutionVectorType rhs(solutions.size());
+    for (auto& it : rhs)
+      it = Dune::XT::Common::make_unique<MsFEMTraits::LocalGridDiscreteFunctionType>(manager.space(), "rhs");
+    local_operator.assemble_all_local_rhs(coarse_cell, dirichlet_extension, rhs);
+    local_operator.apply_inverse(rhs, solutions, solutions.size());
+    std::vector<LocalVectorType> result;
+    for (const auto& solution : solutions)
+      result.push_back(solution->vector());
+    return result;
+  }
+
+  /** calls check(coarse_cell, manager) for every coarse cell, after a LocalProblemSolver solved the cell's local
+   * problems. The solutions are cleared afterwards.
+   */
+  template <class CheckType>
+  void for_each_solved_cell(LocalGridList& localgrid_list, CheckType check)
+  {
+    const auto clear_guard = DiscreteFunctionIO::clear_guard();
+    const LocalProblemSolver solver(*problem_, coarseSpace, localgrid_list);
+    for (const auto& coarse_cell : Dune::elements(coarseSpace.grid_view())) {
+      LocalproblemSolutionManager manager(coarseSpace, coarse_cell, localgrid_list);
+      solver.solve_for_cell(coarse_cell, manager);
+      check(coarse_cell, manager);
+    }
+  }
+
+  template <class CheckType>
+  void for_each_solved_cell(CheckType check)
+  {
+    LocalGridList localgrid_list(*problem_, coarseSpace);
+    for_each_solved_cell(localgrid_list, check);
+  }
 
 protected:
   const CommonTraits::SpaceType coarseSpace;
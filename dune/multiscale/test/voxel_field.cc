@@ -0,0 +1,153 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/xt/common/configuration.hh>
+#include <dune/multiscale/problems/voxel_field.hh>
+
+#include <boost/filesystem.hpp>
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+using Dune::Multiscale::Problem::VoxelPermeability;
+
+struct VoxelCache : public ::testing::Test
+{
+  VoxelCache()
+    : directory_(boost::filesystem::path(DXTC_CONFIG_GET("global.datadir", std::string("data"))) / "voxel_field_test")
+    , cells_{{2, 2, 2}}
+    , lower_left_{{0., 0., 0.}}
+    , widths_{{0.5, 0.5, 0.5}}
+  {
+    boost::filesystem::remove_all(directory_);
+    boost::filesystem::create_directories(directory_);
+    config_.set("global.datadir", directory_.string());
+  }
+
+  ~VoxelCache()
+  {
+    boost::system::error_code ignored;
+    boost::filesystem::remove_all(directory_, ignored);
+  }
+
+  boost::filesystem::path source() const
+  {
+    return directory_ / "perm.dat";
+  }
+
+  boost::filesystem::path image() const
+  {
+    return directory_ / "permeability_cache" / "perm.dat.bin";
+  }
+
+  //! the component c entry of voxel v. For offsets 1 to 9 the text has the same length, and most values are not
+  //! representable in single precision
+  static std::string text(const double offset, const std::size_t c, const std::size_t v)
+  {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << offset + 20. * c + v + 0.1;
+    return out.str();
+  }
+
+  static double value(const double offset, const std::size_t c, const std::size_t v)
+  {
+    return std::stod(text(offset, c, v));
+  }
+
+  //! component-major text, like the SPE10 files
+  void write_source(const double offset) const
+  {
+    std::ofstream file(source().string());
+    for (const auto c : {0u, 1u, 2u})
+      for (std::size_t v = 0; v < 8; ++v)
+        file << text(offset, c, v) << "\n";
+  }
+
+  std::unique_ptr<const VoxelPermeability> read() const
+  {
+    return VoxelPermeability::read(source().string(), cells_, lower_left_, widths_, 1., 0., config_);
+  }
+
+  //! evaluates in all voxel centers the world dimension reaches
+  template <class ValueType>
+  void expect_values(const VoxelPermeability& field, const double offset) const
+  {
+    const std::size_t dim = CommonTraits::world_dim < 3 ? CommonTraits::world_dim : 3;
+    DMP::DiffusionBase::RangeType tensor;
+    for (std::size_t v = 0; v < (dim > 2 ? 8u : (dim > 1 ? 4u : 2u)); ++v) {
+      CommonTraits::DomainType center(0);
+      for (std::size_t d = 0; d < dim; ++d)
+        center[d] = lower_left_[d] + ((v >> d) % 2 + 0.5) * widths_[d];
+      field.evaluate(center, tensor);
+      for (std::size_t d = 0; d < dim; ++d)
+        EXPECT_EQ(double(ValueType(value(offset, d, v))), tensor[d][d]) << "voxel " << v << ", component " << d;
+    }
+  }
+
+  const boost::filesystem::path directory_;
+  const std::array<std::size_t, 3> cells_;
+  const std::array<double, 3> lower_left_;
+  const std::array<double, 3> widths_;
+  Dune::XT::Common::Configuration config_;
+};
+
+TEST_F(VoxelCache, WritesAndMapsImage)
+{
+  write_source(1);
+  const auto parsed = read();
+  ASSERT_TRUE(bool(parsed));
+  expect_values<double>(*parsed, 1);
+  // below global.datadir, not next to the data
+  EXPECT_TRUE(boost::filesystem::exists(image()));
+  EXPECT_FALSE(boost::filesystem::exists(source().string() + ".bin"));
+
+  // without the text file only the image can provide the values
+  boost::filesystem::remove(source());
+  const auto mapped = read();
+  ASSERT_TRUE(bool(mapped));
+  expect_values<double>(*mapped, 1);
+}
+
+TEST_F(VoxelCache, RebuildsChangedSource)
+{
+  write_source(1);
+  ASSERT_TRUE(bool(read()));
+  struct stat before;
+  ASSERT_EQ(0, ::stat(source().c_str(), &before));
+
+  // same size, and a modification time that differs from the first file's by a nanosecond
+  write_source(2);
+  struct stat after;
+  ASSERT_EQ(0, ::stat(source().c_str(), &after));
+  ASSERT_EQ(before.st_size, after.st_size);
+  std::array<timespec, 2> times{{after.st_atim, before.st_mtim}};
+  times[1].tv_nsec += times[1].tv_nsec < 999999999 ? 1 : -1;
+  ASSERT_EQ(0, ::utimensat(AT_FDCWD, source().c_str(), times.data(), 0));
+
+  const auto rebuilt = read();
+  ASSERT_TRUE(bool(rebuilt));
+  expect_values<double>(*rebuilt, 2);
+}
+
+TEST_F(VoxelCache, SinglePrecisionImage)
+{
+  write_source(1);
+  config_.set("problem.permeability_cache.float32", true, true);
+  const auto single = read();
+  ASSERT_TRUE(bool(single));
+  expect_values<float>(*single, 1);
+  const auto header_bytes = 8 + 8 * sizeof(std::uint64_t) + 2 * sizeof(double);
+  EXPECT_EQ(header_bytes + 3 * 8 * sizeof(float), boost::filesystem::file_size(image()));
+
+  // the image does not match the requested precision anymore and is rebuilt
+  config_.set("problem.permeability_cache.float32", false, true);
+  const auto full = read();
+  ASSERT_TRUE(bool(full));
+  expect_values<double>(*full, 1);
+  EXPECT_EQ(header_bytes + 3 * 8 * sizeof(double), boost::filesystem::file_size(image()));
+}
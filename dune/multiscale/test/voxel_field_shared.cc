@@ -0,0 +1,107 @@
+#include <dune/multiscale/test/test_common.hxx>
+
+#include <dune/common/exceptions.hh>
+#include <dune/common/parallel/mpihelper.hh>
+#include <dune/xt/common/configuration.hh>
+#include <dune/multiscale/problems/voxel_field.hh>
+
+#include <boost/filesystem.hpp>
+
+#include <array>
+#include <fstream>
+#include <memory>
+#include <string>
+
+using Dune::Multiscale::Problem::VoxelPermeability;
+
+/** Run with two or more ranks on one node, see CMakeLists.txt. Only the first rank of each node is given the data,
+ * the others get a file that does not exist: they can only evaluate the field through the shared window.
+ */
+struct SharedVoxels : public ::testing::Test
+{
+  SharedVoxels()
+    : comm_(Dune::MPIHelper::getCommunicator())
+    , node_rank_(0)
+    , directory_(boost::filesystem::path(DXTC_CONFIG_GET("global.datadir", std::string("data")))
+                 / "voxel_field_shared_test")
+    , cells_{{2, 2, 2}}
+    , lower_left_{{0., 0., 0.}}
+    , widths_{{0.5, 0.5, 0.5}}
+  {
+#if HAVE_MPI && MPI_VERSION >= 3
+    MPI_Comm node;
+    MPI_Comm_split_type(comm_, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node);
+    MPI_Comm_rank(node, &node_rank_);
+    MPI_Comm_free(&node);
+#endif
+    config_.set("problem.permeability_shared", true);
+    config_.set("problem.permeability_cache", false);
+  }
+
+  //! the data for the node's first rank, a missing file for the others
+  std::string source(const std::string& name) const
+  {
+    const auto path = directory_ / name;
+    return (node_rank_ == 0 ? path : directory_ / "missing").string();
+  }
+
+  //! 3 * values entries of voxel number + 10 * component
+  void write_source(const std::string& name, const std::size_t values) const
+  {
+    if (node_rank_ == 0) {
+      boost::filesystem::create_directories(directory_);
+      std::ofstream file((directory_ / name).string());
+      for (std::size_t c = 0; c < 3; ++c)
+        for (std::size_t v = 0; v < values; ++v)
+          file << v + 10. * c << "\n";
+    }
+    Dune::MPIHelper::getCollectiveCommunication().barrier();
+  }
+
+  std::unique_ptr<const VoxelPermeability> read(const std::string& name) const
+  {
+    return VoxelPermeability::read(source(name), cells_, lower_left_, widths_, 1., 0., config_, comm_);
+  }
+
+  const Dune::MPIHelper::MPICommunicator comm_;
+  int node_rank_;
+  const boost::filesystem::path directory_;
+  const std::array<std::size_t, 3> cells_;
+  const std::array<double, 3> lower_left_;
+  const std::array<double, 3> widths_;
+  Dune::XT::Common::Configuration config_;
+};
+
+TEST_F(SharedVoxels, AllRanksEvaluate)
+{
+#if HAVE_MPI && MPI_VERSION >= 3
+  write_source("perm.dat", 8);
+  {
+    const auto field = read("perm.dat");
+    // no ASSERT: returning early would skip the collective window release and the barrier on this rank only
+    EXPECT_TRUE(bool(field));
+    const std::size_t dim = CommonTraits::world_dim < 3 ? CommonTraits::world_dim : 3;
+    DMP::DiffusionBase::RangeType tensor;
+    for (std::size_t v = 0; field && v < (dim > 2 ? 8u : (dim > 1 ? 4u : 2u)); ++v) {
+      CommonTraits::DomainType center(0);
+      for (std::size_t d = 0; d < dim; ++d)
+        center[d] = lower_left_[d] + ((v >> d) % 2 + 0.5) * widths_[d];
+      field->evaluate(center, tensor);
+      for (std::size_t d = 0; d < dim; ++d)
+        EXPECT_EQ(v + 10. * d, tensor[d][d]) << "voxel " << v << ", component " << d;
+    }
+    // all ranks release the window together
+  }
+  Dune::MPIHelper::getCollectiveCommunication().barrier();
+#endif
+}
+
+TEST_F(SharedVoxels, FailureReachesAllRanks)
+{
+#if HAVE_MPI && MPI_VERSION >= 3
+  // too few values, only the node's first rank can notice
+  write_source("short.dat", 7);
+  EXPECT_THROW(read("short.dat"), Dune::IOError);
+  Dune::MPIHelper::getCollectiveCommunication().barrier();
+#endif
+}